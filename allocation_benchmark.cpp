@@ -0,0 +1,105 @@
+#include <atomic>
+#include <iostream>
+#include <memory_resource>
+#include "benchmark.h"
+#include "matrix.h"
+
+// Counts the allocations that reach the heap. Installed as the default resource
+// it sits under every Matrix, Vector and arena of the benchmark.
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    std::atomic<size_t> allocations{0};
+
+private:
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *pointer, size_t bytes, size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+static CountingResource heap;
+
+// One request of a scoring loop: a small dense layer followed by a few vector
+// expressions, every step producing temporaries
+float Score(const linal::Matrix<float> &weights, const linal::Matrix<float> &bias, const linal::Vector &features)
+{
+    linal::Matrix<float> input(features.size(), 1);
+    for (size_t index = 0; index < features.size(); index++)
+    {
+        input(index, 0) = features[index];
+    }
+
+    linal::Matrix<float> hidden = weights * input;
+    hidden = hidden * 0.5f + bias;
+    linal::Matrix<float> output = hidden.Transpose() * weights;
+
+    linal::Vector first = features * 2.0f + features;
+    linal::Vector second = first / 3.0f + features;
+    return linal::Dot(first, second) + output(0, 0);
+}
+
+template <typename F>
+void Run(const char *name, const int &requests, F &&request)
+{
+    const size_t before = heap.allocations.load();
+    float checksum = 0.0f;
+    const double milliseconds = Time(requests, [&]
+                                     { checksum += request(); });
+    const size_t count = heap.allocations.load() - before;
+
+    std::cout << name << " : " << static_cast<double>(count) / requests << " allocations per request, "
+              << milliseconds * 1e3 << " us per request (checksum " << checksum << ")\n";
+}
+
+int main()
+{
+    std::pmr::set_default_resource(&heap);
+
+    const size_t n = 32;
+    const int requests = 20000;
+
+    linal::Matrix<float> weights(n, n), bias(n, 1, 0.25f);
+    for (size_t index = 0; index < n * n; index++)
+    {
+        weights.data()[index] = static_cast<float>(index % 7) * 0.01f;
+    }
+    std::vector<float> values(n);
+    for (size_t index = 0; index < n; index++)
+    {
+        values[index] = static_cast<float>(index) * 0.1f;
+    }
+    const linal::Vector features(values);
+
+    // Warms up the thread-local packing buffers of the matrix product
+    Score(weights, bias, features);
+
+    Run("heap ", requests, [&]()
+        { return Score(weights, bias, features); });
+
+    // One arena per request, released at the end of each request
+    Run("arena", requests, [&]()
+        {
+            linal::ScopedArena arena(1 << 16);
+            return Score(weights, bias, features); });
+
+    // One arena backed by a stack buffer: no allocation reaches the heap at all
+    Run("stack", requests, [&]()
+        {
+            alignas(64) unsigned char buffer[1 << 16];
+            linal::ScopedArena arena(buffer, sizeof(buffer));
+            return Score(weights, bias, features); });
+
+    return 0;
+}
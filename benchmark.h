@@ -0,0 +1,30 @@
+#ifndef MATHEMANIA_BENCHMARK_H_
+#define MATHEMANIA_BENCHMARK_H_
+
+#include <chrono>
+#include <type_traits>
+
+// Average time of one call of operation in milliseconds. An operation that takes
+// an int is passed the repetition, e.g. to pick a different input every time.
+template <typename F>
+double Time(const int &repetitions, F &&operation)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int repetition = 0; repetition < repetitions; repetition++)
+    {
+        if constexpr (std::is_invocable_v<F &, int>)
+        {
+            operation(repetition);
+        }
+        else
+        {
+            operation();
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / repetitions * 1e3;
+}
+
+#endif
+
+// MATHEMANIA_BENCHMARK_H_
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "benchmark.h"
+#include "graph_triangles.h"
+
+template <typename Storage>
+void Report(const char *name, const Storage &storage, const size_t &bytes)
+{
+    size_t edges = 0, degrees = 0, triangles = 0;
+    const double edgeTime = Time(3, [&]
+                                 { edges = storage.edges(); });
+    const double degreeTime = Time(3, [&]
+                                   {
+                                       degrees = 0;
+                                       for (size_t node = 0; node < storage.size(); ++node)
+                                       {
+                                           degrees += storage.out_degree(node) + storage.in_degree(node);
+                                       } });
+    const double triangleTime = Time(1, [&]
+                                     { triangles = TriangleCount(storage); });
+    std::cout << "  " << name << ": " << bytes / 1e6 << " MB, " << edges << " edges in " << edgeTime << " ms, degree sum "
+              << degrees << " in " << degreeTime << " ms, " << triangles << " triangles in " << triangleTime << " ms\n";
+}
+
+// Saves a bitset graph and loads it back; nodes, their order and the edges have to
+// come back unchanged
+bool RoundTrip(const std::string &path)
+{
+    const size_t n = 300;
+    std::mt19937_64 engine(n);
+    std::vector<Node<int>> nodes;
+    for (size_t index = 0; index < n; ++index)
+    {
+        nodes.push_back(Node<int>(static_cast<int>(3 * index)));
+    }
+    linal::Matrix<float> matrix(n, n);
+    for (size_t index = 0; index < n * n; ++index)
+    {
+        matrix.data()[index] = engine() % 8 == 0 ? 1.0f : 0.0f;
+    }
+
+    const Graph<int, float, BitsetStorage<float>> saved(nodes, matrix);
+    Graph<int, float, BitsetStorage<float>> loaded;
+    const bool same = saved.save_to_file(path) && loaded.load_from_file(path) && loaded.size() == saved.size() &&
+                      std::equal(saved.begin(), saved.end(), loaded.begin(), [](const auto &a, const auto &b)
+                                 { return a.GetData() == b.GetData(); }) &&
+                      loaded.Edges() == saved.Edges() && loaded.AdjacencyMatrix() == saved.AdjacencyMatrix();
+    std::remove(path.c_str());
+    return same;
+}
+
+// Usage: bitset_benchmark [average degree]
+// Random unweighted graphs stored as a dense float matrix, CSR and bitsets.
+int main(int argc, char **argv)
+{
+    const size_t degree = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+
+    if (!RoundTrip("bitset_graph.bin"))
+    {
+        std::cerr << "Bitset graph changed on a save and load round trip\n";
+        return 1;
+    }
+
+    for (size_t n = 1024; n <= 8192; n *= 2)
+    {
+        std::mt19937_64 engine(n);
+        std::vector<IndexedEdge<float>> batch(n * degree);
+        for (auto &edge : batch)
+        {
+            edge = {engine() % n, engine() % n, 1.0f};
+        }
+
+        DenseStorage<float> dense;
+        dense.add_nodes(n);
+        dense.insert_edges(batch);
+        CsrStorage<float> csr;
+        csr.add_nodes(n);
+        csr.insert_edges(batch);
+        BitsetStorage<float> bits;
+        bits.add_nodes(n);
+        bits.insert_edges(batch);
+
+        std::cout << n << " nodes\n";
+        Report("dense ", dense, n * n * sizeof(float));
+        Report("csr   ", csr, 2 * (n + 1) * sizeof(size_t) + 2 * csr.edges() * (sizeof(std::uint32_t) + sizeof(float)));
+        Report("bitset", bits, 2 * n * bits.words() * sizeof(std::uint64_t));
+    }
+
+    return 0;
+}
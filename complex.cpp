@@ -4,6 +4,7 @@
 #include "complex.h"
 
 #include <cmath>
+#include <stdexcept>
 
 template <typename T>
 void Complex<T>::clear()
@@ -156,16 +157,67 @@ Complex<T> Complex<T>::operator+(const Complex<Y> &other) const
     return Complex<T>(real, imaginary);
 }
 
-// Addition
+// Increment
+template <typename T>
+template <typename Y>
+Complex<T> &Complex<T>::operator+=(const Complex<Y> &other)
+{
+    real_ += other.Real();
+    imaginary_ += other.Imaginary();
+    return *this;
+}
+
+// Unary plus
+template <typename T>
+Complex<T> Complex<T>::operator+() const
+{
+    return *this;
+}
+
+// Unary minus
+template <typename T>
+Complex<T> Complex<T>::operator-() const
+{
+    return Complex<T>(-real_, -imaginary_);
+}
+
+// Subtraction
+template <typename T>
+template <typename Y>
+Complex<T> Complex<T>::operator-(const Complex<Y> &other) const
+{
+    T real = real_ - other.Real();
+    T imaginary = imaginary_ - other.Imaginary();
+    return Complex<T>(real, imaginary);
+}
+
+// Decrement
+template <typename T>
+template <typename Y>
+Complex<T> &Complex<T>::operator-=(const Complex<Y> &other)
+{
+    real_ -= other.Real();
+    imaginary_ -= other.Imaginary();
+    return *this;
+}
+
+// Multiplication
 template <typename T>
 template <typename Y>
 Complex<T> Complex<T>::operator*(const Complex<Y> &other) const
 {
-    T real = real_ + other.Real() - imaginary_ + other.Imaginary();
+    T real = real_ * other.Real() - imaginary_ * other.Imaginary();
     T imaginary = real_ * other.Imaginary() + imaginary_ * other.Real();
     return Complex<T>(real, imaginary);
 }
 
+template <typename T>
+template <typename Y>
+Complex<T> &Complex<T>::operator*=(const Complex<Y> &other)
+{
+    return *this = *this * other;
+}
+
 // Conjugate
 template <typename T>
 Complex<T> Complex<T>::Conjugate() const
@@ -194,7 +246,14 @@ Complex<T> Complex<T>::operator/(const Complex<Y> &other) const
     {
         throw std::runtime_error("Can not divide by zero.");
     }
-    return Reciprocal() * other;
+    return *this * other.Reciprocal();
+}
+
+template <typename T>
+template <typename Y>
+Complex<T> &Complex<T>::operator/=(const Complex<Y> &other)
+{
+    return *this = *this / other;
 }
 
 // template <typename T>
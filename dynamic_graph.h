@@ -0,0 +1,492 @@
+#pragma once
+
+#include "graph.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+template <typename TNode, typename EdgeWeight, typename Storage>
+class DynamicGraph;
+
+// Immutable state of a DynamicGraph at one version. Erased nodes stay behind as
+// tombstones: they keep their NodeId, have no edges and are not found by find(),
+// so ids never shift under a reader. Algorithms run on storage() as usual, a
+// tombstone is just an isolated node to them.
+template <typename TNode, typename EdgeWeight, typename Storage = CsrStorage<EdgeWeight>>
+class GraphSnapshot
+{
+private:
+    friend class DynamicGraph<TNode, EdgeWeight, Storage>;
+
+    NodeIndex<TNode> nodes_;
+    std::vector<unsigned char> alive_;
+    Storage edges_;
+    size_t live_ = 0;
+    size_t version_ = 0;
+
+public:
+    using storage_type = Storage;
+
+    // Number of commits before this snapshot
+    size_t version() const noexcept
+    {
+        return version_;
+    }
+
+    // Number of NodeIds, tombstones included
+    size_t size() const noexcept
+    {
+        return nodes_.size();
+    }
+
+    size_t live_nodes() const noexcept
+    {
+        return live_;
+    }
+
+    size_t Edges() const
+    {
+        return edges_.edges();
+    }
+
+    bool alive(const NodeId &id) const
+    {
+        return id.index() < alive_.size() && alive_[id.index()];
+    }
+
+    // Id of the node, invalid if it is not in the graph or was erased
+    NodeId find(const Node<TNode> &node) const
+    {
+        const NodeId id = nodes_.find(node);
+        return alive(id) ? id : NodeId();
+    }
+
+    const Node<TNode> &node(const NodeId &id) const
+    {
+        return nodes_.node(id);
+    }
+
+    const Storage &storage() const noexcept
+    {
+        return edges_;
+    }
+
+    size_t degree_in(const NodeId &id) const
+    {
+        return edges_.in_degree(id.index());
+    }
+
+    size_t degree_out(const NodeId &id) const
+    {
+        return edges_.out_degree(id.index());
+    }
+
+    bool contains_edge(const NodeId &from, const NodeId &to) const
+    {
+        return edges_.contains(from.index(), to.index());
+    }
+
+    EdgeWeight weight(const NodeId &from, const NodeId &to) const
+    {
+        return edges_.weight(from.index(), to.index());
+    }
+};
+
+namespace detail
+{
+    // Epoch-based reclamation. Readers announce the epoch they start in, in a slot
+    // of their own; the writer retires an old snapshot together with the epoch it
+    // ended and frees it once every announced epoch is newer. Readers only ever
+    // write their own slot, so they never wait for the writer or for each other.
+    class EpochDomain
+    {
+    public:
+        static constexpr size_t SLOTS = 128;
+        static constexpr std::uint64_t IDLE = std::numeric_limits<std::uint64_t>::max();
+
+    private:
+        struct alignas(64) Slot
+        {
+            std::atomic<std::uint64_t> epoch{IDLE};
+        };
+
+        Slot slots_[SLOTS];
+        std::atomic<std::uint64_t> epoch_{0};
+
+    public:
+        // Claims a free slot and announces the current epoch in it. Only more than
+        // SLOTS simultaneous readers make a reader wait for a slot.
+        size_t enter()
+        {
+            size_t slot = std::hash<std::thread::id>()(std::this_thread::get_id()) % SLOTS;
+            while (true)
+            {
+                std::uint64_t expected = IDLE;
+                if (slots_[slot].epoch.load(std::memory_order_relaxed) == IDLE &&
+                    slots_[slot].epoch.compare_exchange_strong(expected, epoch_.load()))
+                {
+                    return slot;
+                }
+                slot = (slot + 1) % SLOTS;
+            }
+        }
+
+        void leave(const size_t &slot)
+        {
+            slots_[slot].epoch.store(IDLE, std::memory_order_release);
+        }
+
+        // Starts a new epoch and returns the one that ended
+        std::uint64_t advance()
+        {
+            return epoch_.fetch_add(1);
+        }
+
+        // Oldest epoch a reader may still be in, IDLE if there are no readers
+        std::uint64_t oldest() const
+        {
+            std::uint64_t oldest = IDLE;
+            for (const Slot &slot : slots_)
+            {
+                oldest = std::min(oldest, slot.epoch.load());
+            }
+            return oldest;
+        }
+    };
+}
+
+// Graph that changes while it is being read. Writers describe changes as a Batch
+// and commit() applies the whole batch at once by building the next snapshot and
+// publishing it with a single atomic pointer swap. Readers call read(), which
+// pins the snapshot current at that moment without locks; it stays valid and
+// unchanged until the guard goes away, whatever is committed meanwhile.
+// Superseded snapshots are reclaimed once no reader can still see them.
+//
+// Erasing a node leaves a tombstone instead of renumbering (see GraphSnapshot),
+// so erasure costs one batched edge removal rather than a compaction. compact()
+// drops the tombstones and renumbers the remaining nodes when convenient.
+//
+// A commit copies the previous snapshot and merges its edge changes in one batch,
+// O(V + E + B log B) with CsrStorage: batch updates rather than committing edges
+// one by one. Commits are serialized; any number of threads may read.
+template <typename TNode, typename EdgeWeight, typename Storage = CsrStorage<EdgeWeight>>
+class DynamicGraph
+{
+public:
+    using Snapshot = GraphSnapshot<TNode, EdgeWeight, Storage>;
+
+    // Changes applied together by commit(): node insertions first, then edge
+    // insertions and assignments, edge erasures and node erasures, in this order
+    class Batch
+    {
+    private:
+        friend class DynamicGraph;
+
+        std::vector<TNode> insertedNodes_;
+        std::vector<std::tuple<TNode, TNode, EdgeWeight>> assignedEdges_;
+        std::vector<std::pair<TNode, TNode>> erasedEdges_;
+        std::vector<TNode> erasedNodes_;
+
+    public:
+        void insert_node(const Node<TNode> &node)
+        {
+            insertedNodes_.push_back(node.GetData());
+        }
+
+        // A weight that is no edge (zero or less) erases it, as in the edge storages
+        void insert_or_assign_edge(const Node<TNode> &from, const Node<TNode> &to, const EdgeWeight &weight)
+        {
+            assignedEdges_.emplace_back(from.GetData(), to.GetData(), weight);
+        }
+
+        void erase_edge(const Node<TNode> &from, const Node<TNode> &to)
+        {
+            erasedEdges_.emplace_back(from.GetData(), to.GetData());
+        }
+
+        void erase_node(const Node<TNode> &node)
+        {
+            erasedNodes_.push_back(node.GetData());
+        }
+
+        bool empty() const noexcept
+        {
+            return insertedNodes_.empty() && assignedEdges_.empty() && erasedEdges_.empty() && erasedNodes_.empty();
+        }
+
+        void clear()
+        {
+            insertedNodes_.clear();
+            assignedEdges_.clear();
+            erasedEdges_.clear();
+            erasedNodes_.clear();
+        }
+    };
+
+    // Pins one snapshot for as long as it lives
+    class ReadGuard
+    {
+    private:
+        friend class DynamicGraph;
+
+        detail::EpochDomain *domain_ = nullptr;
+        size_t slot_ = 0;
+        const Snapshot *snapshot_ = nullptr;
+
+        ReadGuard(detail::EpochDomain &domain, const std::atomic<const Snapshot *> &current)
+            : domain_(&domain), slot_(domain.enter()), snapshot_(current.load())
+        {
+        }
+
+    public:
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard &operator=(const ReadGuard &) = delete;
+
+        ReadGuard(ReadGuard &&other) noexcept
+            : domain_(std::exchange(other.domain_, nullptr)), slot_(other.slot_),
+              snapshot_(std::exchange(other.snapshot_, nullptr))
+        {
+        }
+
+        ReadGuard &operator=(ReadGuard &&other) noexcept
+        {
+            if (this != &other)
+            {
+                release();
+                domain_ = std::exchange(other.domain_, nullptr);
+                slot_ = other.slot_;
+                snapshot_ = std::exchange(other.snapshot_, nullptr);
+            }
+            return *this;
+        }
+
+        ~ReadGuard()
+        {
+            release();
+        }
+
+        // Unpins the snapshot early
+        void release()
+        {
+            if (domain_ != nullptr)
+            {
+                domain_->leave(slot_);
+                domain_ = nullptr;
+                snapshot_ = nullptr;
+            }
+        }
+
+        const Snapshot &operator*() const noexcept
+        {
+            return *snapshot_;
+        }
+
+        const Snapshot *operator->() const noexcept
+        {
+            return snapshot_;
+        }
+    };
+
+private:
+    mutable detail::EpochDomain domain_;
+    std::atomic<const Snapshot *> current_;
+    // Superseded snapshots with the epoch that ended when they were replaced
+    std::vector<std::pair<std::uint64_t, const Snapshot *>> retired_;
+    std::mutex writer_;
+
+    // Id of a node that has to be in the next snapshot
+    static NodeId require(const Snapshot &snapshot, const TNode &node)
+    {
+        const NodeId id = snapshot.find(Node<TNode>(node));
+        if (!id)
+        {
+            throw std::invalid_argument("Node does not exist within the graph.");
+        }
+        return id;
+    }
+
+    // Publishes the next snapshot and frees the superseded ones nobody can see
+    void publish(std::unique_ptr<Snapshot> next)
+    {
+        const Snapshot *previous = current_.exchange(next.release());
+        retired_.emplace_back(domain_.advance(), previous);
+        reclaim();
+    }
+
+    void reclaim()
+    {
+        const std::uint64_t oldest = domain_.oldest();
+        size_t kept = 0;
+        for (const auto &entry : retired_)
+        {
+            if (entry.first < oldest)
+            {
+                delete entry.second;
+            }
+            else
+            {
+                retired_[kept++] = entry;
+            }
+        }
+        retired_.resize(kept);
+    }
+
+public:
+    DynamicGraph() : current_(new Snapshot())
+    {
+    }
+
+    // Starts from a copy of a graph, at version 0
+    explicit DynamicGraph(const Graph<TNode, EdgeWeight, Storage> &graph) : DynamicGraph()
+    {
+        auto snapshot = std::make_unique<Snapshot>();
+        for (const auto &node : graph)
+        {
+            snapshot->nodes_.insert(node);
+        }
+        snapshot->alive_.assign(graph.size(), 1);
+        snapshot->live_ = graph.size();
+        snapshot->edges_ = graph.storage();
+        delete current_.exchange(snapshot.release());
+    }
+
+    DynamicGraph(const DynamicGraph &) = delete;
+    DynamicGraph &operator=(const DynamicGraph &) = delete;
+
+    // Every ReadGuard has to be gone by now
+    ~DynamicGraph()
+    {
+        delete current_.load();
+        for (const auto &entry : retired_)
+        {
+            delete entry.second;
+        }
+    }
+
+    // Pins the current snapshot, never blocks on writers
+    ReadGuard read() const
+    {
+        return ReadGuard(domain_, current_);
+    }
+
+    size_t version() const
+    {
+        return read()->version();
+    }
+
+    // Applies the batch atomically and returns the new version. Throws
+    // std::invalid_argument, publishing nothing, if an edge refers to a node
+    // that neither exists nor is inserted by the batch.
+    size_t commit(const Batch &batch)
+    {
+        std::lock_guard<std::mutex> lock(writer_);
+        auto next = std::make_unique<Snapshot>(*current_.load());
+        next->version_++;
+
+        // Inserting an erased node revives its tombstone
+        size_t added = 0;
+        for (const TNode &node : batch.insertedNodes_)
+        {
+            const auto inserted = next->nodes_.insert(Node<TNode>(node));
+            if (inserted.second)
+            {
+                next->alive_.push_back(1);
+                added++;
+                next->live_++;
+            }
+            else if (!next->alive_[inserted.first.index()])
+            {
+                next->alive_[inserted.first.index()] = 1;
+                next->live_++;
+            }
+        }
+        next->edges_.add_nodes(added);
+
+        // One merge for all edge changes, later entries win
+        std::vector<typename Storage::Edge> updates;
+        updates.reserve(batch.assignedEdges_.size() + batch.erasedEdges_.size());
+        for (const auto &[from, to, weight] : batch.assignedEdges_)
+        {
+            updates.push_back({require(*next, from).index(), require(*next, to).index(), weight});
+        }
+        for (const auto &[from, to] : batch.erasedEdges_)
+        {
+            const NodeId fromId = next->find(Node<TNode>(from)), toId = next->find(Node<TNode>(to));
+            if (fromId && toId)
+            {
+                updates.push_back({fromId.index(), toId.index(), EdgeWeight()});
+            }
+        }
+        for (const TNode &node : batch.erasedNodes_)
+        {
+            const NodeId id = next->find(Node<TNode>(node));
+            if (!id)
+            {
+                continue;
+            }
+            const size_t index = id.index();
+            next->edges_.for_each_out(index, [&](const size_t &to, const EdgeWeight &)
+                                      { updates.push_back({index, to, EdgeWeight()}); });
+            next->edges_.for_each_in(index, [&](const size_t &from, const EdgeWeight &)
+                                     { updates.push_back({from, index, EdgeWeight()}); });
+            // Edges inserted by this batch are not in the storage yet
+            for (const auto &[from, to, weight] : batch.assignedEdges_)
+            {
+                if (from == node || to == node)
+                {
+                    updates.push_back({require(*next, from).index(), require(*next, to).index(), EdgeWeight()});
+                }
+            }
+            next->alive_[index] = 0;
+            next->live_--;
+        }
+        next->edges_.insert_edges(updates);
+
+        const size_t version = next->version_;
+        publish(std::move(next));
+        return version;
+    }
+
+    // Drops the tombstones; the remaining nodes keep their order but get dense ids
+    // again. Readers of older snapshots are unaffected.
+    size_t compact()
+    {
+        std::lock_guard<std::mutex> lock(writer_);
+        const Snapshot &current = *current_.load();
+        auto next = std::make_unique<Snapshot>();
+        next->version_ = current.version_ + 1;
+
+        std::vector<size_t> renumbered(current.size(), NodeId::npos);
+        for (size_t id = 0; id < current.size(); ++id)
+        {
+            if (current.alive_[id])
+            {
+                renumbered[id] = next->nodes_.insert(current.nodes_.node(NodeId(id))).first.index();
+            }
+        }
+        next->alive_.assign(next->nodes_.size(), 1);
+        next->live_ = next->nodes_.size();
+        next->edges_.add_nodes(next->nodes_.size());
+
+        std::vector<typename Storage::Edge> edges;
+        edges.reserve(current.Edges());
+        for (size_t from = 0; from < current.size(); ++from)
+        {
+            current.edges_.for_each_out(from, [&](const size_t &to, const EdgeWeight &weight)
+                                        { edges.push_back({renumbered[from], renumbered[to], weight}); });
+        }
+        next->edges_.insert_edges(edges);
+
+        const size_t version = next->version_;
+        publish(std::move(next));
+        return version;
+    }
+};
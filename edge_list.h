@@ -0,0 +1,286 @@
+#pragma once
+
+#include "graph.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Streaming loader for text edge lists, one edge per line:
+//
+//   source target [weight]
+//
+// Fields are separated by spaces, tabs or commas; a missing weight counts as 1.
+// Empty lines and comment lines starting with '#' or '%' (as in SNAP files) are
+// skipped, anything after the weight is ignored. Matrix Market files are not
+// recognized: their size line would be read as an edge.
+
+struct EdgeListStats
+{
+    size_t bytes = 0;
+    // Size of the whole file, for progress reports
+    size_t totalBytes = 0;
+    size_t lines = 0;
+    size_t edges = 0;
+    size_t nodes = 0;
+    double seconds = 0;
+
+    double mb_per_second() const noexcept
+    {
+        return seconds > 0 ? bytes / seconds / 1e6 : 0;
+    }
+
+    double edges_per_second() const noexcept
+    {
+        return seconds > 0 ? edges / seconds : 0;
+    }
+};
+
+struct EdgeListOptions
+{
+    // Bytes of text read and parsed at a time
+    size_t chunkSize = size_t(64) << 20;
+    // Called after every chunk with the counters so far
+    std::function<void(const EdgeListStats &)> progress;
+};
+
+namespace detail
+{
+    inline bool IsFieldSeparator(const char &c) noexcept
+    {
+        return c == ' ' || c == '\t' || c == ',' || c == '\r';
+    }
+
+    template <typename T>
+    bool ParseField(const char *&position, const char *end, T &value)
+    {
+        while (position < end && IsFieldSeparator(*position))
+        {
+            position++;
+        }
+        if (position < end && *position == '+')
+        {
+            position++;
+        }
+        const std::from_chars_result result = std::from_chars(position, end, value);
+        if (result.ec != std::errc())
+        {
+            return false;
+        }
+        position = result.ptr;
+        return true;
+    }
+
+    template <typename TNode, typename EdgeWeight>
+    struct ParsedEdge
+    {
+        TNode from, to;
+        EdgeWeight weight;
+    };
+
+    // Parses the complete lines of [first, last), appending edges and counting lines.
+    // offset is the file position of first, for error messages.
+    template <typename TNode, typename EdgeWeight>
+    void ParseEdgeLines(const char *first, const char *last, const size_t &offset,
+                        std::vector<ParsedEdge<TNode, EdgeWeight>> &edges, size_t &lines)
+    {
+        const char *position = first;
+        while (position < last)
+        {
+            const char *lineEnd = std::find(position, last, '\n');
+            lines++;
+
+            const char *cursor = position;
+            while (cursor < lineEnd && IsFieldSeparator(*cursor))
+            {
+                cursor++;
+            }
+            if (cursor < lineEnd && *cursor != '#' && *cursor != '%')
+            {
+                ParsedEdge<TNode, EdgeWeight> edge{TNode(), TNode(), EdgeWeight(1)};
+                if (!ParseField(cursor, lineEnd, edge.from) || !ParseField(cursor, lineEnd, edge.to))
+                {
+                    throw std::runtime_error("Malformed edge list line at byte " +
+                                             std::to_string(offset + (position - first)) + ".");
+                }
+                const char *weight = cursor;
+                while (weight < lineEnd && IsFieldSeparator(*weight))
+                {
+                    weight++;
+                }
+                if (weight < lineEnd && !ParseField(cursor, lineEnd, edge.weight))
+                {
+                    throw std::runtime_error("Malformed edge weight at byte " +
+                                             std::to_string(offset + (weight - first)) + ".");
+                }
+                edges.push_back(edge);
+            }
+            position = lineEnd + 1;
+        }
+    }
+}
+
+// Reads a text edge list into graph, adding nodes in the order they first appear
+// and inserting or assigning edges (later duplicates win). Returns the counters,
+// throws std::runtime_error if the file cannot be read or a line is malformed.
+//
+// The file is read in chunks of options.chunkSize bytes. Every chunk is cut at
+// line boundaries into a few pieces per thread that are parsed in parallel with
+// std::from_chars. Endpoints already in the graph are then mapped to NodeIds in
+// parallel and new ones are inserted in file order. Edges are buffered and handed
+// to the storage in batches no larger than the edges merged so far, so the loader
+// holds one chunk of text plus at most one graph worth of pending edges, and every
+// edge is merged O(1) times on average. Nothing here materializes an adjacency matrix;
+// with CsrStorage the whole load stays O(V + E) in memory.
+template <typename TNode, typename EdgeWeight, typename Storage>
+EdgeListStats LoadEdgeList(Graph<TNode, EdgeWeight, Storage> &graph, const std::string &path,
+                           const EdgeListOptions &options = EdgeListOptions())
+{
+    static_assert(std::is_arithmetic_v<TNode>, "Edge lists need numeric node values.");
+    using Edge = typename Storage::Edge;
+    using Parsed = detail::ParsedEdge<TNode, EdgeWeight>;
+
+    std::ifstream stream(path, std::ios::binary | std::ios::ate);
+    if (!stream)
+    {
+        throw std::runtime_error("Cannot open edge list " + path + ".");
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    EdgeListStats stats;
+    stats.totalBytes = static_cast<size_t>(stream.tellg());
+    stream.seekg(0);
+
+    const size_t chunkSize = std::max<size_t>(options.chunkSize, 1 << 12);
+    const size_t pieces = 4 * linal::ThreadCount();
+    std::vector<char> buffer;
+    std::vector<std::vector<Parsed>> parsed(pieces);
+    std::vector<size_t> lines(pieces);
+    std::vector<Edge> pending;
+    // Edges handed to the storage so far, duplicates included; counting the graph's
+    // edges instead would scan a dense adjacency matrix after every chunk
+    size_t merged = 0;
+
+    auto flush = [&]()
+    {
+        graph.insert_or_assign_edges(pending);
+        merged += pending.size();
+        pending.clear();
+    };
+
+    // Unparsed tail of the previous chunk, an incomplete line
+    size_t carry = 0;
+    while (carry > 0 || stats.bytes < stats.totalBytes)
+    {
+        buffer.resize(carry + chunkSize);
+        stream.read(buffer.data() + carry, static_cast<std::streamsize>(chunkSize));
+        const size_t read = static_cast<size_t>(stream.gcount());
+        if (read == 0 && stream.bad())
+        {
+            throw std::runtime_error("Cannot read edge list " + path + ".");
+        }
+        const size_t offset = stats.bytes - carry;
+        stats.bytes += read;
+
+        const size_t filled = carry + read;
+        const bool last = read == 0 || stats.bytes >= stats.totalBytes;
+        size_t complete = filled;
+        if (!last)
+        {
+            const auto newline = std::find(buffer.rbegin() + static_cast<std::ptrdiff_t>(buffer.size() - filled),
+                                           buffer.rend(), '\n');
+            complete = static_cast<size_t>(buffer.rend() - newline);
+        }
+
+        // Piece boundaries just past a newline, so that every piece holds whole lines
+        std::vector<size_t> bounds(pieces + 1, complete);
+        bounds[0] = 0;
+        for (size_t piece = 1; piece < pieces; ++piece)
+        {
+            const size_t guess = std::max(bounds[piece - 1], complete * piece / pieces);
+            const char *newline = std::find(buffer.data() + guess, buffer.data() + complete, '\n');
+            bounds[piece] = std::min(complete, static_cast<size_t>(newline - buffer.data()) + 1);
+        }
+
+        linal::ThreadPool::Instance().ParallelFor(pieces, [&](size_t piece)
+                                                  {
+                                                      parsed[piece].clear();
+                                                      lines[piece] = 0;
+                                                      detail::ParseEdgeLines(buffer.data() + bounds[piece],
+                                                                             buffer.data() + bounds[piece + 1],
+                                                                             offset + bounds[piece], parsed[piece],
+                                                                             lines[piece]); });
+
+        // Endpoints already in the graph are looked up in parallel, lookups are read-only
+        std::vector<size_t> first(pieces + 1, pending.size());
+        for (size_t piece = 0; piece < pieces; ++piece)
+        {
+            first[piece + 1] = first[piece] + parsed[piece].size();
+            stats.lines += lines[piece];
+        }
+        pending.resize(first[pieces]);
+        linal::ThreadPool::Instance().ParallelFor(pieces, [&](size_t piece)
+                                                  {
+                                                      Edge *target = pending.data() + first[piece];
+                                                      for (const Parsed &edge : parsed[piece])
+                                                      {
+                                                          *target++ = Edge{graph.find(Node<TNode>(edge.from)).index(),
+                                                                           graph.find(Node<TNode>(edge.to)).index(),
+                                                                           edge.weight};
+                                                      } });
+
+        // New nodes are inserted in file order
+        for (size_t piece = 0; piece < pieces; ++piece)
+        {
+            Edge *target = pending.data() + first[piece];
+            for (const Parsed &edge : parsed[piece])
+            {
+                if (target->from == NodeId::npos)
+                {
+                    target->from = graph.insert_node(Node<TNode>(edge.from)).first.index();
+                }
+                if (target->to == NodeId::npos)
+                {
+                    target->to = graph.insert_node(Node<TNode>(edge.to)).first.index();
+                }
+                target++;
+            }
+        }
+        stats.edges += first[pieces] - first[0];
+
+        if (pending.size() >= std::max(merged, chunkSize / sizeof(Edge)))
+        {
+            flush();
+        }
+
+        carry = filled - complete;
+        std::copy(buffer.begin() + static_cast<std::ptrdiff_t>(complete),
+                  buffer.begin() + static_cast<std::ptrdiff_t>(filled), buffer.begin());
+        if (last)
+        {
+            carry = 0;
+        }
+
+        stats.nodes = graph.size();
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (options.progress)
+        {
+            options.progress(stats);
+        }
+        if (read == 0)
+        {
+            break;
+        }
+    }
+
+    flush();
+    stats.nodes = graph.size();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
@@ -0,0 +1,45 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "edge_list.h"
+#include "graph_generators.h"
+
+// Usage: edge_list_benchmark [scale] [edge factor] [file]
+// Writes an R-MAT edge list to the file (edges.txt by default), then loads it.
+int main(int argc, char **argv)
+{
+    const size_t scale = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 18;
+    const size_t edgeFactor = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 16;
+    const std::string path = argc > 3 ? argv[3] : "edges.txt";
+
+    {
+        std::FILE *file = std::fopen(path.c_str(), "w");
+        if (file == nullptr)
+        {
+            std::cerr << "Cannot write " << path << "\n";
+            return 1;
+        }
+        for (const auto &edge : RMatEdges<float>(scale, edgeFactor))
+        {
+            std::fprintf(file, "%zu %zu %g\n", edge.from, edge.to, static_cast<double>(edge.weight));
+        }
+        std::fclose(file);
+    }
+
+    EdgeListOptions options;
+    options.progress = [](const EdgeListStats &stats)
+    {
+        std::cout << "  " << stats.bytes * 100 / std::max<size_t>(stats.totalBytes, 1) << "%: " << stats.edges
+                  << " edges, " << stats.mb_per_second() << " MB/s\n";
+    };
+
+    Graph<std::uint32_t, float, CsrStorage<float>> graph;
+    const EdgeListStats stats = LoadEdgeList(graph, path, options);
+    std::cout << "Loaded " << stats.bytes / 1e6 << " MB, " << stats.lines << " lines into " << graph.size()
+              << " nodes and " << graph.Edges() << " edges in " << stats.seconds << " s: " << stats.mb_per_second()
+              << " MB/s, " << stats.edges_per_second() / 1e6 << " M edges/s\n";
+
+    std::remove(path.c_str());
+    return 0;
+}
@@ -0,0 +1,271 @@
+#ifndef MATHEMANIA_EXPRESSION_H_
+#define MATHEMANIA_EXPRESSION_H_
+
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "simd.h"
+
+namespace linal
+{
+    // Base of everything that can appear in a lazy element-wise expression.
+    // An expression E provides value_type, rows(), columns(), size() and
+    // coefficient(index), the element at a row-major linear index.
+    // Nothing is computed until the expression is assigned to a Matrix or a
+    // Vector, which then evaluates it in a single loop without temporaries.
+    template <typename E>
+    class Expression
+    {
+    public:
+        const E &derived() const noexcept
+        {
+            return static_cast<const E &>(*this);
+        }
+    };
+
+    // Tag of intermediate nodes, which are stored by value inside their parents.
+    // Leaves (matrices and vectors) are stored by reference, so an expression
+    // must not outlive the objects it was built from.
+    struct ExpressionNode
+    {
+    };
+
+    template <typename E>
+    using ExpressionOperand = std::conditional_t<std::is_base_of_v<ExpressionNode, E>, const E, const E &>;
+
+    template <typename E>
+    constexpr bool IsExpression = std::is_base_of_v<Expression<E>, E>;
+
+    struct Plus
+    {
+        template <typename X, typename Y>
+        auto operator()(const X &x, const Y &y) const
+        {
+            return x + y;
+        }
+    };
+
+    struct Multiplies
+    {
+        template <typename X, typename Y>
+        auto operator()(const X &x, const Y &y) const
+        {
+            return x * y;
+        }
+    };
+
+    struct Divides
+    {
+        template <typename X, typename Y>
+        auto operator()(const X &x, const Y &y) const
+        {
+            return x / y;
+        }
+    };
+
+    // Element-wise combination of two expressions of the same shape
+    template <typename L, typename R, typename Operation>
+    class BinaryExpression : public Expression<BinaryExpression<L, R, Operation>>, public ExpressionNode
+    {
+    private:
+        ExpressionOperand<L> left_;
+        ExpressionOperand<R> right_;
+
+    public:
+        using value_type = std::decay_t<decltype(Operation()(std::declval<typename L::value_type>(),
+                                                             std::declval<typename R::value_type>()))>;
+
+        BinaryExpression(const L &left, const R &right) : left_(left), right_(right)
+        {
+            if (left.rows() != right.rows() || left.columns() != right.columns())
+            {
+                throw std::invalid_argument("Operands have different shapes.");
+            }
+        }
+
+        size_t rows() const noexcept
+        {
+            return left_.rows();
+        }
+
+        size_t columns() const noexcept
+        {
+            return left_.columns();
+        }
+
+        size_t size() const noexcept
+        {
+            return left_.size();
+        }
+
+        value_type coefficient(const size_t &index) const
+        {
+            return Operation()(left_.coefficient(index), right_.coefficient(index));
+        }
+
+        const L &left() const noexcept
+        {
+            return left_;
+        }
+
+        const R &right() const noexcept
+        {
+            return right_;
+        }
+    };
+
+    // Combination of every element of an expression with one scalar.
+    // The scalar is converted to the element type up front, as the eager operators did.
+    template <typename E, typename Operation>
+    class ScalarExpression : public Expression<ScalarExpression<E, Operation>>, public ExpressionNode
+    {
+    private:
+        ExpressionOperand<E> expression_;
+        typename E::value_type scalar_;
+
+    public:
+        using value_type = typename E::value_type;
+
+        template <typename S>
+        ScalarExpression(const E &expression, const S &scalar)
+            : expression_(expression), scalar_(static_cast<value_type>(scalar))
+        {
+        }
+
+        size_t rows() const noexcept
+        {
+            return expression_.rows();
+        }
+
+        size_t columns() const noexcept
+        {
+            return expression_.columns();
+        }
+
+        size_t size() const noexcept
+        {
+            return expression_.size();
+        }
+
+        value_type coefficient(const size_t &index) const
+        {
+            return Operation()(expression_.coefficient(index), scalar_);
+        }
+
+        const E &expression() const noexcept
+        {
+            return expression_;
+        }
+
+        const value_type &scalar() const noexcept
+        {
+            return scalar_;
+        }
+    };
+
+    // Leaves declare static constexpr bool contiguous = true when coefficient(i) is data()[i]
+    template <typename E, typename = void>
+    struct IsContiguousStorage : std::false_type
+    {
+    };
+
+    template <typename E>
+    struct IsContiguousStorage<E, std::void_t<decltype(E::contiguous)>> : std::bool_constant<E::contiguous>
+    {
+    };
+
+    // A leaf whose elements of type T are stored contiguously and exposed through data()
+    template <typename E, typename T>
+    constexpr bool IsContiguousLeaf = !std::is_base_of_v<ExpressionNode, E> && IsContiguousStorage<E>::value &&
+                                      std::is_same_v<typename E::value_type, T>;
+
+    // Runs the single-operation shapes x + y, x * s and x / s over float or double
+    // leaves through the SIMD kernels. Returns false for every other expression.
+    template <typename T, typename E>
+    bool EvaluateVectorized(const E &, T *)
+    {
+        return false;
+    }
+
+    template <typename T, typename L, typename R>
+    bool EvaluateVectorized(const BinaryExpression<L, R, Plus> &source, T *destination)
+    {
+        if constexpr (kernels::IsVectorizable<T> && IsContiguousLeaf<L, T> && IsContiguousLeaf<R, T>)
+        {
+            kernels::Add(source.size(), source.left().data(), source.right().data(), destination);
+            return true;
+        }
+        return false;
+    }
+
+    template <typename T, typename E>
+    bool EvaluateVectorized(const ScalarExpression<E, Multiplies> &source, T *destination)
+    {
+        if constexpr (kernels::IsVectorizable<T> && IsContiguousLeaf<E, T>)
+        {
+            kernels::Scale(source.size(), source.expression().data(), source.scalar(), destination);
+            return true;
+        }
+        return false;
+    }
+
+    template <typename T, typename E>
+    bool EvaluateVectorized(const ScalarExpression<E, Divides> &source, T *destination)
+    {
+        if constexpr (kernels::IsVectorizable<T> && IsContiguousLeaf<E, T>)
+        {
+            kernels::Divide(source.size(), source.expression().data(), source.scalar(), destination);
+            return true;
+        }
+        return false;
+    }
+
+    // Writes every element of an expression to destination in one pass
+    template <typename T, typename E>
+    void Evaluate(const Expression<E> &expression, T *destination)
+    {
+        const E &source = expression.derived();
+        if (EvaluateVectorized(source, destination))
+        {
+            return;
+        }
+
+        for (size_t index = 0; index < source.size(); index++)
+        {
+            destination[index] = static_cast<T>(source.coefficient(index));
+        }
+    }
+
+    // Element-wise addition
+    template <typename L, typename R>
+    BinaryExpression<L, R, Plus> operator+(const Expression<L> &left, const Expression<R> &right)
+    {
+        return BinaryExpression<L, R, Plus>(left.derived(), right.derived());
+    }
+
+    // Multiplication by scalar
+    template <typename E, typename S, typename = std::enable_if_t<!IsExpression<S>>>
+    ScalarExpression<E, Multiplies> operator*(const Expression<E> &expression, const S &scalar)
+    {
+        return ScalarExpression<E, Multiplies>(expression.derived(), scalar);
+    }
+
+    template <typename E, typename S, typename = std::enable_if_t<!IsExpression<S>>>
+    ScalarExpression<E, Multiplies> operator*(const S &scalar, const Expression<E> &expression)
+    {
+        return ScalarExpression<E, Multiplies>(expression.derived(), scalar);
+    }
+
+    // Division by scalar
+    template <typename E, typename S, typename = std::enable_if_t<!IsExpression<S>>>
+    ScalarExpression<E, Divides> operator/(const Expression<E> &expression, const S &scalar)
+    {
+        return ScalarExpression<E, Divides>(expression.derived(), scalar);
+    }
+}
+
+#endif
+
+// MATHEMANIA_EXPRESSION_H_
@@ -0,0 +1,125 @@
+#ifndef MATHEMANIA_FFT_H_
+#define MATHEMANIA_FFT_H_
+
+#include "complex.cpp"
+
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Smallest power of two that is at least n
+inline size_t FFTLength(const size_t &n)
+{
+    size_t length = 1;
+    while (length < n)
+    {
+        length <<= 1;
+    }
+    return length;
+}
+
+// In-place iterative radix-2 FFT; data.size() has to be a power of two. The
+// inverse transform includes the 1 / n factor.
+template <typename T>
+void FFT(std::vector<Complex<T>> &data, const bool &inverse = false)
+{
+    const size_t n = data.size();
+    if ((n & (n - 1)) != 0)
+    {
+        throw std::invalid_argument("FFT length has to be a power of two.");
+    }
+    if (n <= 1)
+    {
+        return;
+    }
+
+    for (size_t i = 1, j = 0; i < n; ++i)
+    {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+        {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j)
+        {
+            std::swap(data[i], data[j]);
+        }
+    }
+
+    // Every root of unity computed directly, repeated multiplication drifts
+    const T pi = std::acos(T(-1));
+    std::vector<Complex<T>> roots(n / 2);
+    for (size_t k = 0; k < n / 2; ++k)
+    {
+        roots[k] = Complex<T>(T(1), (inverse ? 2 : -2) * pi * T(k) / T(n), polar);
+    }
+
+    for (size_t length = 2; length <= n; length <<= 1)
+    {
+        const size_t half = length / 2, stride = n / length;
+        for (size_t start = 0; start < n; start += length)
+        {
+            for (size_t k = 0; k < half; ++k)
+            {
+                const Complex<T> even = data[start + k];
+                const Complex<T> odd = data[start + k + half] * roots[k * stride];
+                data[start + k] = even + odd;
+                data[start + k + half] = even - odd;
+            }
+        }
+    }
+
+    if (inverse)
+    {
+        for (Complex<T> &value : data)
+        {
+            value = Complex<T>(value.Real() / T(n), value.Imaginary() / T(n));
+        }
+    }
+}
+
+// Linear convolution of two real sequences, a.size() + b.size() - 1 elements.
+// Both go through one complex transform, a as the real and b as the imaginary
+// part, so that it takes two FFTs instead of three.
+template <typename T>
+std::vector<T> Convolve(const std::vector<T> &a, const std::vector<T> &b)
+{
+    if (a.empty() || b.empty())
+    {
+        return std::vector<T>();
+    }
+    const size_t size = a.size() + b.size() - 1;
+    const size_t n = FFTLength(size);
+
+    std::vector<Complex<T>> data(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        data[i] = Complex<T>(i < a.size() ? a[i] : T(), i < b.size() ? b[i] : T());
+    }
+    FFT(data);
+
+    // With Z = FFT(a + ib): A[k] B[k] = (Z[k]^2 - conj(Z[n - k])^2) / 4i
+    std::vector<Complex<T>> product(n);
+    for (size_t k = 0; k < n; ++k)
+    {
+        const Complex<T> z = data[k];
+        const Complex<T> mirror = data[(n - k) & (n - 1)].Conjugate();
+        const Complex<T> difference = z * z - mirror * mirror;
+        product[k] = Complex<T>(difference.Imaginary() / 4, -difference.Real() / 4);
+    }
+    FFT(product, true);
+
+    std::vector<T> result(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        result[i] = product[i].Real();
+    }
+    return result;
+}
+
+#endif
+
+// MATHEMANIA_FFT_H_
@@ -0,0 +1,456 @@
+#ifndef MATHEMANIA_FIXED_MATRIX_H_
+#define MATHEMANIA_FIXED_MATRIX_H_
+
+#include <array>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+#include "matrix.h"
+
+namespace linal
+{
+    // Matrix with a compile-time shape. The elements live inline in a std::array,
+    // so small transforms never touch the heap, and every operation is constexpr
+    // with loop bounds known to the compiler.
+    template <typename T, size_t Rows, size_t Columns>
+    class Matrix
+    {
+        static_assert(Rows != Dynamic && Columns != Dynamic, "Both dimensions of a fixed-size matrix must be positive.");
+
+        template <typename, size_t, size_t>
+        friend class Matrix;
+
+    protected:
+        std::array<T, Rows * Columns> values_;
+
+        template <size_t K, size_t... Indices>
+        static constexpr T RowColumnProduct(const Matrix &left, const Matrix<T, Columns, K> &right,
+                                            const size_t &row, const size_t &column, std::index_sequence<Indices...>)
+        {
+            return ((left.values_[row * Columns + Indices] * right.values_[Indices * K + column]) + ...);
+        }
+
+    public:
+        using value_type = T;
+
+        static constexpr size_t rows() noexcept
+        {
+            return Rows;
+        }
+
+        static constexpr size_t columns() noexcept
+        {
+            return Columns;
+        }
+
+        static constexpr size_t size() noexcept
+        {
+            return Rows * Columns;
+        }
+
+        static constexpr bool square() noexcept
+        {
+            return Rows == Columns;
+        }
+
+        // Zero matrix
+        constexpr Matrix() : values_()
+        {
+        }
+
+        // Elements in row-major order
+        template <typename... Y, typename = std::enable_if_t<sizeof...(Y) == Rows * Columns && (Rows * Columns > 1)>>
+        constexpr Matrix(const Y &...values) : values_{static_cast<T>(values)...}
+        {
+        }
+
+        constexpr explicit Matrix(const std::array<T, Rows * Columns> &values) : values_(values)
+        {
+        }
+
+        template <typename Y>
+        constexpr explicit Matrix(const Matrix<Y, Rows, Columns> &other) : values_()
+        {
+            for (size_t index = 0; index < Rows * Columns; index++)
+            {
+                values_[index] = static_cast<T>(other.values_[index]);
+            }
+        }
+
+        // From a dynamic matrix of the same shape
+        explicit Matrix(const Matrix<T> &other) : values_()
+        {
+            if (other.rows() != Rows || other.columns() != Columns)
+            {
+                throw std::invalid_argument("Matrix has an invalid shape.");
+            }
+
+            for (size_t index = 0; index < Rows * Columns; index++)
+            {
+                values_[index] = other.coefficient(index);
+            }
+        }
+
+        // To a dynamic matrix
+        explicit operator Matrix<T>() const
+        {
+            Matrix<T> result(Rows, Columns);
+            for (size_t index = 0; index < Rows * Columns; index++)
+            {
+                result.data()[index] = values_[index];
+            }
+            return result;
+        }
+
+        static constexpr Matrix Identity()
+        {
+            static_assert(Rows == Columns, "Identity matrix has to be square.");
+
+            Matrix result;
+            for (size_t index = 0; index < Rows; index++)
+            {
+                result.values_[index * Columns + index] = T(1);
+            }
+            return result;
+        }
+
+        constexpr T *data() noexcept
+        {
+            return values_.data();
+        }
+
+        constexpr const T *data() const noexcept
+        {
+            return values_.data();
+        }
+
+        // Element access without bounds checking
+        constexpr T &operator()(const size_t &row, const size_t &column)
+        {
+            return values_[row * Columns + column];
+        }
+
+        constexpr const T &operator()(const size_t &row, const size_t &column) const
+        {
+            return values_[row * Columns + column];
+        }
+
+        constexpr T at(const size_t &row, const size_t &column) const
+        {
+            if (Rows <= row)
+            {
+                throw std::out_of_range("Row index out of range.");
+            }
+
+            if (Columns <= column)
+            {
+                throw std::out_of_range("Column index out of range.");
+            }
+
+            return values_[row * Columns + column];
+        }
+
+        constexpr Matrix operator+() const
+        {
+            return *this;
+        }
+
+        constexpr Matrix operator-() const
+        {
+            Matrix result;
+            for (size_t index = 0; index < Rows * Columns; index++)
+            {
+                result.values_[index] = -values_[index];
+            }
+            return result;
+        }
+
+        // Matrix addition
+        constexpr Matrix operator+(const Matrix &other) const
+        {
+            Matrix result;
+            for (size_t index = 0; index < Rows * Columns; index++)
+            {
+                result.values_[index] = values_[index] + other.values_[index];
+            }
+            return result;
+        }
+
+        // Matrix subtraction
+        constexpr Matrix operator-(const Matrix &other) const
+        {
+            Matrix result;
+            for (size_t index = 0; index < Rows * Columns; index++)
+            {
+                result.values_[index] = values_[index] - other.values_[index];
+            }
+            return result;
+        }
+
+        // Matrix-scalar multiplication
+        constexpr Matrix operator*(const T &scalar) const
+        {
+            Matrix result;
+            for (size_t index = 0; index < Rows * Columns; index++)
+            {
+                result.values_[index] = values_[index] * scalar;
+            }
+            return result;
+        }
+
+        friend constexpr Matrix operator*(const T &scalar, const Matrix &matrix)
+        {
+            return matrix * scalar;
+        }
+
+        // Matrix division by scalar
+        constexpr Matrix operator/(const T &scalar) const
+        {
+            Matrix result;
+            for (size_t index = 0; index < Rows * Columns; index++)
+            {
+                result.values_[index] = values_[index] / scalar;
+            }
+            return result;
+        }
+
+        // Matrix-matrix multiplication, the inner dot products are expanded at compile time
+        template <size_t K>
+        constexpr Matrix<T, Rows, K> operator*(const Matrix<T, Columns, K> &other) const
+        {
+            Matrix<T, Rows, K> result;
+            for (size_t row = 0; row < Rows; row++)
+            {
+                for (size_t column = 0; column < K; column++)
+                {
+                    result.values_[row * K + column] =
+                        RowColumnProduct(*this, other, row, column, std::make_index_sequence<Columns>());
+                }
+            }
+            return result;
+        }
+
+        constexpr Matrix &operator+=(const Matrix &other)
+        {
+            return *this = *this + other;
+        }
+
+        constexpr Matrix &operator-=(const Matrix &other)
+        {
+            return *this = *this - other;
+        }
+
+        constexpr Matrix &operator*=(const T &scalar)
+        {
+            return *this = *this * scalar;
+        }
+
+        constexpr bool operator==(const Matrix &other) const
+        {
+            for (size_t index = 0; index < Rows * Columns; index++)
+            {
+                if (values_[index] != other.values_[index])
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        constexpr bool operator!=(const Matrix &other) const
+        {
+            return !(*this == other);
+        }
+
+        constexpr Matrix<T, Columns, Rows> Transpose() const
+        {
+            Matrix<T, Columns, Rows> result;
+            for (size_t row = 0; row < Rows; row++)
+            {
+                for (size_t column = 0; column < Columns; column++)
+                {
+                    result.values_[column * Rows + row] = values_[row * Columns + column];
+                }
+            }
+            return result;
+        }
+
+        // Closed form up to 3 x 3, Gaussian elimination with partial pivoting above
+        constexpr T Determinant() const
+        {
+            static_assert(Rows == Columns, "Determinant is defined for square matrices only.");
+
+            const Matrix &m = *this;
+            if constexpr (Rows == 1)
+            {
+                return m(0, 0);
+            }
+            else if constexpr (Rows == 2)
+            {
+                return m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0);
+            }
+            else if constexpr (Rows == 3)
+            {
+                return m(0, 0) * (m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1)) -
+                       m(0, 1) * (m(1, 0) * m(2, 2) - m(1, 2) * m(2, 0)) +
+                       m(0, 2) * (m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0));
+            }
+            else
+            {
+                Matrix lu = *this;
+                T determinant = T(1);
+                for (size_t j = 0; j < Rows; j++)
+                {
+                    size_t pivot = j;
+                    for (size_t i = j + 1; i < Rows; i++)
+                    {
+                        const T candidate = lu(i, j) < T() ? -lu(i, j) : lu(i, j);
+                        const T best = lu(pivot, j) < T() ? -lu(pivot, j) : lu(pivot, j);
+                        if (candidate > best)
+                        {
+                            pivot = i;
+                        }
+                    }
+                    if (lu(pivot, j) == T())
+                    {
+                        return T();
+                    }
+                    if (pivot != j)
+                    {
+                        for (size_t k = 0; k < Columns; k++)
+                        {
+                            const T swap = lu(j, k);
+                            lu(j, k) = lu(pivot, k);
+                            lu(pivot, k) = swap;
+                        }
+                        determinant = -determinant;
+                    }
+                    determinant *= lu(j, j);
+                    for (size_t i = j + 1; i < Rows; i++)
+                    {
+                        const T multiplier = lu(i, j) / lu(j, j);
+                        for (size_t k = j + 1; k < Columns; k++)
+                        {
+                            lu(i, k) -= multiplier * lu(j, k);
+                        }
+                    }
+                }
+                return determinant;
+            }
+        }
+
+        // Adjugate formula up to 3 x 3, Gauss-Jordan elimination with partial pivoting above
+        constexpr Matrix Inverse() const
+        {
+            static_assert(Rows == Columns, "Inverse is defined for square matrices only.");
+
+            const Matrix &m = *this;
+            if constexpr (Rows <= 3)
+            {
+                const T determinant = Determinant();
+                if (determinant == T())
+                {
+                    throw std::runtime_error("Matrix is singular.");
+                }
+
+                Matrix result;
+                if constexpr (Rows == 1)
+                {
+                    result(0, 0) = T(1) / m(0, 0);
+                }
+                else if constexpr (Rows == 2)
+                {
+                    result(0, 0) = m(1, 1) / determinant;
+                    result(0, 1) = -m(0, 1) / determinant;
+                    result(1, 0) = -m(1, 0) / determinant;
+                    result(1, 1) = m(0, 0) / determinant;
+                }
+                else
+                {
+                    result(0, 0) = (m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1)) / determinant;
+                    result(0, 1) = (m(0, 2) * m(2, 1) - m(0, 1) * m(2, 2)) / determinant;
+                    result(0, 2) = (m(0, 1) * m(1, 2) - m(0, 2) * m(1, 1)) / determinant;
+                    result(1, 0) = (m(1, 2) * m(2, 0) - m(1, 0) * m(2, 2)) / determinant;
+                    result(1, 1) = (m(0, 0) * m(2, 2) - m(0, 2) * m(2, 0)) / determinant;
+                    result(1, 2) = (m(0, 2) * m(1, 0) - m(0, 0) * m(1, 2)) / determinant;
+                    result(2, 0) = (m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0)) / determinant;
+                    result(2, 1) = (m(0, 1) * m(2, 0) - m(0, 0) * m(2, 1)) / determinant;
+                    result(2, 2) = (m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0)) / determinant;
+                }
+                return result;
+            }
+            else
+            {
+                Matrix left = *this;
+                Matrix result = Identity();
+                for (size_t j = 0; j < Rows; j++)
+                {
+                    size_t pivot = j;
+                    for (size_t i = j + 1; i < Rows; i++)
+                    {
+                        const T candidate = left(i, j) < T() ? -left(i, j) : left(i, j);
+                        const T best = left(pivot, j) < T() ? -left(pivot, j) : left(pivot, j);
+                        if (candidate > best)
+                        {
+                            pivot = i;
+                        }
+                    }
+                    if (left(pivot, j) == T())
+                    {
+                        throw std::runtime_error("Matrix is singular.");
+                    }
+                    for (size_t k = 0; k < Columns; k++)
+                    {
+                        const T swapLeft = left(j, k);
+                        left(j, k) = left(pivot, k);
+                        left(pivot, k) = swapLeft;
+                        const T swapResult = result(j, k);
+                        result(j, k) = result(pivot, k);
+                        result(pivot, k) = swapResult;
+                    }
+
+                    const T diagonal = left(j, j);
+                    for (size_t k = 0; k < Columns; k++)
+                    {
+                        left(j, k) /= diagonal;
+                        result(j, k) /= diagonal;
+                    }
+                    for (size_t i = 0; i < Rows; i++)
+                    {
+                        if (i == j)
+                        {
+                            continue;
+                        }
+                        const T multiplier = left(i, j);
+                        for (size_t k = 0; k < Columns; k++)
+                        {
+                            left(i, k) -= multiplier * left(j, k);
+                            result(i, k) -= multiplier * result(j, k);
+                        }
+                    }
+                }
+                return result;
+            }
+        }
+
+        // Prints the contents of the matrix to console
+        friend std::ostream &operator<<(std::ostream &os, const Matrix &matrix)
+        {
+            return os << MatrixView<const T>(matrix.values_.data(), Rows, Columns, Columns);
+        }
+    };
+
+    template <typename T>
+    using Matrix2 = Matrix<T, 2, 2>;
+
+    template <typename T>
+    using Matrix3 = Matrix<T, 3, 3>;
+
+    template <typename T>
+    using Matrix4 = Matrix<T, 4, 4>;
+}
+
+#endif
+
+// MATHEMANIA_FIXED_MATRIX_H_
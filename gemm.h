@@ -0,0 +1,447 @@
+#ifndef MATHEMANIA_GEMM_H_
+#define MATHEMANIA_GEMM_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "simd.h"
+#include "thread_pool.h"
+
+namespace linal
+{
+    namespace kernels
+    {
+        // Blocking parameters of the packed GEMM.
+        // MR x NR is the register tile, MC x KC is the block of A kept in L2,
+        // KC x NR is the sliver of B streamed through L1, NC bounds the packed B panel.
+        template <typename T>
+        struct GemmBlocking
+        {
+            static constexpr size_t MR = 4;
+            static constexpr size_t NR = 4;
+            static constexpr size_t MC = 64;
+            static constexpr size_t KC = 128;
+            static constexpr size_t NC = 1024;
+        };
+
+        template <>
+        struct GemmBlocking<float>
+        {
+            static constexpr size_t MR = 6;
+            static constexpr size_t NR = 16;
+            static constexpr size_t MC = 144;
+            static constexpr size_t KC = 256;
+            static constexpr size_t NC = 4096;
+        };
+
+        template <>
+        struct GemmBlocking<double>
+        {
+            static constexpr size_t MR = 6;
+            static constexpr size_t NR = 8;
+            static constexpr size_t MC = 96;
+            static constexpr size_t KC = 256;
+            static constexpr size_t NC = 2048;
+        };
+
+        // Below this many multiply-adds packing costs more than it saves
+        constexpr size_t GEMM_SMALL_SIZE = 32 * 32 * 32;
+
+        // Below this many multiply-adds the product is not split across threads
+        constexpr size_t GEMM_PARALLEL_SIZE = 128 * 128 * 128;
+
+        // Packing buffers are reused by every product run on the same thread
+        template <typename T>
+        T *GemmBuffer(const size_t &index, const size_t &size)
+        {
+            thread_local std::vector<T> buffers[2];
+            if (buffers[index].size() < size)
+            {
+                buffers[index].resize(size);
+            }
+            return buffers[index].data();
+        }
+
+        // Packs an mc x kc block of row-major alpha * A into MR-row slivers, column by column.
+        // Rows past mc are padded with zeros so that the micro-kernel never branches.
+        template <typename T>
+        void PackA(const size_t &mc, const size_t &kc, const T *a, const size_t &lda, const T &alpha, T *packed)
+        {
+            constexpr size_t MR = GemmBlocking<T>::MR;
+
+            for (size_t i = 0; i < mc; i += MR)
+            {
+                const size_t rows = std::min(MR, mc - i);
+                for (size_t p = 0; p < kc; p++)
+                {
+                    for (size_t r = 0; r < rows; r++)
+                    {
+                        packed[r] = alpha * a[(i + r) * lda + p];
+                    }
+                    for (size_t r = rows; r < MR; r++)
+                    {
+                        packed[r] = T();
+                    }
+                    packed += MR;
+                }
+            }
+        }
+
+        // Packs a kc x nc block of row-major B into NR-column slivers, row by row.
+        template <typename T>
+        void PackB(const size_t &kc, const size_t &nc, const T *b, const size_t &ldb, T *packed)
+        {
+            constexpr size_t NR = GemmBlocking<T>::NR;
+
+            for (size_t j = 0; j < nc; j += NR)
+            {
+                const size_t columns = std::min(NR, nc - j);
+                for (size_t p = 0; p < kc; p++)
+                {
+                    const T *row = b + p * ldb + j;
+                    for (size_t c = 0; c < columns; c++)
+                    {
+                        packed[c] = row[c];
+                    }
+                    for (size_t c = columns; c < NR; c++)
+                    {
+                        packed[c] = T();
+                    }
+                    packed += NR;
+                }
+            }
+        }
+
+        // Computes an MR x NR tile of C (+)= A_sliver * B_sliver.
+        // Only the top-left mr x nr corner is written back.
+        template <typename T>
+        struct MicroKernel
+        {
+            static void Run(const size_t &kc, const T *a, const T *b, T *c, const size_t &ldc,
+                            const size_t &mr, const size_t &nr, const bool &accumulate)
+            {
+                constexpr size_t MR = GemmBlocking<T>::MR;
+                constexpr size_t NR = GemmBlocking<T>::NR;
+
+                T tile[MR][NR] = {};
+                for (size_t p = 0; p < kc; p++)
+                {
+                    for (size_t i = 0; i < MR; i++)
+                    {
+                        const T value = a[i];
+                        for (size_t j = 0; j < NR; j++)
+                        {
+                            tile[i][j] += value * b[j];
+                        }
+                    }
+                    a += MR;
+                    b += NR;
+                }
+
+                for (size_t i = 0; i < mr; i++)
+                {
+                    for (size_t j = 0; j < nr; j++)
+                    {
+                        c[i * ldc + j] = accumulate ? c[i * ldc + j] + tile[i][j] : tile[i][j];
+                    }
+                }
+            }
+        };
+
+#ifdef MATHEMANIA_X86_DISPATCH
+        namespace avx2
+        {
+            // 6 x 16 float tile held in twelve ymm accumulators
+            __attribute__((target("avx2,fma"))) inline void GemmMicroKernel(const size_t &kc, const float *a, const float *b,
+                                                                            float *c, const size_t &ldc, const size_t &mr,
+                                                                            const size_t &nr, const bool &accumulate)
+            {
+                __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+                __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+                __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+                __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+                __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+                __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+
+                for (size_t p = 0; p < kc; p++)
+                {
+                    const __m256 b0 = _mm256_loadu_ps(b);
+                    const __m256 b1 = _mm256_loadu_ps(b + 8);
+                    __m256 value;
+
+                    value = _mm256_broadcast_ss(a + 0);
+                    c00 = _mm256_fmadd_ps(value, b0, c00);
+                    c01 = _mm256_fmadd_ps(value, b1, c01);
+                    value = _mm256_broadcast_ss(a + 1);
+                    c10 = _mm256_fmadd_ps(value, b0, c10);
+                    c11 = _mm256_fmadd_ps(value, b1, c11);
+                    value = _mm256_broadcast_ss(a + 2);
+                    c20 = _mm256_fmadd_ps(value, b0, c20);
+                    c21 = _mm256_fmadd_ps(value, b1, c21);
+                    value = _mm256_broadcast_ss(a + 3);
+                    c30 = _mm256_fmadd_ps(value, b0, c30);
+                    c31 = _mm256_fmadd_ps(value, b1, c31);
+                    value = _mm256_broadcast_ss(a + 4);
+                    c40 = _mm256_fmadd_ps(value, b0, c40);
+                    c41 = _mm256_fmadd_ps(value, b1, c41);
+                    value = _mm256_broadcast_ss(a + 5);
+                    c50 = _mm256_fmadd_ps(value, b0, c50);
+                    c51 = _mm256_fmadd_ps(value, b1, c51);
+
+                    a += 6;
+                    b += 16;
+                }
+
+                alignas(32) float tile[6][16];
+                _mm256_store_ps(tile[0], c00), _mm256_store_ps(tile[0] + 8, c01);
+                _mm256_store_ps(tile[1], c10), _mm256_store_ps(tile[1] + 8, c11);
+                _mm256_store_ps(tile[2], c20), _mm256_store_ps(tile[2] + 8, c21);
+                _mm256_store_ps(tile[3], c30), _mm256_store_ps(tile[3] + 8, c31);
+                _mm256_store_ps(tile[4], c40), _mm256_store_ps(tile[4] + 8, c41);
+                _mm256_store_ps(tile[5], c50), _mm256_store_ps(tile[5] + 8, c51);
+
+                for (size_t i = 0; i < mr; i++)
+                {
+                    for (size_t j = 0; j < nr; j++)
+                    {
+                        c[i * ldc + j] = accumulate ? c[i * ldc + j] + tile[i][j] : tile[i][j];
+                    }
+                }
+            }
+
+            // 6 x 8 double tile held in twelve ymm accumulators
+            __attribute__((target("avx2,fma"))) inline void GemmMicroKernel(const size_t &kc, const double *a, const double *b,
+                                                                            double *c, const size_t &ldc, const size_t &mr,
+                                                                            const size_t &nr, const bool &accumulate)
+            {
+                __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+                __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+                __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+                __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+                __m256d c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+                __m256d c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+
+                for (size_t p = 0; p < kc; p++)
+                {
+                    const __m256d b0 = _mm256_loadu_pd(b);
+                    const __m256d b1 = _mm256_loadu_pd(b + 4);
+                    __m256d value;
+
+                    value = _mm256_broadcast_sd(a + 0);
+                    c00 = _mm256_fmadd_pd(value, b0, c00);
+                    c01 = _mm256_fmadd_pd(value, b1, c01);
+                    value = _mm256_broadcast_sd(a + 1);
+                    c10 = _mm256_fmadd_pd(value, b0, c10);
+                    c11 = _mm256_fmadd_pd(value, b1, c11);
+                    value = _mm256_broadcast_sd(a + 2);
+                    c20 = _mm256_fmadd_pd(value, b0, c20);
+                    c21 = _mm256_fmadd_pd(value, b1, c21);
+                    value = _mm256_broadcast_sd(a + 3);
+                    c30 = _mm256_fmadd_pd(value, b0, c30);
+                    c31 = _mm256_fmadd_pd(value, b1, c31);
+                    value = _mm256_broadcast_sd(a + 4);
+                    c40 = _mm256_fmadd_pd(value, b0, c40);
+                    c41 = _mm256_fmadd_pd(value, b1, c41);
+                    value = _mm256_broadcast_sd(a + 5);
+                    c50 = _mm256_fmadd_pd(value, b0, c50);
+                    c51 = _mm256_fmadd_pd(value, b1, c51);
+
+                    a += 6;
+                    b += 8;
+                }
+
+                alignas(32) double tile[6][8];
+                _mm256_store_pd(tile[0], c00), _mm256_store_pd(tile[0] + 4, c01);
+                _mm256_store_pd(tile[1], c10), _mm256_store_pd(tile[1] + 4, c11);
+                _mm256_store_pd(tile[2], c20), _mm256_store_pd(tile[2] + 4, c21);
+                _mm256_store_pd(tile[3], c30), _mm256_store_pd(tile[3] + 4, c31);
+                _mm256_store_pd(tile[4], c40), _mm256_store_pd(tile[4] + 4, c41);
+                _mm256_store_pd(tile[5], c50), _mm256_store_pd(tile[5] + 4, c51);
+
+                for (size_t i = 0; i < mr; i++)
+                {
+                    for (size_t j = 0; j < nr; j++)
+                    {
+                        c[i * ldc + j] = accumulate ? c[i * ldc + j] + tile[i][j] : tile[i][j];
+                    }
+                }
+            }
+        }
+#endif
+
+        template <typename T>
+        using MicroKernelFunction = void (*)(const size_t &, const T *, const T *, T *, const size_t &,
+                                             const size_t &, const size_t &, const bool &);
+
+        // Micro-kernel for T on the running CPU, picked once like the VectorKernels tables
+        template <typename T>
+        MicroKernelFunction<T> SelectMicroKernel()
+        {
+            static const MicroKernelFunction<T> kernel = []
+            {
+                MicroKernelFunction<T> result = MicroKernel<T>::Run;
+#ifdef MATHEMANIA_X86_DISPATCH
+                if constexpr (IsVectorizable<T>)
+                {
+                    if (CpuFeatures::Detect().avx2)
+                    {
+                        result = avx2::GemmMicroKernel;
+                    }
+                }
+#endif
+                return result;
+            }();
+            return kernel;
+        }
+
+        // Plain i-k-j product for matrices too small to be worth packing
+        template <typename T>
+        void GemmSmall(const size_t &m, const size_t &n, const size_t &k,
+                       const T *a, const size_t &lda, const T *b, const size_t &ldb, T *c, const size_t &ldc,
+                       const T &alpha, const bool &accumulate)
+        {
+            for (size_t i = 0; i < m; i++)
+            {
+                T *row = c + i * ldc;
+                if (!accumulate)
+                {
+                    for (size_t j = 0; j < n; j++)
+                    {
+                        row[j] = T();
+                    }
+                }
+                for (size_t p = 0; p < k; p++)
+                {
+                    const T value = alpha * a[i * lda + p];
+                    const T *other = b + p * ldb;
+                    for (size_t j = 0; j < n; j++)
+                    {
+                        row[j] += value * other[j];
+                    }
+                }
+            }
+        }
+
+        // Multiplies the packed kc-deep A block by the packed B panel into an mc x nc block of C
+        template <typename T>
+        void GemmMacroKernel(const size_t &mc, const size_t &nc, const size_t &kc,
+                             const T *packedA, const T *packedB, T *c, const size_t &ldc, const bool &accumulate)
+        {
+            constexpr size_t MR = GemmBlocking<T>::MR;
+            constexpr size_t NR = GemmBlocking<T>::NR;
+            const MicroKernelFunction<T> kernel = SelectMicroKernel<T>();
+
+            for (size_t jr = 0; jr < nc; jr += NR)
+            {
+                const size_t nr = std::min(NR, nc - jr);
+                for (size_t ir = 0; ir < mc; ir += MR)
+                {
+                    const size_t mr = std::min(MR, mc - ir);
+                    kernel(kc, packedA + ir * kc, packedB + jr * kc, c + ir * ldc + jr, ldc, mr, nr, accumulate);
+                }
+            }
+        }
+
+        // C = alpha * A * B, or C += alpha * A * B when accumulating, for row-major
+        // operands with leading dimensions lda, ldb and ldc.
+        // A is m x k, B is k x n, C is m x n.
+        template <typename T>
+        void Gemm(const size_t &m, const size_t &n, const size_t &k,
+                  const T *a, const size_t &lda, const T *b, const size_t &ldb, T *c, const size_t &ldc,
+                  const T &alpha = T(1), const bool &accumulate = false)
+        {
+            if (m == 0 || n == 0)
+            {
+                return;
+            }
+
+            if (k == 0 || m * n * k <= GEMM_SMALL_SIZE)
+            {
+                GemmSmall(m, n, k, a, lda, b, ldb, c, ldc, alpha, accumulate);
+                return;
+            }
+
+            constexpr size_t NR = GemmBlocking<T>::NR;
+            constexpr size_t MC = GemmBlocking<T>::MC;
+            constexpr size_t KC = GemmBlocking<T>::KC;
+            constexpr size_t NC = GemmBlocking<T>::NC;
+
+            T *packedA = GemmBuffer<T>(0, MC * KC);
+            T *packedB = GemmBuffer<T>(1, std::min(NC, (n + NR - 1) / NR * NR) * KC);
+
+            for (size_t jc = 0; jc < n; jc += NC)
+            {
+                const size_t nc = std::min(NC, n - jc);
+                for (size_t pc = 0; pc < k; pc += KC)
+                {
+                    const size_t kc = std::min(KC, k - pc);
+                    PackB(kc, nc, b + pc * ldb + jc, ldb, packedB);
+
+                    for (size_t ic = 0; ic < m; ic += MC)
+                    {
+                        const size_t mc = std::min(MC, m - ic);
+                        PackA(mc, kc, a + ic * lda + pc, lda, alpha, packedA);
+                        GemmMacroKernel(mc, nc, kc, packedA, packedB,
+                                        c + ic * ldc + jc, ldc, accumulate || pc != 0);
+                    }
+                }
+            }
+        }
+
+        // Gemm split into macro-tiles of C that the thread pool hands out
+        // through its work-stealing deques. Each tile is an independent blocked
+        // product, so tall, wide and square shapes all yield enough tasks.
+        template <typename T>
+        void ParallelGemm(const size_t &m, const size_t &n, const size_t &k,
+                          const T *a, const size_t &lda, const T *b, const size_t &ldb, T *c, const size_t &ldc,
+                          const T &alpha = T(1), const bool &accumulate = false)
+        {
+            ThreadPool &pool = ThreadPool::Instance();
+            if (pool.size() == 1 || m * n * k <= GEMM_PARALLEL_SIZE)
+            {
+                Gemm(m, n, k, a, lda, b, ldb, c, ldc, alpha, accumulate);
+                return;
+            }
+
+            constexpr size_t MR = GemmBlocking<T>::MR;
+            constexpr size_t NR = GemmBlocking<T>::NR;
+            constexpr size_t MC = GemmBlocking<T>::MC;
+
+            // Start from tiles that amortize packing well and halve the longer
+            // side until every thread can expect several tiles
+            size_t tileRows = std::min(m, 2 * MC);
+            size_t tileColumns = std::min(n, size_t(1024));
+            const size_t wanted = 4 * pool.size();
+            while ((m + tileRows - 1) / tileRows * ((n + tileColumns - 1) / tileColumns) < wanted)
+            {
+                if (tileRows >= tileColumns && tileRows > MR)
+                {
+                    tileRows = std::max(MR, (tileRows / 2 + MR - 1) / MR * MR);
+                }
+                else if (tileColumns > NR)
+                {
+                    tileColumns = std::max(NR, (tileColumns / 2 + NR - 1) / NR * NR);
+                }
+                else
+                {
+                    break;
+                }
+            }
+
+            const size_t rowTiles = (m + tileRows - 1) / tileRows;
+            const size_t columnTiles = (n + tileColumns - 1) / tileColumns;
+
+            pool.ParallelFor(rowTiles * columnTiles, [&](size_t task)
+                             {
+                                 const size_t i = task / columnTiles * tileRows;
+                                 const size_t j = task % columnTiles * tileColumns;
+                                 Gemm(std::min(tileRows, m - i), std::min(tileColumns, n - j), k,
+                                      a + i * lda, lda, b + j, ldb, c + i * ldc + j, ldc, alpha, accumulate); });
+        }
+    }
+}
+
+#endif
+
+// MATHEMANIA_GEMM_H_
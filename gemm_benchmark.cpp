@@ -0,0 +1,43 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "benchmark.h"
+#include "matrix.h"
+
+// Times C = A * B for an (m, k) x (k, n) product and returns GFLOP/s
+double Benchmark(const size_t &m, const size_t &n, const size_t &k, const int &repetitions)
+{
+    std::vector<float> a(m * k, 1.0f), b(k * n, 0.5f), c(m * n);
+
+    linal::kernels::ParallelGemm(m, n, k, a.data(), k, b.data(), n, c.data(), n);
+
+    const double milliseconds = Time(repetitions, [&]
+                                     { linal::kernels::ParallelGemm(m, n, k, a.data(), k, b.data(), n, c.data(), n); });
+
+    return 2.0 * m * n * k / milliseconds / 1e6;
+}
+
+int main()
+{
+    const size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    const size_t shapes[][3] = {{1024, 1024, 1024}, {2048, 2048, 2048}, {20000, 20000, 64}};
+
+    std::vector<size_t> threadCounts;
+    for (size_t threads = 1; threads < hardware; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(hardware);
+
+    for (const auto &shape : shapes)
+    {
+        std::cout << shape[0] << "x" << shape[2] << " * " << shape[2] << "x" << shape[1] << "\n";
+        for (const size_t &threads : threadCounts)
+        {
+            linal::SetThreadCount(threads);
+            std::cout << "  threads = " << threads << " : " << Benchmark(shape[0], shape[1], shape[2], 3) << " GFLOP/s\n";
+        }
+    }
+
+    return 0;
+}
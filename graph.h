@@ -1,11 +1,15 @@
 #pragma once
 
 #include "matrix.h"
-#include <fstream>
+#include "graph_file.h"
+#include "graph_storage.h"
+#include "node_index.h"
+#include <type_traits>
 #include <vector>
 #include <list>
-#include <map>
 #include <set>
+#include <string>
+#include <utility>
 
 template <typename TNode>
 class Node
@@ -43,45 +47,130 @@ struct NodeCompare
     }
 };
 
-template <typename TNode, typename EdgeWeight>
+namespace detail
+{
+    template <typename Storage, typename = void>
+    struct HasView : std::false_type
+    {
+    };
+
+    template <typename Storage>
+    struct HasView<Storage, std::void_t<decltype(std::declval<const Storage &>().view())>> : std::true_type
+    {
+    };
+}
+
+// Storage selects how edges are kept (see graph_storage.h): DenseStorage is an
+// adjacency matrix for small, dense graphs, CsrStorage keeps compressed rows and
+// columns in O(V + E) memory for large, sparse ones, and BitsetStorage packs the
+// edges of unweighted graphs 64 to a word.
+//
+// Nodes are kept in a flat hash index (see node_index.h) that hands out dense
+// NodeId handles. The NodeId overloads skip the hash lookup entirely and are
+// the ones to use on hot paths.
+template <typename TNode, typename EdgeWeight, typename Storage = DenseStorage<EdgeWeight>>
 class Graph
 {
 protected:
-    std::map<Node<TNode>, size_t, NodeCompare<TNode>> graphNodes;
-    Matrix<EdgeWeight> adjacencyMatrix;
+    NodeIndex<TNode> graphNodes;
+    Storage adjacency;
 
-public:
-    size_t size() const
+    // Id of a node that has to be in the graph
+    NodeId require(const Node<TNode> &node) const
     {
-        return graphNodes.size();
+        const NodeId id = graphNodes.find(node);
+        if (!id)
+        {
+            throw std::invalid_argument("Node does not exist within the graph.");
+        }
+        return id;
     }
 
-    size_t Edges() const
+    template <typename Container>
+    void assign(const Container &nodes, const linal::Matrix<EdgeWeight> &matrix)
     {
-        size_t count = 0;
-        for (auto i : adjacencyMatrix)
+        if (!matrix.square())
+        {
+            throw std::invalid_argument("Adjacency matrix has to have an equal number of rows and columns.");
+        }
+        if (nodes.size() != matrix.rows())
+        {
+            throw std::invalid_argument(
+                "Dimensions of the adjacency matrix should be equal to the number of vertices.");
+        }
+        graphNodes.reserve(nodes.size());
+        for (const auto &node : nodes)
         {
-            if (i > 0)
+            if (!graphNodes.insert(node).second)
             {
-                count++;
+                throw std::invalid_argument("Nodes have to be unique.");
             }
         }
-        return count;
+        adjacency = Storage(matrix);
     }
 
-    set<Node<TNode>, NodeCompare<TNode>> Nodes()
+    // Storage holding the edges of a view, copied array by array when the storage
+    // has the same layout
+    template <typename View>
+    static Storage convert(const View &view)
     {
-        set<Node<TNode>, NodeCompare<TNode>> s;
-        for (auto i : graphNodes)
+        if constexpr (std::is_constructible_v<Storage, const View &>)
         {
-            s.insert(i.first);
+            return Storage(view);
         }
-        return s;
+        else
+        {
+            std::vector<typename Storage::Edge> batch;
+            for (size_t from = 0; from < view.size(); ++from)
+            {
+                view.for_each_out(from, [&](const size_t &to, const EdgeWeight &weight)
+                                  { batch.push_back({from, to, weight}); });
+            }
+            Storage storage;
+            storage.add_nodes(view.size());
+            storage.insert_edges(batch);
+            return storage;
+        }
+    }
+
+public:
+    using storage_type = Storage;
+
+    size_t size() const
+    {
+        return graphNodes.size();
+    }
+
+    size_t Edges() const
+    {
+        return adjacency.edges();
+    }
+
+    std::set<Node<TNode>, NodeCompare<TNode>> Nodes()
+    {
+        return std::set<Node<TNode>, NodeCompare<TNode>>(graphNodes.begin(), graphNodes.end());
+    }
+
+    linal::Matrix<EdgeWeight> AdjacencyMatrix() const
+    {
+        return adjacency.matrix();
     }
 
-    Matrix<EdgeWeight> AdjacencyMatrix() const
+    // Edge structure indexed by NodeId, for algorithms that walk the whole graph
+    const Storage &storage() const noexcept
     {
-        return adjacencyMatrix;
+        return adjacency;
+    }
+
+    // Id of the node, invalid if it is not in the graph
+    NodeId find(const Node<TNode> &node) const
+    {
+        return graphNodes.find(node);
+    }
+
+    const Node<TNode> &node(const NodeId &id) const
+    {
+        return graphNodes.node(id);
     }
 
     // 3. Основной интрефейс -- начало
@@ -93,14 +182,14 @@ public:
     void clear()
     {
         graphNodes.clear();
-        adjacencyMatrix.clear();
+        adjacency.clear();
     }
 
+    // Exchanges the contents in O(1), nothing is copied
     void swap(Graph &other)
     {
-        Graph tmp = *this;
-        *this = other;
-        other = tmp;
+        graphNodes.swap(other.graphNodes);
+        adjacency.swap(other.adjacency);
     }
     // 3. Основной интрефейс -- конец
 
@@ -109,90 +198,41 @@ public:
     Graph() = default;
 
     // Constructor from vector
-    Graph(const vector<Node<TNode>> &nodes, const Matrix<EdgeWeight> &matrix)
+    Graph(const std::vector<Node<TNode>> &nodes, const linal::Matrix<EdgeWeight> &matrix)
     {
-        if (!matrix.square())
-        {
-            throw std::invalid_argument("Adjacency matrix has to have equal number of rows and columns.");
-        }
-        if (nodes.size() != matrix.rows())
-        {
-            throw std::invalid_argument(
-                "Dimensions of the adjacency matrix should be equal to the number of vertices.");
-        }
-        size_t index = 0;
-        for (auto i : nodes)
-        {
-            graphNodes[i] = index;
-            ++index;
-        }
-        adjacencyMatrix = matrix;
+        assign(nodes, matrix);
     }
 
     // Constructor from list
-    Graph(const list<Node<TNode>> &nodes, const Matrix<EdgeWeight> &matrix)
+    Graph(const std::list<Node<TNode>> &nodes, const linal::Matrix<EdgeWeight> &matrix)
     {
-        if (!matrix.square())
-        {
-            throw std::invalid_argument("Adjacency matrix has to have equal number of rows and columns.");
-        }
-        if (nodes.size() != matrix.rows())
-        {
-            throw std::invalid_argument(
-                "Dimensions of the adjacency matrix should be equal to the number of vertices.");
-        }
-        size_t index = 0;
-        for (auto i : nodes)
-        {
-            graphNodes[i] = index;
-            ++index;
-        }
-        adjacencyMatrix = matrix;
+        assign(nodes, matrix);
     }
 
     // Constructor from set
-    Graph(const set<Node<TNode>, NodeCompare<TNode>> &nodes, const Matrix<EdgeWeight> &matrix)
+    Graph(const std::set<Node<TNode>, NodeCompare<TNode>> &nodes, const linal::Matrix<EdgeWeight> &matrix)
     {
-        if (!matrix.square())
-        {
-            throw std::invalid_argument("Adjacency matrix has to have an equal number of rows and columns.");
-        }
-        if (nodes.size() != matrix.rows())
-        {
-            throw std::invalid_argument(
-                "Dimensions of the adjacency matrix should be equal to the number of vertices.");
-        }
-        size_t index = 0;
-        for (auto i : nodes)
-        {
-            graphNodes[i] = index;
-            ++index;
-        }
-        adjacencyMatrix = matrix;
+        assign(nodes, matrix);
     }
 
     // Destructor
     ~Graph() = default;
 
     // Copy Constructor
-    Graph(Graph<TNode, EdgeWeight> &other)
+    Graph(const Graph &other)
     {
         if (this != &other)
         {
             graphNodes = other.graphNodes;
-            adjacencyMatrix = other.adjacencyMatrix;
+            adjacency = other.adjacency;
         }
     }
 
-    // Move Constructor
+    // Move Constructor, takes over the buffers of other in O(1)
     Graph(Graph &&other) noexcept
+        : graphNodes(std::move(other.graphNodes)), adjacency(std::move(other.adjacency))
     {
-        if (this != other)
-        {
-            graphNodes = other.graphNodes;
-            adjacencyMatrix = other.adjacencyMatrix;
-            other.clear();
-        }
+        other.clear();
     }
 
     // Copy Assignment Operator
@@ -201,18 +241,18 @@ public:
         if (this != &other)
         {
             graphNodes = other.graphNodes;
-            adjacencyMatrix = other.adjacencyMatrix;
+            adjacency = other.adjacency;
         }
         return *this;
     }
 
-    // Move Assignment Operator
+    // Move Assignment Operator, takes over the buffers of other in O(1)
     Graph &operator=(Graph &&other) noexcept
     {
         if (this != &other)
         {
-            graphNodes = other.graphNodes;
-            adjacencyMatrix = other.adjacencyMatrix;
+            graphNodes = std::move(other.graphNodes);
+            adjacency = std::move(other.adjacency);
             other.clear();
         }
         return *this;
@@ -220,235 +260,308 @@ public:
     // 2. Конструкторы и операторы присваивания класса Graph -- конец
 
     // 4. Итерирование по графу -- начало
-    auto begin()
+    // Nodes in NodeId order
+    auto begin() const
     {
         return graphNodes.begin();
     }
 
-    auto end()
+    auto end() const
     {
         return graphNodes.end();
     }
 
     auto cbegin() const
     {
-        return graphNodes.cbegin();
+        return graphNodes.begin();
     }
 
     auto cend() const
     {
-        return graphNodes.cend();
+        return graphNodes.end();
     }
     // 4. Итерирование по графу -- конец
 
     // 5. Работа с графом через ключ -- начало
-    size_t degree_in(const Node<TNode> &node)
+    size_t degree_in(const NodeId &id) const
     {
-        size_t count = 0;
-        for (int i = 0; i < size(); ++i)
-        {
-            if (adjacencyMatrix(graphNodes[node], i) > 0)
-            {
-                count++;
-            }
-        }
-        return count;
+        return adjacency.in_degree(id.index());
     }
 
-    size_t degree_out(const Node<TNode> &node)
+    size_t degree_in(const Node<TNode> &node) const
     {
-        size_t count = 0;
-        for (int i = 0; i < size(); ++i)
-        {
-            if (adjacencyMatrix(i, graphNodes[node]) > 0)
-            {
-                count++;
-            }
-        }
-        return count;
+        return degree_in(require(node));
+    }
+
+    size_t degree_out(const NodeId &id) const
+    {
+        return adjacency.out_degree(id.index());
+    }
+
+    size_t degree_out(const Node<TNode> &node) const
+    {
+        return degree_out(require(node));
     }
 
-    bool loop(const Node<TNode> &node)
+    bool loop(const NodeId &id) const
     {
-        return adjacencyMatrix(graphNodes[node], graphNodes[node]) > 0;
+        return adjacency.contains(id.index(), id.index());
+    }
+
+    bool loop(const Node<TNode> &node) const
+    {
+        return loop(require(node));
+    }
+
+    bool contains_edge(const NodeId &from, const NodeId &to) const
+    {
+        return adjacency.contains(from.index(), to.index());
+    }
+
+    // Weight of the edge, zero when there is none
+    EdgeWeight weight(const NodeId &from, const NodeId &to) const
+    {
+        return adjacency.weight(from.index(), to.index());
+    }
+
+    // Calls f(NodeId, weight) for every edge leaving the node, in O(degree) with CSR storage
+    template <typename F>
+    void for_each_out_edge(const NodeId &id, F &&f) const
+    {
+        adjacency.for_each_out(id.index(), [&](const size_t &to, const EdgeWeight &weight)
+                               { return f(NodeId(to), weight); });
+    }
+
+    template <typename F>
+    void for_each_out_edge(const Node<TNode> &node, F &&f) const
+    {
+        for_each_out_edge(require(node), std::forward<F>(f));
+    }
+
+    // Calls f(NodeId, weight) for every edge entering the node, in O(degree) with CSR storage
+    template <typename F>
+    void for_each_in_edge(const NodeId &id, F &&f) const
+    {
+        adjacency.for_each_in(id.index(), [&](const size_t &from, const EdgeWeight &weight)
+                              { return f(NodeId(from), weight); });
+    }
+
+    template <typename F>
+    void for_each_in_edge(const Node<TNode> &node, F &&f) const
+    {
+        for_each_in_edge(require(node), std::forward<F>(f));
     }
     // 5. Работа с графом через ключ -- конец
 
     // 6. Вставка узлов и рёбер в граф -- начало
-    auto insert_node(const Node<TNode> &node)
+    // Returns the id of the node and whether it was inserted
+    std::pair<NodeId, bool> insert_node(const Node<TNode> &node)
     {
-        //        if (&node == nullptr) {
-        //            throw std::invalid_argument("Node does not exist.");
-        //        }
-        if (graphNodes.find(node) != graphNodes.end())
-        {
-            return std::make_pair(graphNodes.end(), false);
-        }
-        Matrix<EdgeWeight> matrix(size() + 1, size() + 1, 0);
-        for (size_t i = 0; i < size(); ++i)
+        auto inserted = graphNodes.insert(node);
+        if (inserted.second)
         {
-            for (size_t j = 0; j < size(); ++j)
-            {
-                matrix(i, j) = adjacencyMatrix(i, j);
-            }
+            adjacency.add_nodes(1);
         }
-        graphNodes[node] = size();
-        adjacencyMatrix = matrix;
-        return std::make_pair(graphNodes.find(node), true);
+        return inserted;
     }
 
-    auto insert_or_assign_node(const Node<TNode> &node)
+    std::pair<NodeId, bool> insert_or_assign_node(const Node<TNode> &node)
     {
-        if (&node == nullptr)
-        {
-            throw std::invalid_argument("Node does not exist.");
-        }
-        auto it = graphNodes.find(node);
-        if (it != graphNodes.end())
-        {
-            return std::make_pair(it, true);
-        }
-        Matrix<EdgeWeight> matrix(size() + 1, size() + 1, 0);
-        for (size_t i = 0; i < size(); ++i)
-        {
-            for (size_t j = 0; j < size(); ++j)
-            {
-                matrix(i, j) = adjacencyMatrix(i, j);
-            }
-        }
-        graphNodes[node] = size();
-        adjacencyMatrix = matrix;
-        return std::make_pair(graphNodes.find(node), true);
+        return std::make_pair(insert_node(node).first, true);
     }
 
-    auto insert_edge(const pair<const Node<TNode> &, const Node<TNode> &> &nodes, const EdgeWeight &weight)
+    // Makes room for n nodes, so that inserting up to n nodes does not reallocate
+    void reserve(const size_t &n)
     {
-        auto fromNode = nodes.first;
-        auto toNode = nodes.second;
-        if (graphNodes.find(fromNode) == graphNodes.end() || graphNodes.find(toNode) == graphNodes.end())
+        graphNodes.reserve(n);
+        adjacency.reserve(n);
+    }
+
+    // Inserts every node of [first, last) that is not in the graph yet, growing the edge
+    // storage once. Returns the number of inserted nodes.
+    template <typename Iterator>
+    size_t insert_nodes(Iterator first, Iterator last)
+    {
+        const size_t before = size();
+        for (; first != last; ++first)
         {
-            throw std::invalid_argument("Node does not exist within the graph.");
+            graphNodes.insert(Node<TNode>(*first));
         }
-        if (adjacencyMatrix(graphNodes[toNode], graphNodes[fromNode]) > 0)
+        adjacency.add_nodes(size() - before);
+        return size() - before;
+    }
+
+    // Inserts the edge unless it exists. Returns the id of the source and whether it was inserted.
+    std::pair<NodeId, bool> insert_edge(const NodeId &from, const NodeId &to, const EdgeWeight &weight)
+    {
+        if (adjacency.contains(from.index(), to.index()))
         {
-            return std::make_pair(graphNodes.end(), false);
+            return std::make_pair(NodeId(), false);
         }
-        adjacencyMatrix(graphNodes[toNode], graphNodes[fromNode]) = weight;
-        return std::make_pair(graphNodes.find(fromNode), true);
+        adjacency.set(from.index(), to.index(), weight);
+        return std::make_pair(from, true);
+    }
+
+    std::pair<NodeId, bool> insert_edge(const std::pair<const Node<TNode> &, const Node<TNode> &> &nodes, const EdgeWeight &weight)
+    {
+        return insert_edge(require(nodes.first), require(nodes.second), weight);
     }
 
-    auto insert_or_assign_edge(const pair<const Node<TNode> &, const Node<TNode> &> &nodes, const EdgeWeight &weight)
+    std::pair<NodeId, bool> insert_or_assign_edge(const NodeId &from, const NodeId &to, const EdgeWeight &weight)
     {
-        auto fromNode = nodes.first;
-        auto toNode = nodes.second;
-        if (graphNodes.find(fromNode) == graphNodes.end() || graphNodes.find(toNode) == graphNodes.end())
+        adjacency.set(from.index(), to.index(), weight);
+        return std::make_pair(from, true);
+    }
+
+    std::pair<NodeId, bool> insert_or_assign_edge(const std::pair<const Node<TNode> &, const Node<TNode> &> &nodes, const EdgeWeight &weight)
+    {
+        return insert_or_assign_edge(require(nodes.first), require(nodes.second), weight);
+    }
+
+    // Inserts or assigns every (from, to, weight) of [first, last) in one batch, later
+    // duplicates win. Throws before changing anything if a node is not in the graph.
+    template <typename Iterator>
+    void insert_or_assign_edges(Iterator first, Iterator last)
+    {
+        std::vector<typename Storage::Edge> batch;
+        for (; first != last; ++first)
         {
-            throw std::invalid_argument("Node does not exist within the graph.");
+            const auto &[fromNode, toNode, weight] = *first;
+            batch.push_back({require(Node<TNode>(fromNode)).index(), require(Node<TNode>(toNode)).index(),
+                             static_cast<EdgeWeight>(weight)});
         }
-        adjacencyMatrix(graphNodes[toNode], graphNodes[fromNode]) = weight;
-        return std::make_pair(graphNodes.find(fromNode), true);
+        adjacency.insert_edges(std::move(batch));
+    }
+
+    // Inserts or assigns a batch of edges between node indices, later duplicates win
+    void insert_or_assign_edges(const std::vector<typename Storage::Edge> &batch)
+    {
+        adjacency.insert_edges(batch);
     }
     // 6. Вставка узлов и рёбер в граф -- конец
 
     // 7. Удаление узлов и рёбер из Graph -- начало
     void clear_edges()
     {
-        adjacencyMatrix = Matrix<EdgeWeight>(size(), size(), 0);
+        adjacency.clear_edges();
+    }
+
+    void erase_edge(const NodeId &from, const NodeId &to)
+    {
+        adjacency.erase(from.index(), to.index());
     }
 
     bool erase_edges_go_from(const Node<TNode> &node)
     {
-        if (graphNodes.find(node) == graphNodes.end())
+        const NodeId id = graphNodes.find(node);
+        if (!id)
         {
             return false;
         }
-        for (int i = 0; i < size(); ++i)
-        {
-            adjacencyMatrix(i, graphNodes[node]) = 0;
-        }
+        adjacency.clear_out(id.index());
         return true;
     }
 
     bool erase_edges_go_to(const Node<TNode> &node)
     {
-        if (graphNodes.find(node) == graphNodes.end())
+        const NodeId id = graphNodes.find(node);
+        if (!id)
         {
             return false;
         }
-        for (int i = 0; i < size(); ++i)
-        {
-            adjacencyMatrix(graphNodes[node], i) = 0;
-        }
+        adjacency.clear_in(id.index());
         return true;
     }
 
+    // Every node after the erased one moves down by one id
     bool erase_node(const Node<TNode> &node)
     {
-        if (graphNodes.find(node) == graphNodes.end())
+        const NodeId id = graphNodes.find(node);
+        if (!id)
         {
             return false;
         }
-        adjacencyMatrix = adjacencyMatrix.Minor(graphNodes[node], graphNodes[node]);
-        for (auto it = graphNodes.find(node); it != graphNodes.end(); it++)
-        {
-            it->second = it->second - 1;
-        }
-        graphNodes.erase(node);
+        adjacency.erase_node(id.index());
+        graphNodes.erase(id);
         return true;
     }
     // 7. Удаление узлов и рёбер из Graph -- конец
 
     // 8. Считывание и запись в файл -- начало
-    bool load_from_file(const string &path)
+    // Reads a binary graph file (see graph_file.h) written for the same node and
+    // weight types. Returns false if the file cannot be opened and throws
+    // std::runtime_error if it is not a valid graph file. Unlike MappedGraph, the
+    // edges are validated, which costs no more than copying them. To work on a
+    // large file without loading it, use MappedGraph directly.
+    bool load_from_file(const std::string &path)
     {
-        std::ifstream ifstream;
-        ifstream.open(path);
-
-        if (!ifstream)
+        MappedGraph<TNode, EdgeWeight> file;
+        if (!file.open(path))
         {
             return false;
         }
+        file.validate_edges();
 
-        size_t n;
-        ifstream >> n;
-        for (size_t i = 0; i < n; ++i)
+        Graph graph;
+        graph.reserve(file.size());
+        if (graph.insert_nodes(file.nodes(), file.nodes() + file.size()) != file.size())
         {
-            TNode tmp;
-            ifstream >> tmp;
-            insert_node(tmp);
+            throw std::invalid_argument("Nodes have to be unique.");
         }
-        ifstream >> adjacencyMatrix;
-        ifstream.close();
+        graph.adjacency = file.layout() == GraphFileLayout::Dense ? convert(file.dense()) : convert(file.csr());
+        swap(graph);
         return true;
     }
 
-    bool save_to_file(const string &path)
+    // Writes a binary graph file with the dense layout for DenseStorage and the CSR
+    // layout for the others. Storages without arrays to write as they are, like
+    // BitsetStorage, are gathered into CSR arrays through their neighbor lists.
+    bool save_to_file(const std::string &path) const
     {
-        std::ofstream ofstream;
-        ofstream.open(path);
-
-        if (!ofstream)
+        std::vector<TNode> nodes;
+        nodes.reserve(size());
+        for (const auto &node : graphNodes)
         {
-            return false;
+            nodes.push_back(node.GetData());
         }
-
-        ofstream << "Nodes contents:\n";
-        for (auto i : graphNodes)
+        if constexpr (detail::HasView<Storage>::value)
         {
-            ofstream << i.first.GetData() << "\n";
+            return WriteGraphFile(path, nodes, adjacency.view());
+        }
+        else
+        {
+            using index_type = typename CsrView<EdgeWeight>::index_type;
+            const size_t n = adjacency.size(), edges = adjacency.edges();
+            std::vector<size_t> outOffsets(n + 1), inOffsets(n + 1);
+            std::vector<index_type> outTargets, inSources;
+            std::vector<EdgeWeight> outWeights, inWeights;
+            outTargets.reserve(edges);
+            outWeights.reserve(edges);
+            inSources.reserve(edges);
+            inWeights.reserve(edges);
+            for (size_t index = 0; index < n; ++index)
+            {
+                adjacency.for_each_out(index, [&](const size_t &to, const EdgeWeight &weight)
+                                       {
+                                           outTargets.push_back(static_cast<index_type>(to));
+                                           outWeights.push_back(weight); });
+                adjacency.for_each_in(index, [&](const size_t &from, const EdgeWeight &weight)
+                                      {
+                                          inSources.push_back(static_cast<index_type>(from));
+                                          inWeights.push_back(weight); });
+                outOffsets[index + 1] = outTargets.size();
+                inOffsets[index + 1] = inSources.size();
+            }
+            return WriteGraphFile(path, nodes,
+                                  CsrView<EdgeWeight>(n, outOffsets.data(), outTargets.data(), outWeights.data(),
+                                                      inOffsets.data(), inSources.data(), inWeights.data()));
         }
-        ofstream << "\nAdjacency matrix:\n";
-        ofstream << adjacencyMatrix;
-        ofstream.close();
-        return true;
     }
     // 8. Считывание и запись в файл -- конец
 };
 
-template <typename TNode, typename EdgeWeight>
-void swap(Graph<TNode, EdgeWeight> &graph1, Graph<TNode, EdgeWeight> &graph2)
+template <typename TNode, typename EdgeWeight, typename Storage>
+void swap(Graph<TNode, EdgeWeight, Storage> &graph1, Graph<TNode, EdgeWeight, Storage> &graph2)
 {
-    Graph<TNode, EdgeWeight> tmp = graph1;
-    graph1 = graph2;
-    graph2 = tmp;
+    graph1.swap(graph2);
 }
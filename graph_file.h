@@ -0,0 +1,583 @@
+#pragma once
+
+#include "graph_storage.h"
+#include "node_index.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MATHEMANIA_HAS_MMAP 1
+#endif
+
+// Binary graph files. A file is a fixed header followed by sections, each at a
+// 64-byte aligned offset recorded in the header:
+//
+//   node table   nodes x TNode, in NodeId order
+//   dense        nodes x nodes EdgeWeight, the adjacency matrix indexed (to, from)
+//   csr          out offsets (nodes + 1 x uint64), out targets (edges x uint32),
+//                out weights (edges x EdgeWeight), then the same for in-edges,
+//                with the arrays laid out exactly as in CsrStorage
+//
+// Values are stored in the byte order of the writer, which the header records, so
+// a reader can use the sections in place: MappedGraph maps the file and hands out
+// views straight into the page cache, without parsing or copying anything.
+// Nodes and weights have to be trivially copyable.
+
+constexpr std::uint32_t GRAPH_FILE_VERSION = 1;
+
+enum class GraphFileLayout : std::uint32_t
+{
+    Dense = 1,
+    Csr = 2
+};
+
+struct GraphFileHeader
+{
+    static constexpr size_t SECTIONS = 7;
+
+    char magic[8];
+    std::uint32_t version;
+    // 0x01020304 as written by the producer, detects foreign byte order
+    std::uint32_t byteOrder;
+    std::uint32_t layout;
+    std::uint32_t nodeType, nodeSize;
+    std::uint32_t weightType, weightSize;
+    std::uint32_t reserved;
+    std::uint64_t nodes, edges;
+    std::uint64_t fileSize;
+    // Byte offsets: node table, then the dense matrix or the six CSR arrays
+    std::uint64_t sections[SECTIONS];
+};
+
+namespace detail
+{
+    constexpr char GRAPH_FILE_MAGIC[8] = {'M', 'T', 'H', 'G', 'R', 'A', 'P', 'H'};
+    constexpr std::uint32_t GRAPH_FILE_BYTE_ORDER = 0x01020304;
+    constexpr std::uint64_t GRAPH_FILE_ALIGNMENT = 64;
+
+    // Coarse type tag so that a file is not read back with a type of the same size
+    // but a different meaning (int vs float)
+    template <typename T>
+    constexpr std::uint32_t TypeTag() noexcept
+    {
+        if constexpr (std::is_floating_point_v<T>)
+        {
+            return 3;
+        }
+        else if constexpr (std::is_signed_v<T>)
+        {
+            return 2;
+        }
+        else if constexpr (std::is_integral_v<T>)
+        {
+            return 1;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+
+    inline std::uint64_t AlignUp(const std::uint64_t &offset) noexcept
+    {
+        return (offset + GRAPH_FILE_ALIGNMENT - 1) / GRAPH_FILE_ALIGNMENT * GRAPH_FILE_ALIGNMENT;
+    }
+
+    // Appends sections to a binary stream, zero-padding each to the alignment
+    class SectionWriter
+    {
+    private:
+        std::ofstream &stream_;
+        std::uint64_t offset_;
+
+    public:
+        SectionWriter(std::ofstream &stream, const std::uint64_t &offset) : stream_(stream), offset_(offset)
+        {
+        }
+
+        std::uint64_t offset() const noexcept
+        {
+            return offset_;
+        }
+
+        // Pads to the start of the next section and returns its offset
+        std::uint64_t align()
+        {
+            static const char padding[GRAPH_FILE_ALIGNMENT] = {};
+            const std::uint64_t aligned = AlignUp(offset_);
+            stream_.write(padding, static_cast<std::streamsize>(aligned - offset_));
+            offset_ = aligned;
+            return aligned;
+        }
+
+        // Appends count elements to the current section
+        template <typename T>
+        void append(const T *data, const size_t &count)
+        {
+            stream_.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(count * sizeof(T)));
+            offset_ += count * sizeof(T);
+        }
+
+        // Writes a section of count elements and returns its offset
+        template <typename T>
+        std::uint64_t write(const T *data, const size_t &count)
+        {
+            const std::uint64_t offset = align();
+            append(data, count);
+            return offset;
+        }
+    };
+
+    // Read-only mapping of a whole file. Without mmap the file is read into an
+    // aligned heap buffer instead, which keeps the interface but not the sharing.
+    class MappedFile
+    {
+    private:
+        const char *data_ = nullptr;
+        size_t size_ = 0;
+#if !defined(MATHEMANIA_HAS_MMAP)
+        std::unique_ptr<std::uint64_t[]> buffer_;
+#endif
+
+        void Unmap() noexcept
+        {
+#if defined(MATHEMANIA_HAS_MMAP)
+            if (data_ != nullptr && size_ > 0)
+            {
+                munmap(const_cast<char *>(data_), size_);
+            }
+#else
+            buffer_.reset();
+#endif
+            data_ = nullptr;
+            size_ = 0;
+        }
+
+    public:
+        MappedFile() = default;
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        MappedFile(MappedFile &&other) noexcept
+        {
+            swap(other);
+        }
+
+        MappedFile &operator=(MappedFile &&other) noexcept
+        {
+            if (this != &other)
+            {
+                Unmap();
+                swap(other);
+            }
+            return *this;
+        }
+
+        ~MappedFile()
+        {
+            Unmap();
+        }
+
+        // Returns false if the file cannot be opened or mapped
+        bool open(const std::string &path)
+        {
+            Unmap();
+#if defined(MATHEMANIA_HAS_MMAP)
+            const int descriptor = ::open(path.c_str(), O_RDONLY);
+            if (descriptor < 0)
+            {
+                return false;
+            }
+            struct stat status;
+            if (fstat(descriptor, &status) != 0)
+            {
+                ::close(descriptor);
+                return false;
+            }
+            size_ = static_cast<size_t>(status.st_size);
+            if (size_ > 0)
+            {
+                void *address = mmap(nullptr, size_, PROT_READ, MAP_SHARED, descriptor, 0);
+                if (address == MAP_FAILED)
+                {
+                    ::close(descriptor);
+                    size_ = 0;
+                    return false;
+                }
+                data_ = static_cast<const char *>(address);
+            }
+            // The mapping stays valid after the descriptor is closed
+            ::close(descriptor);
+            return true;
+#else
+            std::ifstream stream(path, std::ios::binary | std::ios::ate);
+            if (!stream)
+            {
+                return false;
+            }
+            size_ = static_cast<size_t>(stream.tellg());
+            buffer_.reset(new std::uint64_t[(size_ + 7) / 8]);
+            stream.seekg(0);
+            stream.read(reinterpret_cast<char *>(buffer_.get()), static_cast<std::streamsize>(size_));
+            data_ = reinterpret_cast<const char *>(buffer_.get());
+            return static_cast<bool>(stream);
+#endif
+        }
+
+        const char *data() const noexcept
+        {
+            return data_;
+        }
+
+        size_t size() const noexcept
+        {
+            return size_;
+        }
+
+        void swap(MappedFile &other) noexcept
+        {
+            std::swap(data_, other.data_);
+            std::swap(size_, other.size_);
+#if !defined(MATHEMANIA_HAS_MMAP)
+            buffer_.swap(other.buffer_);
+#endif
+        }
+    };
+
+    template <typename TNode, typename EdgeWeight>
+    GraphFileHeader MakeGraphFileHeader(const GraphFileLayout &layout, const size_t &nodes, const size_t &edges)
+    {
+        static_assert(std::is_trivially_copyable_v<TNode>, "Binary graph files need trivially copyable nodes.");
+        static_assert(std::is_trivially_copyable_v<EdgeWeight>, "Binary graph files need trivially copyable weights.");
+        static_assert(sizeof(size_t) == sizeof(std::uint64_t), "Binary graph files need a 64-bit size_t.");
+
+        GraphFileHeader header{};
+        std::memcpy(header.magic, GRAPH_FILE_MAGIC, sizeof(header.magic));
+        header.version = GRAPH_FILE_VERSION;
+        header.byteOrder = GRAPH_FILE_BYTE_ORDER;
+        header.layout = static_cast<std::uint32_t>(layout);
+        header.nodeType = TypeTag<TNode>();
+        header.nodeSize = static_cast<std::uint32_t>(sizeof(TNode));
+        header.weightType = TypeTag<EdgeWeight>();
+        header.weightSize = static_cast<std::uint32_t>(sizeof(EdgeWeight));
+        header.nodes = nodes;
+        header.edges = edges;
+        return header;
+    }
+
+    // Writes the header and the node table, then lets writeEdges add the edge
+    // sections, and finally rewrites the header with the section offsets
+    template <typename TNode, typename EdgeWeight, typename F>
+    bool WriteGraphFile(const std::string &path, const GraphFileLayout &layout, const std::vector<TNode> &nodes,
+                        const size_t &edges, F &&writeEdges)
+    {
+        std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+        if (!stream)
+        {
+            return false;
+        }
+
+        GraphFileHeader header = MakeGraphFileHeader<TNode, EdgeWeight>(layout, nodes.size(), edges);
+        stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        SectionWriter writer(stream, sizeof(header));
+        header.sections[0] = writer.write(nodes.data(), nodes.size());
+        writeEdges(writer, header.sections + 1);
+        header.fileSize = writer.offset();
+
+        stream.seekp(0);
+        stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        return static_cast<bool>(stream);
+    }
+}
+
+// Writes a graph file in the dense layout
+template <typename TNode, typename EdgeWeight>
+bool WriteGraphFile(const std::string &path, const std::vector<TNode> &nodes, const DenseView<EdgeWeight> &view)
+{
+    if (nodes.size() != view.size())
+    {
+        throw std::invalid_argument("Dimensions of the adjacency matrix should be equal to the number of vertices.");
+    }
+    return detail::WriteGraphFile<TNode, EdgeWeight>(
+        path, GraphFileLayout::Dense, nodes, view.edges(),
+        [&](detail::SectionWriter &writer, std::uint64_t *sections)
+        {
+            // Rows one by one, the view may be strided
+            sections[0] = writer.align();
+            for (size_t to = 0; to < view.size(); ++to)
+            {
+                writer.append(view.data() + to * view.stride(), view.size());
+            }
+        });
+}
+
+// Writes a graph file in the CSR layout
+template <typename TNode, typename EdgeWeight>
+bool WriteGraphFile(const std::string &path, const std::vector<TNode> &nodes, const CsrView<EdgeWeight> &view)
+{
+    if (nodes.size() != view.size())
+    {
+        throw std::invalid_argument("Dimensions of the edge arrays should be equal to the number of vertices.");
+    }
+    return detail::WriteGraphFile<TNode, EdgeWeight>(
+        path, GraphFileLayout::Csr, nodes, view.edges(),
+        [&](detail::SectionWriter &writer, std::uint64_t *sections)
+        {
+            sections[0] = writer.write(view.out_offsets(), view.size() + 1);
+            sections[1] = writer.write(view.out_targets(), view.edges());
+            sections[2] = writer.write(view.out_weights(), view.edges());
+            sections[3] = writer.write(view.in_offsets(), view.size() + 1);
+            sections[4] = writer.write(view.in_sources(), view.edges());
+            sections[5] = writer.write(view.in_weights(), view.edges());
+        });
+}
+
+// Read-only graph backed by a memory-mapped graph file. Opening validates the
+// header and the section bounds in O(1); the arrays themselves are trusted and
+// used in place, so a file of any size opens in constant time and processes
+// mapping the same file share its pages. A corrupt CSR file can therefore send
+// the views out of bounds: call validate_edges() on files from untrusted sources.
+//
+// The views returned by dense() and csr() run every read-only algorithm (see
+// graph_traversal.h, shortest_paths.h) and stay valid while the MappedGraph lives.
+template <typename TNode, typename EdgeWeight>
+class MappedGraph
+{
+private:
+    detail::MappedFile file_;
+    GraphFileHeader header_{};
+
+    template <typename T>
+    const T *section(const size_t &index) const
+    {
+        return reinterpret_cast<const T *>(file_.data() + header_.sections[index]);
+    }
+
+    // Throws unless count elements of T fit at the section offset
+    template <typename T>
+    void CheckSection(const size_t &index, const std::uint64_t &count) const
+    {
+        const std::uint64_t offset = header_.sections[index];
+        if (offset % detail::GRAPH_FILE_ALIGNMENT != 0 || offset > header_.fileSize ||
+            count > (header_.fileSize - offset) / sizeof(T))
+        {
+            throw std::runtime_error("Graph file section out of bounds.");
+        }
+    }
+
+    void Validate() const
+    {
+        if (file_.size() < sizeof(GraphFileHeader) ||
+            std::memcmp(header_.magic, detail::GRAPH_FILE_MAGIC, sizeof(header_.magic)) != 0)
+        {
+            throw std::runtime_error("Not a graph file.");
+        }
+        if (header_.version != GRAPH_FILE_VERSION)
+        {
+            throw std::runtime_error("Unsupported graph file version.");
+        }
+        if (header_.byteOrder != detail::GRAPH_FILE_BYTE_ORDER)
+        {
+            throw std::runtime_error("Graph file has a foreign byte order.");
+        }
+        if (header_.nodeType != detail::TypeTag<TNode>() || header_.nodeSize != sizeof(TNode) ||
+            header_.weightType != detail::TypeTag<EdgeWeight>() || header_.weightSize != sizeof(EdgeWeight))
+        {
+            throw std::runtime_error("Graph file holds different node or weight types.");
+        }
+        if (header_.fileSize != file_.size())
+        {
+            throw std::runtime_error("Graph file is truncated.");
+        }
+
+        CheckSection<TNode>(0, header_.nodes);
+        if (layout() == GraphFileLayout::Dense)
+        {
+            if (header_.nodes != 0 && header_.nodes > std::numeric_limits<std::uint64_t>::max() / header_.nodes)
+            {
+                throw std::runtime_error("Graph file section out of bounds.");
+            }
+            CheckSection<EdgeWeight>(1, header_.nodes * header_.nodes);
+        }
+        else if (layout() == GraphFileLayout::Csr)
+        {
+            if (header_.nodes > std::numeric_limits<typename CsrView<EdgeWeight>::index_type>::max())
+            {
+                throw std::runtime_error("Too many nodes for CSR storage.");
+            }
+            CheckSection<size_t>(1, header_.nodes + 1);
+            CheckSection<std::uint32_t>(2, header_.edges);
+            CheckSection<EdgeWeight>(3, header_.edges);
+            CheckSection<size_t>(4, header_.nodes + 1);
+            CheckSection<std::uint32_t>(5, header_.edges);
+            CheckSection<EdgeWeight>(6, header_.edges);
+            if (section<size_t>(1)[0] != 0 || section<size_t>(1)[header_.nodes] != header_.edges ||
+                section<size_t>(4)[0] != 0 || section<size_t>(4)[header_.nodes] != header_.edges)
+            {
+                throw std::runtime_error("Graph file has inconsistent edge offsets.");
+            }
+        }
+        else
+        {
+            throw std::runtime_error("Unknown graph file layout.");
+        }
+    }
+
+public:
+    MappedGraph() = default;
+
+    // Maps and validates the file, throws std::runtime_error if it cannot
+    explicit MappedGraph(const std::string &path)
+    {
+        if (!open(path))
+        {
+            throw std::runtime_error("Cannot open graph file " + path + ".");
+        }
+    }
+
+    // Returns false if the file cannot be opened, throws std::runtime_error if it
+    // is not a valid graph file for these types
+    bool open(const std::string &path)
+    {
+        detail::MappedFile file;
+        if (!file.open(path))
+        {
+            return false;
+        }
+        file_ = std::move(file);
+        if (file_.size() >= sizeof(GraphFileHeader))
+        {
+            std::memcpy(&header_, file_.data(), sizeof(GraphFileHeader));
+        }
+        try
+        {
+            Validate();
+        }
+        catch (...)
+        {
+            file_ = detail::MappedFile();
+            header_ = GraphFileHeader{};
+            throw;
+        }
+        return true;
+    }
+
+    GraphFileLayout layout() const noexcept
+    {
+        return static_cast<GraphFileLayout>(header_.layout);
+    }
+
+    size_t size() const noexcept
+    {
+        return static_cast<size_t>(header_.nodes);
+    }
+
+    size_t Edges() const noexcept
+    {
+        return static_cast<size_t>(header_.edges);
+    }
+
+    // Node table in NodeId order
+    const TNode *nodes() const noexcept
+    {
+        return size() > 0 ? section<TNode>(0) : nullptr;
+    }
+
+    const TNode &node(const NodeId &id) const
+    {
+        return nodes()[id.index()];
+    }
+
+    // Checks in O(V + E) that the CSR offsets never decrease, that every edge
+    // ends at a node of the file, that every neighbor list is strictly increasing
+    // and that the incoming side holds exactly the outgoing edges with the same
+    // weights; throws std::runtime_error otherwise. Dense files need no check,
+    // open() has bounded the matrix already.
+    void validate_edges() const
+    {
+        if (layout() != GraphFileLayout::Csr)
+        {
+            return;
+        }
+        for (const size_t &part : {size_t(1), size_t(4)})
+        {
+            const size_t *offsets = section<size_t>(part);
+            const std::uint32_t *ends = section<std::uint32_t>(part + 1);
+            for (size_t index = 0; index < size(); ++index)
+            {
+                if (offsets[index] > offsets[index + 1])
+                {
+                    throw std::runtime_error("Graph file has inconsistent edge offsets.");
+                }
+            }
+            for (size_t index = 0; index < size(); ++index)
+            {
+                for (size_t edge = offsets[index]; edge < offsets[index + 1]; ++edge)
+                {
+                    if (ends[edge] >= header_.nodes)
+                    {
+                        throw std::runtime_error("Graph file has edges to unknown nodes.");
+                    }
+                    if (edge > offsets[index] && ends[edge - 1] >= ends[edge])
+                    {
+                        throw std::runtime_error("Graph file has unsorted neighbor lists.");
+                    }
+                }
+            }
+        }
+
+        // Walking the sources in increasing order meets every sorted in-list in order
+        const size_t *outOffsets = section<size_t>(1);
+        const std::uint32_t *targets = section<std::uint32_t>(2);
+        const EdgeWeight *outWeights = section<EdgeWeight>(3);
+        const size_t *inOffsets = section<size_t>(4);
+        const std::uint32_t *sources = section<std::uint32_t>(5);
+        const EdgeWeight *inWeights = section<EdgeWeight>(6);
+        std::vector<size_t> cursor(inOffsets, inOffsets + size());
+        for (size_t from = 0; from < size(); ++from)
+        {
+            for (size_t edge = outOffsets[from]; edge < outOffsets[from + 1]; ++edge)
+            {
+                const size_t in = cursor[targets[edge]]++;
+                if (in >= inOffsets[targets[edge] + 1] || sources[in] != from || !(inWeights[in] == outWeights[edge]))
+                {
+                    throw std::runtime_error("Graph file has incoming edges that differ from the outgoing ones.");
+                }
+            }
+        }
+    }
+
+    // Edges of a file in the dense layout
+    DenseView<EdgeWeight> dense() const
+    {
+        if (layout() != GraphFileLayout::Dense)
+        {
+            throw std::logic_error("Graph file is not in the dense layout.");
+        }
+        return DenseView<EdgeWeight>(section<EdgeWeight>(1), size(), size());
+    }
+
+    // Edges of a file in the CSR layout
+    CsrView<EdgeWeight> csr() const
+    {
+        if (layout() != GraphFileLayout::Csr)
+        {
+            throw std::logic_error("Graph file is not in the CSR layout.");
+        }
+        return CsrView<EdgeWeight>(size(), section<size_t>(1), section<std::uint32_t>(2), section<EdgeWeight>(3),
+                                   section<size_t>(4), section<std::uint32_t>(5), section<EdgeWeight>(6));
+    }
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "graph_storage.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// R-MAT edge list (Chakrabarti, Zhan, Faloutsos) over 2^scale nodes with
+// edgeFactor * 2^scale edges. Every edge picks one quadrant of the adjacency
+// matrix per bit with probabilities a, b, c and 1 - a - b - c, which gives the
+// skewed degrees of real-world graphs. Weights are uniform integers in [1, 255].
+// Blocks of edges are generated in parallel from their own seeded streams, so
+// the result depends only on the arguments.
+template <typename EdgeWeight>
+std::vector<IndexedEdge<EdgeWeight>> RMatEdges(const size_t &scale, const size_t &edgeFactor,
+                                               const std::uint64_t &seed = 1, const double &a = 0.57,
+                                               const double &b = 0.19, const double &c = 0.19)
+{
+    constexpr size_t BLOCK = 1 << 16;
+
+    const size_t count = edgeFactor << scale;
+    std::vector<IndexedEdge<EdgeWeight>> edges(count);
+    const size_t blocks = (count + BLOCK - 1) / BLOCK;
+
+    // Quadrant thresholds on 32-bit uniform integers, every 64-bit draw serves two bits
+    const double scaleFactor = 4294967296.0;
+    const std::uint64_t ab = static_cast<std::uint64_t>((a + b) * scaleFactor);
+    const std::uint64_t aOnly = static_cast<std::uint64_t>(a * scaleFactor);
+    const std::uint64_t abc = static_cast<std::uint64_t>((a + b + c) * scaleFactor);
+
+    linal::ThreadPool::Instance().ParallelFor(blocks, [&](size_t block)
+                                              {
+                                                  std::mt19937_64 engine(seed * 0x9E3779B97F4A7C15ULL + block);
+                                                  const size_t last = std::min(count, (block + 1) * BLOCK);
+                                                  for (size_t edge = block * BLOCK; edge < last; ++edge)
+                                                  {
+                                                      size_t from = 0, to = 0;
+                                                      std::uint64_t bits = 0;
+                                                      for (size_t bit = 0; bit < scale; ++bit)
+                                                      {
+                                                          if (bit % 2 == 0)
+                                                          {
+                                                              bits = engine();
+                                                          }
+                                                          const std::uint64_t r = (bits >> (bit % 2 * 32)) & 0xFFFFFFFFULL;
+                                                          const size_t row = r >= ab;
+                                                          // Branch-free: 1 on [a, a + b) and on [a + b + c, 1)
+                                                          const size_t column = size_t(r >= aOnly) ^ size_t(r >= ab) ^ size_t(r >= abc);
+                                                          from |= row << bit;
+                                                          to |= column << bit;
+                                                      }
+                                                      edges[edge] = {from, to, static_cast<EdgeWeight>(1 + engine() % 255)};
+                                                  } });
+    return edges;
+}
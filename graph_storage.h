@@ -0,0 +1,1313 @@
+#pragma once
+
+#include "matrix.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Edge storage policies for Graph. Nodes are addressed by their dense index in
+// [0, size()); an edge goes from node `from` to node `to` and carries a weight.
+//
+// Every policy provides the same interface:
+//   size(), edges(), clear(), reserve(n), add_nodes(count), erase_node(index),
+//   contains(from, to), weight(from, to), set(from, to, weight), erase(from, to),
+//   insert_edges(batch),
+//   clear_edges(), clear_out(index), clear_in(index),
+//   out_degree(index), in_degree(index),
+//   for_each_out(index, f), for_each_in(index, f), matrix(), swap(other).
+//
+// for_each_out calls f(to, weight) for every edge leaving the node and
+// for_each_in calls f(from, weight) for every edge entering it. When f returns
+// bool, returning false stops the iteration early.
+//
+// DenseStorage and CsrStorage also have view(), a non-owning, read-only DenseView
+// or CsrView of the same edges. Views provide the read half of the interface
+// (size through for_each_in and matrix), so everything that only reads a storage
+// also runs on a view.
+
+// Edge between two node indices, the unit of batched updates
+template <typename EdgeWeight>
+struct IndexedEdge
+{
+    size_t from, to;
+    EdgeWeight weight;
+};
+
+namespace detail
+{
+    // Whether a stored weight is an edge. Every policy and view goes through this,
+    // so a graph has the same edges whichever storage holds it.
+    template <typename EdgeWeight>
+    bool IsEdge(const EdgeWeight &weight)
+    {
+        return weight > EdgeWeight();
+    }
+
+    // Calls f and reports whether the iteration should go on
+    template <typename F, typename... Arguments>
+    bool Visit(F &f, Arguments &&...arguments)
+    {
+        if constexpr (std::is_same_v<std::invoke_result_t<F &, Arguments...>, bool>)
+        {
+            return f(std::forward<Arguments>(arguments)...);
+        }
+        else
+        {
+            f(std::forward<Arguments>(arguments)...);
+            return true;
+        }
+    }
+
+    // Index of the lowest set bit, bits must not be zero
+    inline size_t CountTrailingZeros(const std::uint64_t &bits)
+    {
+#if defined(__GNUC__)
+        return static_cast<size_t>(__builtin_ctzll(bits));
+#else
+        size_t count = 0;
+        while (((bits >> count) & 1) == 0)
+        {
+            count++;
+        }
+        return count;
+#endif
+    }
+
+    // Number of set bits, a single instruction where the target has one
+    inline size_t PopCount(const std::uint64_t &bits)
+    {
+#if defined(__GNUC__)
+        return static_cast<size_t>(__builtin_popcountll(bits));
+#else
+        std::uint64_t value = bits - ((bits >> 1) & 0x5555555555555555ULL);
+        value = (value & 0x3333333333333333ULL) + ((value >> 2) & 0x3333333333333333ULL);
+        value = (value + (value >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+        return static_cast<size_t>((value * 0x0101010101010101ULL) >> 56);
+#endif
+    }
+}
+
+// Read-only V x V adjacency matrix over memory owned by someone else, element
+// (to, from) at data[to * stride + from]. Implements the read half of the storage
+// interface, so the algorithms run directly on it, e.g. on a memory-mapped graph
+// file (see graph_file.h).
+template <typename EdgeWeight>
+class DenseView
+{
+public:
+    using weight_type = EdgeWeight;
+    using Edge = IndexedEdge<EdgeWeight>;
+
+private:
+    const EdgeWeight *cells_ = nullptr;
+    size_t size_ = 0, stride_ = 0;
+
+    const EdgeWeight &cell(const size_t &to, const size_t &from) const
+    {
+        return cells_[to * stride_ + from];
+    }
+
+public:
+    DenseView() = default;
+
+    DenseView(const EdgeWeight *cells, const size_t &size, const size_t &stride)
+        : cells_(cells), size_(size), stride_(stride)
+    {
+    }
+
+    size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    size_t stride() const noexcept
+    {
+        return stride_;
+    }
+
+    const EdgeWeight *data() const noexcept
+    {
+        return cells_;
+    }
+
+    size_t edges() const
+    {
+        size_t count = 0;
+        for (size_t to = 0; to < size_; ++to)
+        {
+            for (size_t from = 0; from < size_; ++from)
+            {
+                if (detail::IsEdge(cell(to, from)))
+                {
+                    count++;
+                }
+            }
+        }
+        return count;
+    }
+
+    bool contains(const size_t &from, const size_t &to) const
+    {
+        return detail::IsEdge(cell(to, from));
+    }
+
+    EdgeWeight weight(const size_t &from, const size_t &to) const
+    {
+        return cell(to, from);
+    }
+
+    size_t out_degree(const size_t &index) const
+    {
+        size_t count = 0;
+        for (size_t to = 0; to < size_; ++to)
+        {
+            if (detail::IsEdge(cell(to, index)))
+            {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    size_t in_degree(const size_t &index) const
+    {
+        const EdgeWeight *row = &cell(index, 0);
+        return static_cast<size_t>(std::count_if(row, row + size_, detail::IsEdge<EdgeWeight>));
+    }
+
+    template <typename F>
+    void for_each_out(const size_t &index, F &&f) const
+    {
+        for (size_t to = 0; to < size_; ++to)
+        {
+            const EdgeWeight &weight = cell(to, index);
+            if (detail::IsEdge(weight) && !detail::Visit(f, to, weight))
+            {
+                return;
+            }
+        }
+    }
+
+    template <typename F>
+    void for_each_in(const size_t &index, F &&f) const
+    {
+        const EdgeWeight *row = &cell(index, 0);
+        for (size_t from = 0; from < size_; ++from)
+        {
+            if (detail::IsEdge(row[from]) && !detail::Visit(f, from, row[from]))
+            {
+                return;
+            }
+        }
+    }
+
+    // Adjacency matrix indexed (to, from)
+    linal::Matrix<EdgeWeight> matrix() const
+    {
+        return linal::Matrix<EdgeWeight>(linal::MatrixView<const EdgeWeight>(cells_, size_, size_, stride_));
+    }
+};
+
+// Dense V x V matrix, element (to, from) holds the weight of the edge from -> to
+// and positive weights mark edges. O(1) edge lookup, O(V) neighbor iteration,
+// O(V^2) memory: meant for small or dense graphs.
+//
+// The matrix lives in the top-left corner of a zero-filled capacity x capacity
+// buffer that grows geometrically, so appending a node costs amortized O(V)
+// (one new row and column) instead of rebuilding the whole matrix.
+template <typename EdgeWeight>
+class DenseStorage
+{
+public:
+    using weight_type = EdgeWeight;
+    using Edge = IndexedEdge<EdgeWeight>;
+
+private:
+    linal::Matrix<EdgeWeight> cells_;
+    size_t size_ = 0;
+
+    size_t capacity() const noexcept
+    {
+        return cells_.rows();
+    }
+
+    EdgeWeight &cell(const size_t &to, const size_t &from)
+    {
+        return cells_(to, from);
+    }
+
+    const EdgeWeight &cell(const size_t &to, const size_t &from) const
+    {
+        return cells_(to, from);
+    }
+
+    // Logical matrix as a view into the padded buffer
+    linal::MatrixView<const EdgeWeight> block() const
+    {
+        return cells_.Submatrix(0, 0, size_, size_);
+    }
+
+public:
+    DenseStorage() = default;
+
+    explicit DenseStorage(const linal::Matrix<EdgeWeight> &matrix) : cells_(matrix), size_(matrix.rows())
+    {
+    }
+
+    // Copies the matrix of a view
+    explicit DenseStorage(const DenseView<EdgeWeight> &view) : cells_(view.size(), view.size()), size_(view.size())
+    {
+        for (size_t to = 0; to < size_; ++to)
+        {
+            std::copy(view.data() + to * view.stride(), view.data() + to * view.stride() + size_, &cell(to, 0));
+        }
+    }
+
+    size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    size_t edges() const
+    {
+        return view().edges();
+    }
+
+    void clear()
+    {
+        cells_.clear();
+        size_ = 0;
+    }
+
+    // Makes room for n nodes without further reallocation
+    void reserve(const size_t &n)
+    {
+        if (n <= capacity())
+        {
+            return;
+        }
+
+        linal::Matrix<EdgeWeight> cells(n, n, EdgeWeight());
+        cells.Submatrix(0, 0, size_, size_) = block();
+        cells_ = std::move(cells);
+    }
+
+    // Appends count isolated nodes, the padding is already zero
+    void add_nodes(const size_t &count)
+    {
+        if (size_ + count > capacity())
+        {
+            reserve(std::max(size_ + count, 2 * capacity()));
+        }
+        size_ += count;
+    }
+
+    // Removes the node and its edges, the following nodes move down by one index
+    void erase_node(const size_t &index)
+    {
+        for (size_t to = 0; to < size_; ++to)
+        {
+            if (to == index)
+            {
+                continue;
+            }
+            EdgeWeight *source = cells_.data() + to * capacity();
+            // Rows ahead of the erased one only lose a column
+            if (to > index)
+            {
+                std::move(source, source + index, source - capacity());
+            }
+            EdgeWeight *destination = cells_.data() + (to > index ? to - 1 : to) * capacity();
+            std::move(source + index + 1, source + size_, destination + index);
+        }
+
+        size_--;
+        // Restores the zero padding in the vacated row and column
+        std::fill(cells_.data() + size_ * capacity(), cells_.data() + size_ * capacity() + size_ + 1, EdgeWeight());
+        for (size_t to = 0; to < size_; ++to)
+        {
+            cell(to, size_) = EdgeWeight();
+        }
+    }
+
+    bool contains(const size_t &from, const size_t &to) const
+    {
+        return view().contains(from, to);
+    }
+
+    EdgeWeight weight(const size_t &from, const size_t &to) const
+    {
+        return cell(to, from);
+    }
+
+    void set(const size_t &from, const size_t &to, const EdgeWeight &weight)
+    {
+        cell(to, from) = weight;
+    }
+
+    void erase(const size_t &from, const size_t &to)
+    {
+        cell(to, from) = EdgeWeight();
+    }
+
+    // Stores a batch of edges; later duplicates win
+    void insert_edges(const std::vector<Edge> &batch)
+    {
+        for (const Edge &edge : batch)
+        {
+            if (edge.from >= size_ || edge.to >= size_)
+            {
+                throw std::out_of_range("Edge refers to a node out of range.");
+            }
+        }
+        for (const Edge &edge : batch)
+        {
+            cell(edge.to, edge.from) = edge.weight;
+        }
+    }
+
+    void clear_edges()
+    {
+        std::fill(cells_.begin(), cells_.end(), EdgeWeight());
+    }
+
+    void clear_out(const size_t &index)
+    {
+        for (size_t to = 0; to < size_; ++to)
+        {
+            cell(to, index) = EdgeWeight();
+        }
+    }
+
+    void clear_in(const size_t &index)
+    {
+        std::fill(&cell(index, 0), &cell(index, 0) + size_, EdgeWeight());
+    }
+
+    size_t out_degree(const size_t &index) const
+    {
+        return view().out_degree(index);
+    }
+
+    size_t in_degree(const size_t &index) const
+    {
+        return view().in_degree(index);
+    }
+
+    template <typename F>
+    void for_each_out(const size_t &index, F &&f) const
+    {
+        view().for_each_out(index, std::forward<F>(f));
+    }
+
+    template <typename F>
+    void for_each_in(const size_t &index, F &&f) const
+    {
+        view().for_each_in(index, std::forward<F>(f));
+    }
+
+    // Adjacency matrix indexed (to, from)
+    linal::Matrix<EdgeWeight> matrix() const
+    {
+        return linal::Matrix<EdgeWeight>(block());
+    }
+
+    // Read-only view of the logical matrix inside the padded buffer
+    DenseView<EdgeWeight> view() const noexcept
+    {
+        return DenseView<EdgeWeight>(cells_.data(), size_, capacity());
+    }
+
+    void swap(DenseStorage &other)
+    {
+        cells_.swap(other.cells_);
+        std::swap(size_, other.size_);
+    }
+};
+
+// Read-only compressed rows and columns over arrays owned by someone else, laid
+// out as in CsrStorage. Implements the read half of the storage interface.
+template <typename EdgeWeight>
+class CsrView
+{
+public:
+    using index_type = std::uint32_t;
+    using weight_type = EdgeWeight;
+    using Edge = IndexedEdge<EdgeWeight>;
+
+private:
+    static constexpr size_t EMPTY_OFFSETS[1] = {0};
+
+    size_t size_ = 0;
+    const size_t *outOffsets_ = EMPTY_OFFSETS;
+    const index_type *outTargets_ = nullptr;
+    const EdgeWeight *outWeights_ = nullptr;
+    const size_t *inOffsets_ = EMPTY_OFFSETS;
+    const index_type *inSources_ = nullptr;
+    const EdgeWeight *inWeights_ = nullptr;
+
+    // Position of the edge in a sorted neighbor range, or the end of the range
+    static size_t Find(const index_type *neighbors, const size_t &first, const size_t &last, const size_t &neighbor)
+    {
+        return static_cast<size_t>(std::lower_bound(neighbors + first, neighbors + last,
+                                                    static_cast<index_type>(neighbor)) -
+                                   neighbors);
+    }
+
+public:
+    CsrView() = default;
+
+    // Offsets have size + 1 entries, the edge arrays offsets[size] entries
+    CsrView(const size_t &size, const size_t *outOffsets, const index_type *outTargets, const EdgeWeight *outWeights,
+            const size_t *inOffsets, const index_type *inSources, const EdgeWeight *inWeights)
+        : size_(size), outOffsets_(outOffsets), outTargets_(outTargets), outWeights_(outWeights),
+          inOffsets_(inOffsets), inSources_(inSources), inWeights_(inWeights)
+    {
+    }
+
+    size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    size_t edges() const noexcept
+    {
+        return outOffsets_[size_];
+    }
+
+    bool contains(const size_t &from, const size_t &to) const
+    {
+        const size_t position = Find(outTargets_, outOffsets_[from], outOffsets_[from + 1], to);
+        return position < outOffsets_[from + 1] && outTargets_[position] == to;
+    }
+
+    EdgeWeight weight(const size_t &from, const size_t &to) const
+    {
+        const size_t position = Find(outTargets_, outOffsets_[from], outOffsets_[from + 1], to);
+        if (position < outOffsets_[from + 1] && outTargets_[position] == to)
+        {
+            return outWeights_[position];
+        }
+        return EdgeWeight();
+    }
+
+    size_t out_degree(const size_t &index) const
+    {
+        return outOffsets_[index + 1] - outOffsets_[index];
+    }
+
+    size_t in_degree(const size_t &index) const
+    {
+        return inOffsets_[index + 1] - inOffsets_[index];
+    }
+
+    template <typename F>
+    void for_each_out(const size_t &index, F &&f) const
+    {
+        for (size_t edge = outOffsets_[index]; edge < outOffsets_[index + 1]; ++edge)
+        {
+            if (!detail::Visit(f, static_cast<size_t>(outTargets_[edge]), outWeights_[edge]))
+            {
+                return;
+            }
+        }
+    }
+
+    template <typename F>
+    void for_each_in(const size_t &index, F &&f) const
+    {
+        for (size_t edge = inOffsets_[index]; edge < inOffsets_[index + 1]; ++edge)
+        {
+            if (!detail::Visit(f, static_cast<size_t>(inSources_[edge]), inWeights_[edge]))
+            {
+                return;
+            }
+        }
+    }
+
+    const size_t *out_offsets() const noexcept
+    {
+        return outOffsets_;
+    }
+
+    const index_type *out_targets() const noexcept
+    {
+        return outTargets_;
+    }
+
+    const EdgeWeight *out_weights() const noexcept
+    {
+        return outWeights_;
+    }
+
+    const size_t *in_offsets() const noexcept
+    {
+        return inOffsets_;
+    }
+
+    const index_type *in_sources() const noexcept
+    {
+        return inSources_;
+    }
+
+    const EdgeWeight *in_weights() const noexcept
+    {
+        return inWeights_;
+    }
+
+    // Dense adjacency matrix indexed (to, from)
+    linal::Matrix<EdgeWeight> matrix() const
+    {
+        linal::Matrix<EdgeWeight> result(size_, size_, EdgeWeight());
+        for (size_t from = 0; from < size_; ++from)
+        {
+            for (size_t edge = outOffsets_[from]; edge < outOffsets_[from + 1]; ++edge)
+            {
+                result(outTargets_[edge], from) = outWeights_[edge];
+            }
+        }
+        return result;
+    }
+};
+
+// Compressed sparse rows of outgoing edges plus compressed sparse columns
+// (incoming edges), both sorted by the neighbor index. O(V + E) memory,
+// O(degree) neighbor iteration, O(log degree) edge lookup.
+//
+// Single-edge updates shift the arrays and cost O(V + E); build large graphs
+// with insert_edges, which buckets a whole batch by source and merges it in one
+// O(V + E + B log d) pass.
+template <typename EdgeWeight>
+class CsrStorage
+{
+public:
+    using index_type = std::uint32_t;
+    using weight_type = EdgeWeight;
+    using Edge = IndexedEdge<EdgeWeight>;
+
+private:
+    // Out-edges of node i are [outOffsets_[i], outOffsets_[i + 1])
+    std::vector<size_t> outOffsets_{0};
+    std::vector<index_type> outTargets_;
+    std::vector<EdgeWeight> outWeights_;
+    // In-edges of node i are [inOffsets_[i], inOffsets_[i + 1])
+    std::vector<size_t> inOffsets_{0};
+    std::vector<index_type> inSources_;
+    std::vector<EdgeWeight> inWeights_;
+
+    static void CheckIndexRange(const size_t &size)
+    {
+        if (size > static_cast<size_t>(std::numeric_limits<index_type>::max()))
+        {
+            throw std::length_error("Too many nodes for CSR storage.");
+        }
+    }
+
+    // Position of the edge in a sorted neighbor range, or the end of the range
+    static size_t Find(const std::vector<index_type> &neighbors, const size_t &first, const size_t &last,
+                       const size_t &neighbor)
+    {
+        auto begin = neighbors.begin() + first;
+        auto end = neighbors.begin() + last;
+        auto it = std::lower_bound(begin, end, static_cast<index_type>(neighbor));
+        return static_cast<size_t>(it - neighbors.begin());
+    }
+
+    // Inserts or updates one entry of a compressed side
+    static void Upsert(std::vector<size_t> &offsets, std::vector<index_type> &neighbors, std::vector<EdgeWeight> &weights,
+                       const size_t &node, const size_t &neighbor, const EdgeWeight &weight)
+    {
+        const size_t position = Find(neighbors, offsets[node], offsets[node + 1], neighbor);
+        if (position < offsets[node + 1] && neighbors[position] == neighbor)
+        {
+            weights[position] = weight;
+            return;
+        }
+
+        neighbors.insert(neighbors.begin() + position, static_cast<index_type>(neighbor));
+        weights.insert(weights.begin() + position, weight);
+        for (size_t i = node + 1; i < offsets.size(); ++i)
+        {
+            offsets[i]++;
+        }
+    }
+
+    // Removes one entry of a compressed side if present
+    static void Remove(std::vector<size_t> &offsets, std::vector<index_type> &neighbors, std::vector<EdgeWeight> &weights,
+                       const size_t &node, const size_t &neighbor)
+    {
+        const size_t position = Find(neighbors, offsets[node], offsets[node + 1], neighbor);
+        if (position == offsets[node + 1] || neighbors[position] != neighbor)
+        {
+            return;
+        }
+
+        neighbors.erase(neighbors.begin() + position);
+        weights.erase(weights.begin() + position);
+        for (size_t i = node + 1; i < offsets.size(); ++i)
+        {
+            offsets[i]--;
+        }
+    }
+
+    // Rebuilds the incoming side from the outgoing one with a counting sort
+    void RebuildIn()
+    {
+        const size_t n = size();
+        inOffsets_.assign(n + 1, 0);
+        for (const index_type &to : outTargets_)
+        {
+            inOffsets_[to + 1]++;
+        }
+        for (size_t i = 0; i < n; ++i)
+        {
+            inOffsets_[i + 1] += inOffsets_[i];
+        }
+
+        inSources_.resize(outTargets_.size());
+        inWeights_.resize(outTargets_.size());
+        std::vector<size_t> cursor(inOffsets_.begin(), inOffsets_.end() - 1);
+        // Walking the sources in increasing order keeps every column sorted
+        for (size_t from = 0; from < n; ++from)
+        {
+            for (size_t edge = outOffsets_[from]; edge < outOffsets_[from + 1]; ++edge)
+            {
+                const size_t position = cursor[outTargets_[edge]]++;
+                inSources_[position] = static_cast<index_type>(from);
+                inWeights_[position] = outWeights_[edge];
+            }
+        }
+    }
+
+    // Keeps only the outgoing edges accepted by keep(from, to), the incoming side
+    // has to be rebuilt afterwards
+    template <typename F>
+    void FilterOut(F &&keep)
+    {
+        size_t target = 0;
+        size_t first = 0;
+        for (size_t from = 0; from < size(); ++from)
+        {
+            const size_t last = outOffsets_[from + 1];
+            for (size_t edge = first; edge < last; ++edge)
+            {
+                if (keep(from, outTargets_[edge]))
+                {
+                    outTargets_[target] = outTargets_[edge];
+                    outWeights_[target] = outWeights_[edge];
+                    target++;
+                }
+            }
+            first = last;
+            outOffsets_[from + 1] = target;
+        }
+        outTargets_.resize(target);
+        outWeights_.resize(target);
+    }
+
+public:
+    CsrStorage() = default;
+
+    // Takes every positive element (to, from) of a square adjacency matrix as an edge
+    explicit CsrStorage(const linal::Matrix<EdgeWeight> &matrix)
+    {
+        const size_t n = matrix.rows();
+        CheckIndexRange(n);
+        outOffsets_.assign(n + 1, 0);
+        for (size_t from = 0; from < n; ++from)
+        {
+            for (size_t to = 0; to < n; ++to)
+            {
+                if (detail::IsEdge(matrix(to, from)))
+                {
+                    outTargets_.push_back(static_cast<index_type>(to));
+                    outWeights_.push_back(matrix(to, from));
+                }
+            }
+            outOffsets_[from + 1] = outTargets_.size();
+        }
+        RebuildIn();
+    }
+
+    // Copies the arrays of a view
+    explicit CsrStorage(const CsrView<EdgeWeight> &view)
+        : outOffsets_(view.out_offsets(), view.out_offsets() + view.size() + 1),
+          outTargets_(view.out_targets(), view.out_targets() + view.edges()),
+          outWeights_(view.out_weights(), view.out_weights() + view.edges()),
+          inOffsets_(view.in_offsets(), view.in_offsets() + view.size() + 1),
+          inSources_(view.in_sources(), view.in_sources() + view.edges()),
+          inWeights_(view.in_weights(), view.in_weights() + view.edges())
+    {
+        CheckIndexRange(view.size());
+    }
+
+    size_t size() const noexcept
+    {
+        return outOffsets_.size() - 1;
+    }
+
+    size_t edges() const noexcept
+    {
+        return outTargets_.size();
+    }
+
+    void clear()
+    {
+        *this = CsrStorage();
+    }
+
+    // Makes room for n nodes without further reallocation
+    void reserve(const size_t &n)
+    {
+        outOffsets_.reserve(n + 1);
+        inOffsets_.reserve(n + 1);
+    }
+
+    // Appends count isolated nodes, amortized O(1) per node
+    void add_nodes(const size_t &count)
+    {
+        CheckIndexRange(size() + count);
+        outOffsets_.insert(outOffsets_.end(), count, outOffsets_.back());
+        inOffsets_.insert(inOffsets_.end(), count, inOffsets_.back());
+    }
+
+    // Removes the node and its edges, the following nodes move down by one index
+    void erase_node(const size_t &index)
+    {
+        FilterOut([&](const size_t &from, const size_t &to)
+                  { return from != index && to != index; });
+        outOffsets_.erase(outOffsets_.begin() + index + 1);
+        for (index_type &to : outTargets_)
+        {
+            if (to > index)
+            {
+                to--;
+            }
+        }
+        RebuildIn();
+    }
+
+    bool contains(const size_t &from, const size_t &to) const
+    {
+        return view().contains(from, to);
+    }
+
+    EdgeWeight weight(const size_t &from, const size_t &to) const
+    {
+        return view().weight(from, to);
+    }
+
+    // Stores the edge; a weight that is no edge removes it, as in the dense representation
+    void set(const size_t &from, const size_t &to, const EdgeWeight &weight)
+    {
+        if (!detail::IsEdge(weight))
+        {
+            erase(from, to);
+            return;
+        }
+
+        Upsert(outOffsets_, outTargets_, outWeights_, from, to, weight);
+        Upsert(inOffsets_, inSources_, inWeights_, to, from, weight);
+    }
+
+    void erase(const size_t &from, const size_t &to)
+    {
+        Remove(outOffsets_, outTargets_, outWeights_, from, to);
+        Remove(inOffsets_, inSources_, inWeights_, to, from);
+    }
+
+    // Stores a batch of edges in one merge pass; later duplicates win and zero
+    // weights remove edges
+    void insert_edges(const std::vector<Edge> &batch)
+    {
+        for (const Edge &edge : batch)
+        {
+            if (edge.from >= size() || edge.to >= size())
+            {
+                throw std::out_of_range("Edge refers to a node out of range.");
+            }
+        }
+
+        // Counting sort by source, then every bucket by target; both are stable,
+        // so duplicates keep their batch order
+        std::vector<size_t> start(size() + 1, 0);
+        for (const Edge &edge : batch)
+        {
+            start[edge.from + 1]++;
+        }
+        for (size_t from = 0; from < size(); ++from)
+        {
+            start[from + 1] += start[from];
+        }
+        std::vector<Edge> sorted(batch.size());
+        {
+            std::vector<size_t> cursor(start.begin(), start.end() - 1);
+            for (const Edge &edge : batch)
+            {
+                sorted[cursor[edge.from]++] = edge;
+            }
+        }
+        linal::ParallelForRanges(size(), 1024, [&](size_t first, size_t last)
+                                 {
+                                     for (size_t from = first; from < last; ++from)
+                                     {
+                                         std::stable_sort(sorted.begin() + start[from], sorted.begin() + start[from + 1],
+                                                          [](const Edge &lhs, const Edge &rhs)
+                                                          { return lhs.to < rhs.to; });
+                                     } });
+
+        std::vector<size_t> offsets(size() + 1, 0);
+        std::vector<index_type> targets;
+        std::vector<EdgeWeight> weights;
+        targets.reserve(outTargets_.size() + batch.size());
+        weights.reserve(outTargets_.size() + batch.size());
+
+        for (size_t from = 0; from < size(); ++from)
+        {
+            size_t edge = outOffsets_[from];
+            const size_t last = outOffsets_[from + 1];
+            size_t next = start[from];
+            const size_t end = start[from + 1];
+            while (edge < last || next < end)
+            {
+                if (next < end && (edge == last || sorted[next].to <= outTargets_[edge]))
+                {
+                    // The last of the equal batch entries replaces the existing edge
+                    const size_t to = sorted[next].to;
+                    while (next + 1 < end && sorted[next + 1].to == to)
+                    {
+                        next++;
+                    }
+                    if (edge < last && outTargets_[edge] == to)
+                    {
+                        edge++;
+                    }
+                    if (detail::IsEdge(sorted[next].weight))
+                    {
+                        targets.push_back(static_cast<index_type>(to));
+                        weights.push_back(sorted[next].weight);
+                    }
+                    next++;
+                }
+                else
+                {
+                    targets.push_back(outTargets_[edge]);
+                    weights.push_back(outWeights_[edge]);
+                    edge++;
+                }
+            }
+            offsets[from + 1] = targets.size();
+        }
+
+        outOffsets_ = std::move(offsets);
+        outTargets_ = std::move(targets);
+        outWeights_ = std::move(weights);
+        RebuildIn();
+    }
+
+    void clear_edges()
+    {
+        std::fill(outOffsets_.begin(), outOffsets_.end(), 0);
+        std::fill(inOffsets_.begin(), inOffsets_.end(), 0);
+        outTargets_.clear();
+        outWeights_.clear();
+        inSources_.clear();
+        inWeights_.clear();
+    }
+
+    void clear_out(const size_t &index)
+    {
+        FilterOut([&](const size_t &from, const size_t &)
+                  { return from != index; });
+        RebuildIn();
+    }
+
+    void clear_in(const size_t &index)
+    {
+        FilterOut([&](const size_t &, const size_t &to)
+                  { return to != index; });
+        RebuildIn();
+    }
+
+    size_t out_degree(const size_t &index) const
+    {
+        return outOffsets_[index + 1] - outOffsets_[index];
+    }
+
+    size_t in_degree(const size_t &index) const
+    {
+        return inOffsets_[index + 1] - inOffsets_[index];
+    }
+
+    template <typename F>
+    void for_each_out(const size_t &index, F &&f) const
+    {
+        view().for_each_out(index, std::forward<F>(f));
+    }
+
+    template <typename F>
+    void for_each_in(const size_t &index, F &&f) const
+    {
+        view().for_each_in(index, std::forward<F>(f));
+    }
+
+    // Raw compressed arrays for kernels that walk the whole structure
+    const size_t *out_offsets() const noexcept
+    {
+        return outOffsets_.data();
+    }
+
+    const index_type *out_targets() const noexcept
+    {
+        return outTargets_.data();
+    }
+
+    const EdgeWeight *out_weights() const noexcept
+    {
+        return outWeights_.data();
+    }
+
+    const size_t *in_offsets() const noexcept
+    {
+        return inOffsets_.data();
+    }
+
+    const index_type *in_sources() const noexcept
+    {
+        return inSources_.data();
+    }
+
+    const EdgeWeight *in_weights() const noexcept
+    {
+        return inWeights_.data();
+    }
+
+    // Dense adjacency matrix indexed (to, from)
+    linal::Matrix<EdgeWeight> matrix() const
+    {
+        return view().matrix();
+    }
+
+    // Read-only view of the compressed arrays
+    CsrView<EdgeWeight> view() const noexcept
+    {
+        return CsrView<EdgeWeight>(size(), outOffsets_.data(), outTargets_.data(), outWeights_.data(),
+                                   inOffsets_.data(), inSources_.data(), inWeights_.data());
+    }
+
+    void swap(CsrStorage &other)
+    {
+        outOffsets_.swap(other.outOffsets_);
+        outTargets_.swap(other.outTargets_);
+        outWeights_.swap(other.outWeights_);
+        inOffsets_.swap(other.inOffsets_);
+        inSources_.swap(other.inSources_);
+        inWeights_.swap(other.inWeights_);
+    }
+};
+
+// Bit-packed adjacency for unweighted graphs: every node has a row of bits for its
+// out-neighbors and one for its in-neighbors, 64 edges per word. Any positive weight
+// stores an edge and weight() reads back 1. Degrees and edges() are popcounts,
+// neighbor iteration skips empty words, and rows can be intersected a word at a
+// time (see graph_triangles.h). Two bits per node pair is 4x less memory than a
+// DenseStorage<bool> and 16x less than a DenseStorage<float>.
+//
+// Rows have room for a capacity that grows geometrically, as in DenseStorage.
+template <typename EdgeWeight = bool>
+class BitsetStorage
+{
+public:
+    using word_type = std::uint64_t;
+    using weight_type = EdgeWeight;
+    using Edge = IndexedEdge<EdgeWeight>;
+
+private:
+    // Row i of out_ holds bit j if there is an edge i -> j, row i of in_ if j -> i
+    std::vector<word_type> out_, in_;
+    size_t size_ = 0;
+    // Words per row
+    size_t stride_ = 0;
+
+    size_t capacity() const noexcept
+    {
+        return stride_ * 64;
+    }
+
+    // Words per row in use
+    size_t used() const noexcept
+    {
+        return (size_ + 63) / 64;
+    }
+
+    static bool Test(const word_type *row, const size_t &bit)
+    {
+        return (row[bit / 64] >> (bit % 64)) & 1;
+    }
+
+    static void Set(word_type *row, const size_t &bit)
+    {
+        row[bit / 64] |= word_type(1) << (bit % 64);
+    }
+
+    static void Reset(word_type *row, const size_t &bit)
+    {
+        row[bit / 64] &= ~(word_type(1) << (bit % 64));
+    }
+
+    // Removes a bit from a row, the bits above it move down by one
+    static void RemoveBit(word_type *row, const size_t &words, const size_t &bit)
+    {
+        const size_t word = bit / 64, offset = bit % 64;
+        const word_type low = row[word] & ((word_type(1) << offset) - 1);
+        const word_type high = offset == 63 ? 0 : (row[word] >> (offset + 1)) << offset;
+        row[word] = low | high;
+        for (size_t next = word + 1; next < words; ++next)
+        {
+            row[next - 1] |= row[next] << 63;
+            row[next] >>= 1;
+        }
+    }
+
+    // Removes row and column index from a bit matrix of the current size
+    void EraseNode(std::vector<word_type> &bits, const size_t &index)
+    {
+        std::copy(bits.begin() + (index + 1) * stride_, bits.begin() + size_ * stride_, bits.begin() + index * stride_);
+        std::fill(bits.begin() + (size_ - 1) * stride_, bits.begin() + size_ * stride_, word_type(0));
+        for (size_t i = 0; i + 1 < size_; ++i)
+        {
+            RemoveBit(bits.data() + i * stride_, used(), index);
+        }
+    }
+
+    template <typename F>
+    void VisitBits(const word_type *row, F &&f) const
+    {
+        for (size_t word = 0; word < used(); ++word)
+        {
+            for (word_type bits = row[word]; bits != 0; bits &= bits - 1)
+            {
+                if (!detail::Visit(f, word * 64 + detail::CountTrailingZeros(bits), EdgeWeight(1)))
+                {
+                    return;
+                }
+            }
+        }
+    }
+
+    size_t CountBits(const word_type *row) const
+    {
+        size_t count = 0;
+        for (size_t word = 0; word < used(); ++word)
+        {
+            count += detail::PopCount(row[word]);
+        }
+        return count;
+    }
+
+public:
+    BitsetStorage() = default;
+
+    // Takes every positive element (to, from) of a square adjacency matrix as an edge
+    explicit BitsetStorage(const linal::Matrix<EdgeWeight> &matrix)
+    {
+        add_nodes(matrix.rows());
+        for (size_t to = 0; to < size_; ++to)
+        {
+            for (size_t from = 0; from < size_; ++from)
+            {
+                if (detail::IsEdge(matrix(to, from)))
+                {
+                    set(from, to, matrix(to, from));
+                }
+            }
+        }
+    }
+
+    size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    size_t edges() const
+    {
+        size_t count = 0;
+        for (size_t from = 0; from < size_; ++from)
+        {
+            count += CountBits(out_row(from));
+        }
+        return count;
+    }
+
+    void clear()
+    {
+        *this = BitsetStorage();
+    }
+
+    // Makes room for n nodes without further reallocation
+    void reserve(const size_t &n)
+    {
+        const size_t stride = (n + 63) / 64;
+        if (stride <= stride_)
+        {
+            return;
+        }
+
+        std::vector<word_type> out(stride * stride * 64, 0), in(stride * stride * 64, 0);
+        for (size_t i = 0; i < size_; ++i)
+        {
+            std::copy(out_row(i), out_row(i) + stride_, out.data() + i * stride);
+            std::copy(in_row(i), in_row(i) + stride_, in.data() + i * stride);
+        }
+        out_.swap(out);
+        in_.swap(in);
+        stride_ = stride;
+    }
+
+    // Appends count isolated nodes, the padding is already zero
+    void add_nodes(const size_t &count)
+    {
+        if (size_ + count > capacity())
+        {
+            reserve(std::max(size_ + count, 2 * capacity()));
+        }
+        size_ += count;
+    }
+
+    // Removes the node and its edges, the following nodes move down by one index
+    void erase_node(const size_t &index)
+    {
+        EraseNode(out_, index);
+        EraseNode(in_, index);
+        size_--;
+    }
+
+    bool contains(const size_t &from, const size_t &to) const
+    {
+        return Test(out_row(from), to);
+    }
+
+    EdgeWeight weight(const size_t &from, const size_t &to) const
+    {
+        return contains(from, to) ? EdgeWeight(1) : EdgeWeight();
+    }
+
+    // Stores the edge; a weight that is no edge removes it
+    void set(const size_t &from, const size_t &to, const EdgeWeight &weight)
+    {
+        if (!detail::IsEdge(weight))
+        {
+            erase(from, to);
+            return;
+        }
+        Set(out_.data() + from * stride_, to);
+        Set(in_.data() + to * stride_, from);
+    }
+
+    void erase(const size_t &from, const size_t &to)
+    {
+        Reset(out_.data() + from * stride_, to);
+        Reset(in_.data() + to * stride_, from);
+    }
+
+    // Stores a batch of edges; later duplicates win
+    void insert_edges(const std::vector<Edge> &batch)
+    {
+        for (const Edge &edge : batch)
+        {
+            if (edge.from >= size_ || edge.to >= size_)
+            {
+                throw std::out_of_range("Edge refers to a node out of range.");
+            }
+        }
+        for (const Edge &edge : batch)
+        {
+            set(edge.from, edge.to, edge.weight);
+        }
+    }
+
+    void clear_edges()
+    {
+        std::fill(out_.begin(), out_.end(), word_type(0));
+        std::fill(in_.begin(), in_.end(), word_type(0));
+    }
+
+    void clear_out(const size_t &index)
+    {
+        VisitBits(out_row(index), [&](const size_t &to, const EdgeWeight &)
+                  { Reset(in_.data() + to * stride_, index); });
+        std::fill(out_.begin() + index * stride_, out_.begin() + (index + 1) * stride_, word_type(0));
+    }
+
+    void clear_in(const size_t &index)
+    {
+        VisitBits(in_row(index), [&](const size_t &from, const EdgeWeight &)
+                  { Reset(out_.data() + from * stride_, index); });
+        std::fill(in_.begin() + index * stride_, in_.begin() + (index + 1) * stride_, word_type(0));
+    }
+
+    size_t out_degree(const size_t &index) const
+    {
+        return CountBits(out_row(index));
+    }
+
+    size_t in_degree(const size_t &index) const
+    {
+        return CountBits(in_row(index));
+    }
+
+    template <typename F>
+    void for_each_out(const size_t &index, F &&f) const
+    {
+        VisitBits(out_row(index), f);
+    }
+
+    template <typename F>
+    void for_each_in(const size_t &index, F &&f) const
+    {
+        VisitBits(in_row(index), f);
+    }
+
+    // Words per row in use; bits at or above size() are zero
+    size_t words() const noexcept
+    {
+        return used();
+    }
+
+    // Bit j of the row is set if there is an edge index -> j
+    const word_type *out_row(const size_t &index) const noexcept
+    {
+        return out_.data() + index * stride_;
+    }
+
+    // Bit j of the row is set if there is an edge j -> index
+    const word_type *in_row(const size_t &index) const noexcept
+    {
+        return in_.data() + index * stride_;
+    }
+
+    // Adjacency matrix indexed (to, from)
+    linal::Matrix<EdgeWeight> matrix() const
+    {
+        linal::Matrix<EdgeWeight> result(size_, size_, EdgeWeight());
+        for (size_t to = 0; to < size_; ++to)
+        {
+            VisitBits(in_row(to), [&](const size_t &from, const EdgeWeight &weight)
+                      { result(to, from) = weight; });
+        }
+        return result;
+    }
+
+    void swap(BitsetStorage &other)
+    {
+        out_.swap(other.out_);
+        in_.swap(other.in_);
+        std::swap(size_, other.size_);
+        std::swap(stride_, other.stride_);
+    }
+};
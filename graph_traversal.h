@@ -0,0 +1,548 @@
+#pragma once
+
+#include "graph.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+// Parallel traversals over the edge storage of a Graph (see graph_storage.h).
+// Every algorithm works on node indices, i.e. NodeId::index(), runs on the
+// shared linal::ThreadPool and accepts either a Graph or its storage().
+// Edge weights are ignored, only the presence of edges matters.
+
+// Marks nodes that were not reached
+constexpr size_t UNREACHED = std::numeric_limits<size_t>::max();
+
+struct BreadthFirstTree
+{
+    // Number of edges on a shortest path from the source, UNREACHED if there is none
+    std::vector<size_t> depth;
+    // Predecessor on such a path, the source is its own parent
+    std::vector<size_t> parent;
+};
+
+namespace detail
+{
+    using AtomicArray = std::unique_ptr<std::atomic<size_t>[]>;
+
+    inline AtomicArray MakeAtomicArray(const size_t &size, const size_t &value)
+    {
+        AtomicArray array(new std::atomic<size_t>[size]);
+        linal::ParallelForRanges(size, 1 << 14, [&](size_t first, size_t last)
+                                 {
+                                     for (size_t i = first; i < last; ++i)
+                                     {
+                                         array[i].store(value, std::memory_order_relaxed);
+                                     } });
+        return array;
+    }
+
+    inline std::vector<size_t> ToVector(const AtomicArray &array, const size_t &size)
+    {
+        std::vector<size_t> result(size);
+        linal::ParallelForRanges(size, 1 << 14, [&](size_t first, size_t last)
+                                 {
+                                     for (size_t i = first; i < last; ++i)
+                                     {
+                                         result[i] = array[i].load(std::memory_order_relaxed);
+                                     } });
+        return result;
+    }
+
+    // Claims an unreached slot, exactly one thread succeeds
+    inline bool Claim(std::atomic<size_t> &slot, const size_t &value)
+    {
+        size_t expected = UNREACHED;
+        return slot.load(std::memory_order_relaxed) == UNREACHED &&
+               slot.compare_exchange_strong(expected, value, std::memory_order_relaxed);
+    }
+
+    // One bit per node; bits can be set concurrently
+    class Bitmap
+    {
+    private:
+        size_t words_;
+        std::unique_ptr<std::atomic<std::uint64_t>[]> bits_;
+
+    public:
+        explicit Bitmap(const size_t &size) : words_((size + 63) / 64), bits_(new std::atomic<std::uint64_t>[words_])
+        {
+            reset();
+        }
+
+        size_t words() const noexcept
+        {
+            return words_;
+        }
+
+        void reset()
+        {
+            linal::ParallelForRanges(words_, 1 << 14, [&](size_t first, size_t last)
+                                     {
+                                         for (size_t word = first; word < last; ++word)
+                                         {
+                                             bits_[word].store(0, std::memory_order_relaxed);
+                                         } });
+        }
+
+        bool test(const size_t &index) const
+        {
+            return (bits_[index / 64].load(std::memory_order_relaxed) >> (index % 64)) & 1;
+        }
+
+        void set(const size_t &index)
+        {
+            bits_[index / 64].fetch_or(std::uint64_t(1) << (index % 64), std::memory_order_relaxed);
+        }
+
+        std::uint64_t word(const size_t &index) const
+        {
+            return bits_[index].load(std::memory_order_relaxed);
+        }
+
+        void swap(Bitmap &other) noexcept
+        {
+            std::swap(words_, other.words_);
+            bits_.swap(other.bits_);
+        }
+    };
+
+    // Appends a thread's share of the next frontier
+    inline void Append(std::vector<size_t> &frontier, std::mutex &mutex, const std::vector<size_t> &local)
+    {
+        if (!local.empty())
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            frontier.insert(frontier.end(), local.begin(), local.end());
+        }
+    }
+
+    // Level-synchronous top-down traversal from the seeds over out-edges (forward) or
+    // in-edges (backward), entering only nodes accepted by allowed(node) whose label
+    // can be claimed. Seeds must already carry their label.
+    template <typename Storage, typename F>
+    void Expand(const Storage &storage, std::vector<size_t> frontier, const bool &forward,
+                const AtomicArray &label, F &&allowed)
+    {
+        std::mutex mutex;
+        while (!frontier.empty())
+        {
+            std::vector<size_t> next;
+            linal::ParallelForRanges(frontier.size(), 64, [&](size_t first, size_t last)
+                                     {
+                                         std::vector<size_t> local;
+                                         for (size_t i = first; i < last; ++i)
+                                         {
+                                             const size_t u = frontier[i];
+                                             const size_t value = label[u].load(std::memory_order_relaxed);
+                                             auto visit = [&](const size_t &v, const auto &)
+                                             {
+                                                 if (allowed(v, value) && Claim(label[v], value))
+                                                 {
+                                                     local.push_back(v);
+                                                 }
+                                             };
+                                             if (forward)
+                                             {
+                                                 storage.for_each_out(u, visit);
+                                             }
+                                             else
+                                             {
+                                                 storage.for_each_in(u, visit);
+                                             }
+                                         }
+                                         Append(next, mutex, local); });
+            frontier.swap(next);
+        }
+    }
+}
+
+// Breadth-first search from source. Switches per level between a top-down step,
+// which expands the frontier queue along out-edges, and a bottom-up step, in which
+// every unreached node scans its in-edges for a parent in the frontier bitmap and
+// stops at the first hit. Bottom-up wins once the frontier covers a large share of
+// the edges (Beamer's heuristic with alpha = 15, beta = 18).
+template <typename Storage>
+BreadthFirstTree BreadthFirstSearch(const Storage &storage, const size_t &source)
+{
+    constexpr size_t ALPHA = 15, BETA = 18;
+
+    const size_t n = storage.size();
+    if (source >= n)
+    {
+        throw std::out_of_range("Source node out of range.");
+    }
+
+    BreadthFirstTree tree;
+    tree.depth.assign(n, UNREACHED);
+    detail::AtomicArray parent = detail::MakeAtomicArray(n, UNREACHED);
+    parent[source].store(source, std::memory_order_relaxed);
+    tree.depth[source] = 0;
+
+    // Out-edges not yet examined, for the switching heuristic
+    size_t edgesToCheck = storage.edges();
+    size_t scoutCount = storage.out_degree(source);
+
+    std::vector<size_t> queue{source};
+    detail::Bitmap current(n), next(n);
+    std::mutex mutex;
+    size_t level = 0;
+
+    while (!queue.empty())
+    {
+        if (scoutCount > edgesToCheck / ALPHA)
+        {
+            // Bottom-up while the frontier is large or still growing
+            for (const size_t &u : queue)
+            {
+                current.set(u);
+            }
+            size_t awake = queue.size();
+            size_t previous;
+            do
+            {
+                previous = awake;
+                std::atomic<size_t> count(0);
+                next.reset();
+                linal::ParallelForRanges(current.words(), 16, [&](size_t firstWord, size_t lastWord)
+                                         {
+                                             size_t local = 0;
+                                             const size_t last = std::min(n, lastWord * 64);
+                                             for (size_t v = firstWord * 64; v < last; ++v)
+                                             {
+                                                 if (parent[v].load(std::memory_order_relaxed) != UNREACHED)
+                                                 {
+                                                     continue;
+                                                 }
+                                                 storage.for_each_in(v, [&](const size_t &u, const auto &)
+                                                                     {
+                                                                         if (!current.test(u))
+                                                                         {
+                                                                             return true;
+                                                                         }
+                                                                         parent[v].store(u, std::memory_order_relaxed);
+                                                                         tree.depth[v] = level + 1;
+                                                                         next.set(v);
+                                                                         local++;
+                                                                         return false; });
+                                             }
+                                             count.fetch_add(local, std::memory_order_relaxed); });
+                awake = count.load();
+                current.swap(next);
+                level++;
+            } while (awake > 0 && (awake >= previous || awake > n / BETA));
+
+            // Back to a queue for the top-down steps
+            queue.clear();
+            linal::ParallelForRanges(current.words(), 1024, [&](size_t firstWord, size_t lastWord)
+                                     {
+                                         std::vector<size_t> local;
+                                         for (size_t word = firstWord; word < lastWord; ++word)
+                                         {
+                                             for (std::uint64_t bits = current.word(word); bits != 0; bits &= bits - 1)
+                                             {
+                                                 local.push_back(word * 64 + detail::CountTrailingZeros(bits));
+                                             }
+                                         }
+                                         detail::Append(queue, mutex, local); });
+            current.reset();
+            scoutCount = 1;
+            continue;
+        }
+
+        // Top-down step
+        edgesToCheck -= std::min(edgesToCheck, scoutCount);
+        std::vector<size_t> frontier;
+        std::atomic<size_t> scout(0);
+        linal::ParallelForRanges(queue.size(), 64, [&](size_t first, size_t last)
+                                 {
+                                     std::vector<size_t> local;
+                                     size_t degrees = 0;
+                                     for (size_t i = first; i < last; ++i)
+                                     {
+                                         const size_t u = queue[i];
+                                         storage.for_each_out(u, [&](const size_t &v, const auto &)
+                                                              {
+                                                                  if (detail::Claim(parent[v], u))
+                                                                  {
+                                                                      tree.depth[v] = level + 1;
+                                                                      local.push_back(v);
+                                                                      degrees += storage.out_degree(v);
+                                                                  } });
+                                     }
+                                     scout.fetch_add(degrees, std::memory_order_relaxed);
+                                     detail::Append(frontier, mutex, local); });
+        queue.swap(frontier);
+        scoutCount = scout.load();
+        level++;
+    }
+
+    tree.parent = detail::ToVector(parent, n);
+    return tree;
+}
+
+template <typename TNode, typename EdgeWeight, typename Storage>
+BreadthFirstTree BreadthFirstSearch(const Graph<TNode, EdgeWeight, Storage> &graph, const NodeId &source)
+{
+    return BreadthFirstSearch(graph.storage(), source.index());
+}
+
+// Weakly connected components, edge directions are ignored. Returns for every node
+// the smallest index in its component. Lock-free union-find: every edge links the
+// roots of its endpoints, the larger root is hooked below the smaller one with a
+// compare-and-swap, and finds halve the paths they walk.
+template <typename Storage>
+std::vector<size_t> ConnectedComponents(const Storage &storage)
+{
+    const size_t n = storage.size();
+    detail::AtomicArray parent(new std::atomic<size_t>[n]);
+    linal::ParallelForRanges(n, 1 << 14, [&](size_t first, size_t last)
+                             {
+                                 for (size_t v = first; v < last; ++v)
+                                 {
+                                     parent[v].store(v, std::memory_order_relaxed);
+                                 } });
+
+    auto find = [&](size_t v)
+    {
+        while (true)
+        {
+            size_t p = parent[v].load(std::memory_order_relaxed);
+            if (p == v)
+            {
+                return v;
+            }
+            const size_t grandparent = parent[p].load(std::memory_order_relaxed);
+            if (grandparent != p)
+            {
+                parent[v].compare_exchange_weak(p, grandparent, std::memory_order_relaxed);
+            }
+            v = grandparent;
+        }
+    };
+
+    linal::ParallelForRanges(n, 256, [&](size_t first, size_t last)
+                             {
+                                 for (size_t u = first; u < last; ++u)
+                                 {
+                                     storage.for_each_out(u, [&](const size_t &v, const auto &)
+                                                          {
+                                                              size_t a = u, b = v;
+                                                              while (true)
+                                                              {
+                                                                  a = find(a);
+                                                                  b = find(b);
+                                                                  if (a == b)
+                                                                  {
+                                                                      return;
+                                                                  }
+                                                                  if (a < b)
+                                                                  {
+                                                                      std::swap(a, b);
+                                                                  }
+                                                                  size_t expected = a;
+                                                                  if (parent[a].compare_exchange_strong(expected, b, std::memory_order_relaxed))
+                                                                  {
+                                                                      return;
+                                                                  }
+                                                              } });
+                                 } });
+
+    std::vector<size_t> component(n);
+    linal::ParallelForRanges(n, 1 << 14, [&](size_t first, size_t last)
+                             {
+                                 for (size_t v = first; v < last; ++v)
+                                 {
+                                     component[v] = find(v);
+                                 } });
+    return component;
+}
+
+template <typename TNode, typename EdgeWeight, typename Storage>
+std::vector<size_t> ConnectedComponents(const Graph<TNode, EdgeWeight, Storage> &graph)
+{
+    return ConnectedComponents(graph.storage());
+}
+
+// Strongly connected components. Returns for every node the index of a
+// representative of its component; two nodes share a component exactly when
+// they share the representative.
+//
+// 1. Trimming peels off nodes without incoming or outgoing edges among the
+//    remaining ones, each of them is a component of its own.
+// 2. Forward-backward search from the node with the largest degree product
+//    extracts the giant component, if any, with two parallel traversals.
+// 3. Coloring finishes the rest: the largest index that reaches a node is
+//    propagated along out-edges until nothing changes, then a backward search
+//    from every node that kept its own color collects its component within the
+//    color. Each round removes at least one component.
+template <typename Storage>
+std::vector<size_t> StronglyConnectedComponents(const Storage &storage)
+{
+    const size_t n = storage.size();
+    detail::AtomicArray component = detail::MakeAtomicArray(n, UNREACHED);
+    auto remaining = [&](const size_t &v)
+    {
+        return component[v].load(std::memory_order_relaxed) == UNREACHED;
+    };
+
+    // 1. Trimming with counts of remaining neighbors, self loops do not count
+    {
+        detail::AtomicArray in(new std::atomic<size_t>[n]), out(new std::atomic<size_t>[n]);
+        std::vector<size_t> frontier;
+        std::mutex mutex;
+        linal::ParallelForRanges(n, 256, [&](size_t first, size_t last)
+                                 {
+                                     std::vector<size_t> local;
+                                     for (size_t v = first; v < last; ++v)
+                                     {
+                                         size_t inCount = 0, outCount = 0;
+                                         storage.for_each_in(v, [&](const size_t &u, const auto &)
+                                                             { inCount += u != v; });
+                                         storage.for_each_out(v, [&](const size_t &u, const auto &)
+                                                              { outCount += u != v; });
+                                         in[v].store(inCount, std::memory_order_relaxed);
+                                         out[v].store(outCount, std::memory_order_relaxed);
+                                         if (inCount == 0 || outCount == 0)
+                                         {
+                                             component[v].store(v, std::memory_order_relaxed);
+                                             local.push_back(v);
+                                         }
+                                     }
+                                     detail::Append(frontier, mutex, local); });
+
+        while (!frontier.empty())
+        {
+            std::vector<size_t> next;
+            linal::ParallelForRanges(frontier.size(), 64, [&](size_t first, size_t last)
+                                     {
+                                         std::vector<size_t> local;
+                                         auto release = [&](const size_t &w, std::atomic<size_t> &count, const size_t &v)
+                                         {
+                                             if (w != v && remaining(w) && count.fetch_sub(1, std::memory_order_relaxed) == 1 &&
+                                                 detail::Claim(component[w], w))
+                                             {
+                                                 local.push_back(w);
+                                             }
+                                         };
+                                         for (size_t i = first; i < last; ++i)
+                                         {
+                                             const size_t v = frontier[i];
+                                             storage.for_each_out(v, [&](const size_t &w, const auto &)
+                                                                  { release(w, in[w], v); });
+                                             storage.for_each_in(v, [&](const size_t &w, const auto &)
+                                                                 { release(w, out[w], v); });
+                                         }
+                                         detail::Append(next, mutex, local); });
+            frontier.swap(next);
+        }
+    }
+
+    // 2. Forward-backward search from the pivot with the largest degree product
+    {
+        size_t pivot = UNREACHED, best = 0;
+        for (size_t v = 0; v < n; ++v)
+        {
+            const size_t score = storage.in_degree(v) * storage.out_degree(v);
+            if (remaining(v) && (pivot == UNREACHED || score > best))
+            {
+                pivot = v;
+                best = score;
+            }
+        }
+
+        if (pivot != UNREACHED)
+        {
+            detail::AtomicArray forward = detail::MakeAtomicArray(n, UNREACHED);
+            forward[pivot].store(pivot, std::memory_order_relaxed);
+            detail::Expand(storage, {pivot}, true, forward, [&](const size_t &v, const size_t &)
+                           { return remaining(v); });
+
+            component[pivot].store(pivot, std::memory_order_relaxed);
+            detail::Expand(storage, {pivot}, false, component, [&](const size_t &v, const size_t &)
+                           { return forward[v].load(std::memory_order_relaxed) != UNREACHED; });
+        }
+    }
+
+    // 3. Coloring rounds over whatever is left
+    detail::AtomicArray color(new std::atomic<size_t>[n]);
+    while (true)
+    {
+        std::vector<size_t> active;
+        for (size_t v = 0; v < n; ++v)
+        {
+            if (remaining(v))
+            {
+                active.push_back(v);
+            }
+        }
+        if (active.empty())
+        {
+            break;
+        }
+
+        linal::ParallelForRanges(active.size(), 1 << 12, [&](size_t first, size_t last)
+                                 {
+                                     for (size_t i = first; i < last; ++i)
+                                     {
+                                         color[active[i]].store(active[i], std::memory_order_relaxed);
+                                     } });
+
+        std::atomic<bool> changed(true);
+        while (changed.load())
+        {
+            changed.store(false);
+            linal::ParallelForRanges(active.size(), 256, [&](size_t first, size_t last)
+                                     {
+                                         bool local = false;
+                                         for (size_t i = first; i < last; ++i)
+                                         {
+                                             const size_t v = active[i];
+                                             const size_t value = color[v].load(std::memory_order_relaxed);
+                                             storage.for_each_out(v, [&](const size_t &w, const auto &)
+                                                                  {
+                                                                      if (!remaining(w))
+                                                                      {
+                                                                          return;
+                                                                      }
+                                                                      size_t current = color[w].load(std::memory_order_relaxed);
+                                                                      while (current < value &&
+                                                                             !color[w].compare_exchange_weak(current, value, std::memory_order_relaxed))
+                                                                      {
+                                                                      }
+                                                                      local |= current < value;
+                                                                  });
+                                         }
+                                         if (local)
+                                         {
+                                             changed.store(true, std::memory_order_relaxed);
+                                         } });
+        }
+
+        std::vector<size_t> roots;
+        for (const size_t &v : active)
+        {
+            if (color[v].load(std::memory_order_relaxed) == v)
+            {
+                component[v].store(v, std::memory_order_relaxed);
+                roots.push_back(v);
+            }
+        }
+        detail::Expand(storage, roots, false, component, [&](const size_t &v, const size_t &root)
+                       { return color[v].load(std::memory_order_relaxed) == root; });
+    }
+
+    return detail::ToVector(component, n);
+}
+
+template <typename TNode, typename EdgeWeight, typename Storage>
+std::vector<size_t> StronglyConnectedComponents(const Graph<TNode, EdgeWeight, Storage> &graph)
+{
+    return StronglyConnectedComponents(graph.storage());
+}
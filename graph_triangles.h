@@ -0,0 +1,242 @@
+#pragma once
+
+#include "graph.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Neighborhood queries over the edge storage of a Graph (see graph_storage.h).
+// They look at the undirected simple graph underneath: edge directions are
+// ignored and self loops do not count, so the neighbors of a node are everything
+// it has an edge to or from, other than itself.
+//
+// On BitsetStorage the neighborhoods are bit rows and every intersection is a run
+// of word-wide ANDs and popcounts. Other storages collect sorted neighbor lists
+// and merge them.
+
+namespace detail
+{
+    template <typename Storage, typename = void>
+    struct HasBitRows : std::false_type
+    {
+    };
+
+    template <typename Storage>
+    struct HasBitRows<Storage, std::void_t<decltype(std::declval<const Storage &>().out_row(0)),
+                                           decltype(std::declval<const Storage &>().in_row(0)),
+                                           decltype(std::declval<const Storage &>().words())>> : std::true_type
+    {
+    };
+
+    // Word of the undirected neighborhood of node
+    template <typename Storage>
+    std::uint64_t NeighborWord(const Storage &storage, const size_t &node, const size_t &word)
+    {
+        std::uint64_t bits = storage.out_row(node)[word] | storage.in_row(node)[word];
+        if (word == node / 64)
+        {
+            bits &= ~(std::uint64_t(1) << (node % 64));
+        }
+        return bits;
+    }
+
+    // Sorted undirected neighbors of node
+    template <typename Storage>
+    std::vector<size_t> Neighbors(const Storage &storage, const size_t &node)
+    {
+        std::vector<size_t> neighbors;
+        auto collect = [&](const size_t &other, const auto &)
+        {
+            if (other != node)
+            {
+                neighbors.push_back(other);
+            }
+        };
+        storage.for_each_out(node, collect);
+        storage.for_each_in(node, collect);
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+        return neighbors;
+    }
+
+    template <typename Storage>
+    void CheckNodes(const Storage &storage, const size_t &u, const size_t &v)
+    {
+        if (u >= storage.size() || v >= storage.size())
+        {
+            throw std::out_of_range("Node out of range.");
+        }
+    }
+}
+
+// Nodes adjacent to both u and v, in increasing order
+template <typename Storage>
+std::vector<size_t> CommonNeighbors(const Storage &storage, const size_t &u, const size_t &v)
+{
+    detail::CheckNodes(storage, u, v);
+    std::vector<size_t> common;
+    if constexpr (detail::HasBitRows<Storage>::value)
+    {
+        for (size_t word = 0; word < storage.words(); ++word)
+        {
+            std::uint64_t bits = detail::NeighborWord(storage, u, word) & detail::NeighborWord(storage, v, word);
+            for (; bits != 0; bits &= bits - 1)
+            {
+                common.push_back(word * 64 + detail::CountTrailingZeros(bits));
+            }
+        }
+    }
+    else
+    {
+        const std::vector<size_t> first = detail::Neighbors(storage, u), second = detail::Neighbors(storage, v);
+        std::set_intersection(first.begin(), first.end(), second.begin(), second.end(), std::back_inserter(common));
+    }
+    return common;
+}
+
+template <typename TNode, typename EdgeWeight, typename Storage>
+std::vector<size_t> CommonNeighbors(const Graph<TNode, EdgeWeight, Storage> &graph, const NodeId &u, const NodeId &v)
+{
+    return CommonNeighbors(graph.storage(), u.index(), v.index());
+}
+
+// Number of nodes adjacent to both u and v
+template <typename Storage>
+size_t CountCommonNeighbors(const Storage &storage, const size_t &u, const size_t &v)
+{
+    if constexpr (detail::HasBitRows<Storage>::value)
+    {
+        detail::CheckNodes(storage, u, v);
+        size_t count = 0;
+        for (size_t word = 0; word < storage.words(); ++word)
+        {
+            count += detail::PopCount(detail::NeighborWord(storage, u, word) & detail::NeighborWord(storage, v, word));
+        }
+        return count;
+    }
+    else
+    {
+        return CommonNeighbors(storage, u, v).size();
+    }
+}
+
+template <typename TNode, typename EdgeWeight, typename Storage>
+size_t CountCommonNeighbors(const Graph<TNode, EdgeWeight, Storage> &graph, const NodeId &u, const NodeId &v)
+{
+    return CountCommonNeighbors(graph.storage(), u.index(), v.index());
+}
+
+// Number of triangles, each counted once. Every triangle u < v < w is found from
+// its edge (u, v) as a common neighbor w above v: with bit rows that is a masked
+// AND-popcount over the words from v on, otherwise a merge of the neighbor lists
+// restricted to higher indices.
+template <typename Storage>
+size_t TriangleCount(const Storage &storage)
+{
+    const size_t n = storage.size();
+    std::atomic<size_t> total(0);
+
+    if constexpr (detail::HasBitRows<Storage>::value)
+    {
+        const size_t words = storage.words();
+        // Undirected rows, so that every pair costs one AND per word
+        std::vector<std::uint64_t> rows(n * words);
+        linal::ParallelForRanges(n, 256, [&](size_t first, size_t last)
+                                 {
+                                     for (size_t u = first; u < last; ++u)
+                                     {
+                                         for (size_t word = 0; word < words; ++word)
+                                         {
+                                             rows[u * words + word] = detail::NeighborWord(storage, u, word);
+                                         }
+                                     } });
+
+        linal::ParallelForRanges(n, 16, [&](size_t first, size_t last)
+                                 {
+                                     size_t count = 0;
+                                     for (size_t u = first; u < last; ++u)
+                                     {
+                                         const std::uint64_t *rowU = rows.data() + u * words;
+                                         for (size_t word = u / 64; word < words; ++word)
+                                         {
+                                             std::uint64_t bits = rowU[word];
+                                             if (word == u / 64)
+                                             {
+                                                 bits &= u % 64 == 63 ? 0 : ~std::uint64_t(0) << (u % 64 + 1);
+                                             }
+                                             for (; bits != 0; bits &= bits - 1)
+                                             {
+                                                 const size_t v = word * 64 + detail::CountTrailingZeros(bits);
+                                                 const std::uint64_t *rowV = rows.data() + v * words;
+                                                 // Only common neighbors above v
+                                                 const size_t start = v / 64;
+                                                 const std::uint64_t above = v % 64 == 63 ? 0 : ~std::uint64_t(0) << (v % 64 + 1);
+                                                 count += detail::PopCount(rowU[start] & rowV[start] & above);
+                                                 for (size_t next = start + 1; next < words; ++next)
+                                                 {
+                                                     count += detail::PopCount(rowU[next] & rowV[next]);
+                                                 }
+                                             }
+                                         }
+                                     }
+                                     total.fetch_add(count, std::memory_order_relaxed); });
+    }
+    else
+    {
+        // Neighbors above every node, as sorted compressed lists
+        std::vector<std::vector<size_t>> higher(n);
+        linal::ParallelForRanges(n, 256, [&](size_t first, size_t last)
+                                 {
+                                     for (size_t u = first; u < last; ++u)
+                                     {
+                                         std::vector<size_t> neighbors = detail::Neighbors(storage, u);
+                                         higher[u].assign(std::upper_bound(neighbors.begin(), neighbors.end(), u),
+                                                          neighbors.end());
+                                     } });
+
+        linal::ParallelForRanges(n, 64, [&](size_t first, size_t last)
+                                 {
+                                     size_t count = 0;
+                                     for (size_t u = first; u < last; ++u)
+                                     {
+                                         for (const size_t &v : higher[u])
+                                         {
+                                             // Merge of the two lists, past v on the side of u
+                                             auto a = std::upper_bound(higher[u].begin(), higher[u].end(), v);
+                                             auto b = higher[v].begin();
+                                             while (a != higher[u].end() && b != higher[v].end())
+                                             {
+                                                 if (*a < *b)
+                                                 {
+                                                     ++a;
+                                                 }
+                                                 else if (*b < *a)
+                                                 {
+                                                     ++b;
+                                                 }
+                                                 else
+                                                 {
+                                                     count++;
+                                                     ++a;
+                                                     ++b;
+                                                 }
+                                             }
+                                         }
+                                     }
+                                     total.fetch_add(count, std::memory_order_relaxed); });
+    }
+
+    return total.load();
+}
+
+template <typename TNode, typename EdgeWeight, typename Storage>
+size_t TriangleCount(const Graph<TNode, EdgeWeight, Storage> &graph)
+{
+    return TriangleCount(graph.storage());
+}
@@ -0,0 +1,287 @@
+#ifndef MATHEMANIA_LU_H_
+#define MATHEMANIA_LU_H_
+
+#include <algorithm>
+#include <cmath>
+#include <memory_resource>
+#include <stdexcept>
+#include <utility>
+
+#include "gemm.h"
+#include "matrix.h"
+
+namespace linal
+{
+    // LU factorization with partial pivoting, P * A = L * U, of a square matrix.
+    // The factors are computed once and can be reused for any number of
+    // determinants, solves and inverses.
+    //
+    // The factorization is blocked and right-looking: a panel of LU_BLOCK
+    // columns is factored with row pivoting, the matching block row of U is
+    // obtained by a triangular solve, and the trailing submatrix is updated with
+    // one GEMM, which is where almost all of the O(n^3) work is spent.
+    template <typename T>
+    class LUDecomposition
+    {
+    private:
+        static constexpr size_t LU_BLOCK = 128;
+
+        size_t size_;
+        // Unit lower triangle holds L, upper triangle holds U, row-major
+        std::pmr::vector<T> lu_{CurrentMemoryResource()};
+        // Row i of P * A is row permutation_[i] of A
+        std::pmr::vector<size_t> permutation_{CurrentMemoryResource()};
+        int sign_;
+        bool singular_;
+
+        T &element(const size_t &row, const size_t &column)
+        {
+            return lu_[row * size_ + column];
+        }
+
+        const T &element(const size_t &row, const size_t &column) const
+        {
+            return lu_[row * size_ + column];
+        }
+
+        void SwapRows(const size_t &row1, const size_t &row2)
+        {
+            std::swap_ranges(lu_.begin() + row1 * size_, lu_.begin() + (row1 + 1) * size_,
+                             lu_.begin() + row2 * size_);
+            std::swap(permutation_[row1], permutation_[row2]);
+            sign_ = -sign_;
+        }
+
+        // Unblocked factorization of columns [first, last) over rows [first, size_)
+        void FactorPanel(const size_t &first, const size_t &last)
+        {
+            using std::abs;
+
+            for (size_t j = first; j < last; j++)
+            {
+                size_t pivot = j;
+                for (size_t i = j + 1; i < size_; i++)
+                {
+                    if (abs(element(i, j)) > abs(element(pivot, j)))
+                    {
+                        pivot = i;
+                    }
+                }
+
+                if (element(pivot, j) == T())
+                {
+                    singular_ = true;
+                    continue;
+                }
+
+                if (pivot != j)
+                {
+                    SwapRows(pivot, j);
+                }
+
+                const T diagonal = element(j, j);
+                for (size_t i = j + 1; i < size_; i++)
+                {
+                    T &multiplier = element(i, j);
+                    multiplier /= diagonal;
+                    for (size_t k = j + 1; k < last; k++)
+                    {
+                        element(i, k) -= multiplier * element(j, k);
+                    }
+                }
+            }
+        }
+
+        // Solves L11 * U12 = A12 in place for the block row [first, last)
+        void SolveBlockRow(const size_t &first, const size_t &last)
+        {
+            for (size_t i = first + 1; i < last; i++)
+            {
+                T *row = &element(i, last);
+                for (size_t k = first; k < i; k++)
+                {
+                    const T multiplier = element(i, k);
+                    const T *other = &element(k, last);
+                    for (size_t j = 0; j < size_ - last; j++)
+                    {
+                        row[j] -= multiplier * other[j];
+                    }
+                }
+            }
+        }
+
+        // Forward and back substitution for a row-major n x m right-hand side already permuted
+        void Substitute(T *x, const size_t &m) const
+        {
+            // L * Y = P * B, block rows below the diagonal block come from one GEMM
+            for (size_t first = 0; first < size_; first += LU_BLOCK)
+            {
+                const size_t last = std::min(size_, first + LU_BLOCK);
+                kernels::ParallelGemm(last - first, m, first, &element(first, 0), size_,
+                                      x, m, x + first * m, m, T(-1), true);
+                for (size_t i = first + 1; i < last; i++)
+                {
+                    for (size_t k = first; k < i; k++)
+                    {
+                        const T multiplier = element(i, k);
+                        for (size_t j = 0; j < m; j++)
+                        {
+                            x[i * m + j] -= multiplier * x[k * m + j];
+                        }
+                    }
+                }
+            }
+
+            // U * X = Y, walking the block rows bottom-up
+            for (size_t last = size_; last > 0;)
+            {
+                const size_t first = last > LU_BLOCK ? last - LU_BLOCK : 0;
+                kernels::ParallelGemm(last - first, m, size_ - last, &element(first, last), size_,
+                                      x + last * m, m, x + first * m, m, T(-1), true);
+                for (size_t i = last; i-- > first;)
+                {
+                    for (size_t k = i + 1; k < last; k++)
+                    {
+                        const T multiplier = element(i, k);
+                        for (size_t j = 0; j < m; j++)
+                        {
+                            x[i * m + j] -= multiplier * x[k * m + j];
+                        }
+                    }
+                    const T diagonal = element(i, i);
+                    for (size_t j = 0; j < m; j++)
+                    {
+                        x[i * m + j] /= diagonal;
+                    }
+                }
+                last = first;
+            }
+        }
+
+    public:
+        explicit LUDecomposition(const Matrix<T> &matrix)
+        {
+            if (!matrix.square())
+            {
+                throw std::invalid_argument("LU decomposition requires a square matrix.");
+            }
+
+            size_ = matrix.rows();
+            lu_.assign(matrix.data(), matrix.data() + size_ * size_);
+            permutation_.resize(size_);
+            for (size_t i = 0; i < size_; i++)
+            {
+                permutation_[i] = i;
+            }
+            sign_ = 1;
+            singular_ = false;
+
+            for (size_t first = 0; first < size_; first += LU_BLOCK)
+            {
+                const size_t last = std::min(size_, first + LU_BLOCK);
+                FactorPanel(first, last);
+                if (last == size_)
+                {
+                    break;
+                }
+
+                SolveBlockRow(first, last);
+
+                // A22 -= L21 * U12
+                const size_t rest = size_ - last;
+                kernels::ParallelGemm(rest, rest, last - first, &element(last, first), size_,
+                                      &element(first, last), size_, &element(last, last), size_,
+                                      T(-1), true);
+            }
+        }
+
+        size_t size() const noexcept
+        {
+            return size_;
+        }
+
+        bool singular() const noexcept
+        {
+            return singular_;
+        }
+
+        T Determinant() const
+        {
+            if (singular_)
+            {
+                return T();
+            }
+
+            T determinant = sign_ > 0 ? T(1) : T(-1);
+            for (size_t i = 0; i < size_; i++)
+            {
+                determinant *= element(i, i);
+            }
+            return determinant;
+        }
+
+        // Solves A * X = B for every column of B at once
+        Matrix<T> Solve(const Matrix<T> &rhs) const
+        {
+            if (rhs.rows() != size_)
+            {
+                throw std::invalid_argument("Right-hand side has a wrong number of rows.");
+            }
+            if (singular_)
+            {
+                throw std::runtime_error("Matrix is singular.");
+            }
+
+            const size_t m = rhs.columns();
+            Matrix<T> result(size_, m);
+            for (size_t i = 0; i < size_; i++)
+            {
+                std::copy(rhs.data() + permutation_[i] * m, rhs.data() + (permutation_[i] + 1) * m,
+                          result.data() + i * m);
+            }
+
+            Substitute(result.data(), m);
+            return result;
+        }
+
+        Matrix<T> Inverse() const
+        {
+            if (singular_)
+            {
+                throw std::runtime_error("Matrix is singular.");
+            }
+
+            // P * I, written directly instead of permuting an identity matrix
+            Matrix<T> result(size_, size_);
+            for (size_t i = 0; i < size_; i++)
+            {
+                result(i, permutation_[i]) = T(1);
+            }
+
+            Substitute(result.data(), size_);
+            return result;
+        }
+    };
+
+    template <typename T>
+    T Matrix<T>::Determinant() const
+    {
+        return LUDecomposition<T>(*this).Determinant();
+    }
+
+    template <typename T>
+    Matrix<T> Matrix<T>::Inverse() const
+    {
+        return LUDecomposition<T>(*this).Inverse();
+    }
+
+    template <typename T>
+    Matrix<T> Matrix<T>::Solve(const Matrix<T> &rhs) const
+    {
+        return LUDecomposition<T>(*this).Solve(rhs);
+    }
+}
+
+#endif
+
+// MATHEMANIA_LU_H_
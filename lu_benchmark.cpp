@@ -0,0 +1,48 @@
+#include <iostream>
+#include <optional>
+#include <random>
+#include "benchmark.h"
+#include "matrix.h"
+
+using namespace linal;
+
+int main()
+{
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> distribution(-1.0, 1.0);
+
+    for (size_t n = 256; n <= 4096; n *= 2)
+    {
+        Matrix<double> matrix(n, n);
+        Matrix<double> rhs(n, 16);
+        for (size_t index = 0; index < n * n; index++)
+        {
+            matrix.data()[index] = distribution(generator);
+        }
+        for (size_t index = 0; index < n * 16; index++)
+        {
+            rhs.data()[index] = distribution(generator);
+        }
+
+        std::optional<LUDecomposition<double>> lu;
+        const double factor = Time(1, [&]
+                                   { lu.emplace(matrix); });
+        double determinant = 0;
+        const double det = Time(1, [&]
+                                { determinant = lu->Determinant(); });
+        const double solve = Time(1, [&]
+                                  { lu->Solve(rhs); });
+        const double inverse = Time(1, [&]
+                                    { lu->Inverse(); });
+
+        const double flops = 2.0 / 3.0 * n * n * n;
+        std::cout << "n = " << n
+                  << " : factor " << factor << " ms (" << flops / factor / 1e6 << " GFLOP/s)"
+                  << ", determinant " << det << " ms"
+                  << ", solve 16 rhs " << solve << " ms"
+                  << ", inverse " << inverse << " ms"
+                  << ", det = " << determinant << "\n";
+    }
+
+    return 0;
+}
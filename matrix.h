@@ -7,6 +7,16 @@
 #include <iomanip>
 #include <exception>
 #include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <memory_resource>
+
+#include "expression.h"
+#include "gemm.h"
+#include "matrix_view.h"
+#include "memory.h"
+#include "simd.h"
+#include "transpose.h"
 
 typedef float Real;
 // typedef double Real;
@@ -70,45 +80,83 @@ namespace linal
         }
     };
 
-    class Vector
+    class Vector : public Expression<Vector>
     {
     protected:
-        std::vector<Real> values_;
+        // Allocated from the memory resource current at construction (see memory.h)
+        std::pmr::vector<Real> values_{CurrentMemoryResource()};
 
     public:
+        using value_type = Real;
+        static constexpr bool contiguous = true;
+
         Vector()
         {
-            values_ = std::vector<Real>();
+            values_ = std::pmr::vector<Real>(CurrentMemoryResource());
         }
 
         Vector(const Real &x)
         {
-            values_ = std::vector<Real>({x});
+            values_ = std::pmr::vector<Real>({x}, CurrentMemoryResource());
         }
 
         Vector(const Real &x, const Real &y)
         {
-            values_ = std::vector<Real>({x, y});
+            values_ = std::pmr::vector<Real>({x, y}, CurrentMemoryResource());
         }
 
         Vector(const Real &x, const Real &y, const Real &z)
         {
-            values_ = std::vector<Real>({x, y, z});
+            values_ = std::pmr::vector<Real>({x, y, z}, CurrentMemoryResource());
         }
 
         Vector(const Real &x, const Real &y, const Real &z, const Real &w)
         {
-            values_ = std::vector<Real>({x, y, z, w});
+            values_ = std::pmr::vector<Real>({x, y, z, w}, CurrentMemoryResource());
         }
 
         Vector(const std::initializer_list<Real> &lst)
         {
-            values_ = std::vector<Real>(lst);
+            values_ = std::pmr::vector<Real>(lst, CurrentMemoryResource());
         }
 
         Vector(const std::vector<Real> &vector)
         {
-            values_ = vector;
+            values_.assign(vector.begin(), vector.end());
+        }
+
+        // Copies take their storage from the current memory resource, not from the source's
+        Vector(const Vector &other)
+            : values_(other.values_, CurrentMemoryResource())
+        {
+        }
+
+        Vector(Vector &&other) = default;
+
+        Vector &operator=(const Vector &other) = default;
+
+        Vector &operator=(Vector &&other) = default;
+
+        // Evaluates an element-wise expression in one pass
+        template <typename E>
+        Vector(const Expression<E> &expression)
+        {
+            values_ = std::pmr::vector<Real>(expression.derived().size(), CurrentMemoryResource());
+            Evaluate(expression, values_.data());
+        }
+
+        // Evaluates an element-wise expression in one pass, reusing the storage when the size matches
+        template <typename E>
+        Vector &operator=(const Expression<E> &expression)
+        {
+            if (values_.size() != expression.derived().size())
+            {
+                *this = Vector(expression);
+                return *this;
+            }
+
+            Evaluate(expression, values_.data());
+            return *this;
         }
 
         Natural size() const
@@ -116,31 +164,29 @@ namespace linal
             return values_.size();
         }
 
+        size_t rows() const noexcept
+        {
+            return values_.size();
+        }
+
+        size_t columns() const noexcept
+        {
+            return 1;
+        }
+
         Real operator[](const Natural &index) const
         {
             return values_[index];
         }
 
-        Vector operator+(const Vector &vector) const
+        Real coefficient(const size_t &index) const
         {
-            std::vector<Real> values = values_;
-            for (Natural i = 0; i < values.size(); i++)
-            {
-                values[i] = values_[i] + vector[i];
-            }
-            
-            return Vector(values);
+            return values_[index];
         }
 
-        Vector operator*(const Real &number) const
+        const Real *data() const noexcept
         {
-            std::vector<Real> values = values_;
-            for (Natural i = 0; i < values.size(); i++)
-            {
-                values[i] = number * values_[i];
-            }
-            
-            return Vector(values);
+            return values_.data();
         }
     };
 
@@ -154,14 +200,7 @@ namespace linal
             throw std::exception();
         }
 
-        Real dot = 0.0;
-
-        for (Natural i = 0; i < n; i++)
-        {
-            dot += vector1[i] * vector2[i];
-        }
-
-        return dot;
+        return kernels::Dot(n, vector1.data(), vector2.data());
     }
 
     Real Norm(const Vector &vector)
@@ -171,17 +210,40 @@ namespace linal
 
     Real AngleRad(const Vector &vector1, const Vector &vector2)
     {
-        return acos(Dot(vector1, vector2) / sqrt(Dot(vector1, vector1) * Dot(vector2, vector2)));
+        if (vector1.size() != vector2.size())
+        {
+            throw std::exception();
+        }
+
+        // Both norms and the dot product come from a single pass over the data
+        Real gram[3];
+        kernels::Gram(vector1.size(), vector1.data(), vector2.data(), gram);
+        return acos(gram[0] / sqrt(gram[1] * gram[2]));
     }
 
+    // Extent of a Matrix dimension that is only known at run time
+    constexpr size_t Dynamic = 0;
+
+    // Matrix<T> has its shape chosen at run time and stores its elements on the heap.
+    // Matrix<T, Rows, Columns> has a compile-time shape and inline storage (see fixed_matrix.h).
+    template <typename T, size_t Rows = Dynamic, size_t Columns = Dynamic>
+    class Matrix;
+
     template <typename T>
-    class Matrix
+    class Matrix<T, Dynamic, Dynamic> : public Expression<Matrix<T>>
     {
+        template <typename, size_t, size_t>
+        friend class Matrix;
+
     protected:
         size_t rows_, columns_;
-        std::vector<T> values_;
+        // Allocated from the memory resource current at construction (see memory.h)
+        std::pmr::vector<T> values_{CurrentMemoryResource()};
 
     public:
+        using value_type = T;
+        static constexpr bool contiguous = true;
+
         void clear()
         {
             values_.clear();
@@ -189,6 +251,22 @@ namespace linal
             columns_ = 0;
         }
 
+        // Exchanges the buffers in O(1) when both use the same memory resource
+        void swap(Matrix &other)
+        {
+            if (values_.get_allocator() == other.values_.get_allocator())
+            {
+                std::swap(rows_, other.rows_);
+                std::swap(columns_, other.columns_);
+                values_.swap(other.values_);
+                return;
+            }
+
+            Matrix tmp(std::move(*this));
+            *this = std::move(other);
+            other = std::move(tmp);
+        }
+
         size_t rows() const noexcept
         {
             return rows_;
@@ -199,11 +277,134 @@ namespace linal
             return columns_;
         }
 
+        size_t size() const noexcept
+        {
+            return values_.size();
+        }
+
+        bool square() const noexcept
+        {
+            return rows_ == columns_;
+        }
+
+        // Element at a row-major linear index, unchecked
+        T coefficient(const size_t &index) const
+        {
+            return values_[index];
+        }
+
+        T *data() noexcept
+        {
+            return values_.data();
+        }
+
+        const T *data() const noexcept
+        {
+            return values_.data();
+        }
+
+        auto begin() noexcept
+        {
+            return values_.begin();
+        }
+
+        auto end() noexcept
+        {
+            return values_.end();
+        }
+
+        auto begin() const noexcept
+        {
+            return values_.begin();
+        }
+
+        auto end() const noexcept
+        {
+            return values_.end();
+        }
+
+        // View of the whole matrix
+        MatrixView<T> view() noexcept
+        {
+            return MatrixView<T>(values_.data(), rows_, columns_, columns_);
+        }
+
+        MatrixView<const T> view() const noexcept
+        {
+            return MatrixView<const T>(values_.data(), rows_, columns_, columns_);
+        }
+
+        // View of the rows x columns block whose top-left corner is (row, column), no copy
+        MatrixView<T> Submatrix(const size_t &row, const size_t &column, const size_t &rows, const size_t &columns)
+        {
+            return view().Submatrix(row, column, rows, columns);
+        }
+
+        MatrixView<const T> Submatrix(const size_t &row, const size_t &column, const size_t &rows, const size_t &columns) const
+        {
+            return view().Submatrix(row, column, rows, columns);
+        }
+
+        // Copy of the matrix without the given row and column
+        Matrix Minor(const size_t &row, const size_t &column) const
+        {
+            if (rows_ <= row || columns_ <= column)
+            {
+                throw std::out_of_range("Index out of range.");
+            }
+
+            Matrix result(rows_ - 1, columns_ - 1);
+            for (size_t i = 0, target = 0; i < rows_; i++)
+            {
+                if (i == row)
+                {
+                    continue;
+                }
+                const T *source = values_.data() + i * columns_;
+                T *destination = result.values_.data() + target * result.columns_;
+                std::copy(source, source + column, destination);
+                std::copy(source + column + 1, source + columns_, destination + column);
+                target++;
+            }
+
+            return result;
+        }
+
+        // Removes a row and a column in place, compacting the storage without reallocating
+        void EraseRowAndColumn(const size_t &row, const size_t &column)
+        {
+            if (rows_ <= row || columns_ <= column)
+            {
+                throw std::out_of_range("Index out of range.");
+            }
+
+            T *values = values_.data();
+            // Elements ahead of the first erased one already sit in place
+            size_t target = row == 0 ? 0 : column;
+            for (size_t i = 0; i < rows_; i++)
+            {
+                if (i == row)
+                {
+                    continue;
+                }
+                const T *source = values + i * columns_;
+                if (i != 0)
+                {
+                    target = std::move(source, source + column, values + target) - values;
+                }
+                target = std::move(source + column + 1, source + columns_, values + target) - values;
+            }
+
+            rows_--;
+            columns_--;
+            values_.resize(rows_ * columns_);
+        }
+
         explicit Matrix()
         {
             rows_ = 0;
             columns_ = 0;
-            values_ = std::vector<T>(rows_ * columns_);
+            values_ = std::pmr::vector<T>(rows_ * columns_, CurrentMemoryResource());
         }
 
         // Constructs a square matrix
@@ -211,7 +412,7 @@ namespace linal
         {
             rows_ = size;
             columns_ = size;
-            values_ = std::vector<T>(rows_ * columns_);
+            values_ = std::pmr::vector<T>(rows_ * columns_, CurrentMemoryResource());
         }
 
         // Constructs a (n, m) matrix
@@ -219,7 +420,15 @@ namespace linal
         {
             rows_ = rows;
             columns_ = columns;
-            values_ = std::vector<T>(rows_ * columns_);
+            values_ = std::pmr::vector<T>(rows_ * columns_, CurrentMemoryResource());
+        }
+
+        // Constructs a (n, m) matrix filled with value
+        explicit Matrix(const size_t &rows, const size_t &columns, const T &value)
+        {
+            rows_ = rows;
+            columns_ = columns;
+            values_ = std::pmr::vector<T>(rows_ * columns_, value, CurrentMemoryResource());
         }
 
         template <typename Y>
@@ -227,7 +436,7 @@ namespace linal
         {
             rows_ = list.size();
             columns_ = 1;
-            values_ = std::vector<T>(rows_ * columns_);
+            values_ = std::pmr::vector<T>(rows_ * columns_, CurrentMemoryResource());
 
             size_t index = 0;
             for (const auto &value : list)
@@ -242,7 +451,7 @@ namespace linal
         {
             rows_ = list.size();
             columns_ = list.begin()->size();
-            values_ = std::vector<T>(rows_ * columns_);
+            values_ = std::pmr::vector<T>(rows_ * columns_, CurrentMemoryResource());
 
             size_t row_index = 0;
             for (const auto &row : list)
@@ -264,6 +473,14 @@ namespace linal
             }
         }
 
+        // Copies take their storage from the current memory resource, not from the source's
+        Matrix(const Matrix &other)
+            : rows_(other.rows_), columns_(other.columns_), values_(other.values_, CurrentMemoryResource())
+        {
+        }
+
+        Matrix &operator=(const Matrix &other) = default;
+
         ~Matrix() = default;
 
         // Copy constructor
@@ -272,7 +489,7 @@ namespace linal
         {
             rows_ = other.rows();
             columns_ = other.columns();
-            values_ = std::vector<T>(rows_ * columns_);
+            values_ = std::pmr::vector<T>(rows_ * columns_, CurrentMemoryResource());
 
             for (size_t index = 0; index < rows_ * columns_; index++)
             {
@@ -280,13 +497,21 @@ namespace linal
             }
         }
 
-        // Move constructors
-        template <typename Y>
-        explicit Matrix(Matrix<Y> &&other) noexcept
+        // Takes over the buffer of other in O(1), other is left empty
+        Matrix(Matrix &&other) noexcept
+            : rows_(other.rows_), columns_(other.columns_), values_(std::move(other.values_))
+        {
+            other.rows_ = 0;
+            other.columns_ = 0;
+        }
+
+        // Converting move, the elements have to be converted one by one
+        template <typename Y, typename = std::enable_if_t<!std::is_same_v<T, Y>>>
+        explicit Matrix(Matrix<Y> &&other)
         {
             rows_ = other.rows_;
             columns_ = other.columns_;
-            values_ = std::vector<T>(rows_ * columns_);
+            values_ = std::pmr::vector<T>(rows_ * columns_, CurrentMemoryResource());
 
             for (size_t index = 0; index < rows_ * columns_; index++)
             {
@@ -295,6 +520,18 @@ namespace linal
             other.clear();
         }
 
+        // Evaluates an element-wise expression in one pass
+        template <typename E>
+        Matrix(const Expression<E> &expression)
+        {
+            const E &source = expression.derived();
+            rows_ = source.rows();
+            columns_ = source.columns();
+            values_ = std::pmr::vector<T>(rows_ * columns_, CurrentMemoryResource());
+
+            Evaluate(expression, values_.data());
+        }
+
         T at(const size_t &index) const
         {
             if (index < 0 || rows_ * columns_ <= index)
@@ -320,6 +557,17 @@ namespace linal
             return values_[row * columns_ + column];
         }
 
+        // Element access without bounds checking
+        T &operator()(const size_t &row, const size_t &column)
+        {
+            return values_[row * columns_ + column];
+        }
+
+        const T &operator()(const size_t &row, const size_t &column) const
+        {
+            return values_[row * columns_ + column];
+        }
+
         // std::vector<T> &operator[](const size_t &row, const size_t &column);
         // std::vector<T> operator[](const size_t &, const size_t &) const;
 
@@ -328,7 +576,7 @@ namespace linal
         {
             rows_ = other.rows();
             columns_ = other.columns();
-            values_ = std::vector<T>(rows_ * columns_);
+            values_ = std::pmr::vector<T>(rows_ * columns_, CurrentMemoryResource());
 
             for (size_t index = 0; index < rows_ * columns_; index++)
             {
@@ -338,13 +586,30 @@ namespace linal
             return *this;
         }
 
-        // Move assignment operator
-        template <typename Y>
-        Matrix &operator=(Matrix<Y> &&other) noexcept
+        // Takes over the buffer of other in O(1) when both use the same memory resource;
+        // otherwise the elements are moved into the resource of *this. Other is left empty.
+        // noexcept so that containers move matrices; running out of memory in the
+        // cross-resource case terminates.
+        Matrix &operator=(Matrix &&other) noexcept
+        {
+            if (this != &other)
+            {
+                rows_ = other.rows_;
+                columns_ = other.columns_;
+                values_ = std::move(other.values_);
+                other.clear();
+            }
+
+            return *this;
+        }
+
+        // Converting move assignment, the elements have to be converted one by one
+        template <typename Y, typename = std::enable_if_t<!std::is_same_v<T, Y>>>
+        Matrix &operator=(Matrix<Y> &&other)
         {
             rows_ = other.rows_;
             columns_ = other.columns_;
-            values_ = std::vector<T>(rows_ * columns_);
+            values_ = std::pmr::vector<T>(rows_ * columns_, CurrentMemoryResource());
 
             for (size_t index = 0; index < rows_ * columns_; index++)
             {
@@ -356,72 +621,50 @@ namespace linal
             return *this;
         }
 
-        Matrix operator+() const
+        // Evaluates an element-wise expression in one pass. When the shape is unchanged
+        // the result is written in place: every element depends only on the elements at
+        // the same index, so operands aliasing *this are read before they are overwritten.
+        template <typename E>
+        Matrix &operator=(const Expression<E> &expression)
         {
-            return *this;
-        }
-
-        // Matrix operator-() const
-        // {
-        //     return -1 * *this;
-        // }
-
-        // Matrix addition
-        template <typename Y>
-        Matrix operator+(const Matrix<Y> &other) const
-        {
-            if (rows_ != other.rows_ || columns_ != other.columns_)
+            const E &source = expression.derived();
+            if (rows_ != source.rows() || columns_ != source.columns())
             {
-                throw std::exception();
+                // Moving the storage keeps the memory resource of *this
+                Matrix result(expression);
+                rows_ = result.rows_;
+                columns_ = result.columns_;
+                values_ = std::move(result.values_);
+                return *this;
             }
 
-            Matrix result(rows_, columns_);
-            for (size_t index = 0; index < rows_ * columns_; index++)
-            {
-                result.values_[index] = values_[index] + static_cast<T>(other.values_[index]);
-            }
+            Evaluate(expression, values_.data());
 
-            return result;
+            return *this;
         }
 
-        // Matrix-scalar multiplication
-        template <typename Y>
-        Matrix<T> operator*(const Y &scalar) const
+        Matrix operator+() const
         {
-            Matrix result(rows_, columns_);
-
-            for (size_t index = 0; index < rows_ * columns_; index++)
-            {
-                result.values_[index] = values_[index] * static_cast<T>(scalar);
-            }
-
-            return result;
+            return *this;
         }
 
-        // Matrix division by scalar
-        template <typename Y>
-        Matrix<T> operator/(const Y &scalar) const
-        {
-            Matrix result(rows_, columns_);
-
-            for (size_t index = 0; index < rows_ * columns_; index++)
-            {
-                result.values_[index] = values_[index] / static_cast<T>(scalar);
-            }
-
-            return result;
-        }
+        // Matrix operator-() const
+        // {
+        //     return -1 * *this;
+        // }
 
         // Matrix-matrix multiplication
         template <typename Y>
         Matrix<T> operator*(const Matrix<Y> &other) const
         {
-            if (columns_ != other.rows_)
+            if constexpr (!std::is_same_v<T, Y>)
             {
-                throw std::exception();
+                return *this * Matrix<T>(other);
+            }
+            else
+            {
+                return Multiply(view(), other.view());
             }
-
-            Matrix result;
         }
 
         template <typename Y>
@@ -458,47 +701,40 @@ namespace linal
             return false;
         }
 
-    private:
-        // Prints the contents of the matrix to console
-        friend std::ostream &operator<<(std::ostream &os, const Matrix &matrix)
+        Matrix Transpose() const
         {
-            const int WIDTH = 4;
+            Matrix result(columns_, rows_);
+            kernels::Transpose(rows_, columns_, values_.data(), columns_, result.values_.data(), rows_);
+            return result;
+        }
 
-            for (size_t row = 0; row < matrix.rows_; row++)
+        // Transposes without allocating when the matrix is square
+        Matrix &TransposeInPlace()
+        {
+            if (rows_ != columns_)
             {
-                if (row == 0)
-                {
-                    os << "{{ ";
-                }
-                else
-                {
-                    os << " { ";
-                }
+                *this = Transpose();
+                return *this;
+            }
 
-                // os << std::setw(WIDTH);
+            kernels::TransposeInPlace(rows_, values_.data(), columns_);
+            return *this;
+        }
 
-                for (size_t column = 0; column < matrix.columns_; column++)
-                {
-                    os << matrix.values_[row * matrix.columns_ + column];
+        // Determinant through LU decomposition, O(n^3)
+        T Determinant() const;
 
-                    if (column < matrix.columns_ - 1)
-                    {
-                        os << ", ";
-                        // os << std::setw(WIDTH);
-                    }
-                }
+        // Inverse through LU decomposition, O(n^3)
+        Matrix Inverse() const;
 
-                if (row < matrix.rows_ - 1)
-                {
-                    os << " } \n";
-                }
-                else
-                {
-                    os << " }}";
-                }
-            }
+        // Solves this * X = rhs for every column of rhs
+        Matrix Solve(const Matrix &rhs) const;
 
-            return os;
+    private:
+        // Prints the contents of the matrix to console
+        friend std::ostream &operator<<(std::ostream &os, const Matrix &matrix)
+        {
+            return os << matrix.view();
         }
 
         // Input matrix from console
@@ -515,14 +751,56 @@ namespace linal
             return is;
         }
 
-        // Matrix Transpose() const;
-        // Matrix<T> Submatrix(const size_t &, const size_t &) const;
-        // T Determinant() const;
-        // Matrix Minor(const size_t &row, const size_t &col) const
-        // Matrix Inverse() const;
     };
+
+    // Product of two views, written to a new matrix through the parallel GEMM
+    template <typename A, typename B>
+    Matrix<std::remove_const_t<A>> Multiply(const MatrixView<A> &left, const MatrixView<B> &right)
+    {
+        static_assert(std::is_same_v<std::remove_const_t<A>, std::remove_const_t<B>>,
+                      "Operands must have the same element type.");
+
+        if (left.columns() != right.rows())
+        {
+            throw std::exception();
+        }
+
+        Matrix<std::remove_const_t<A>> result(left.rows(), right.columns());
+        kernels::ParallelGemm(left.rows(), right.columns(), left.columns(),
+                              static_cast<const std::remove_const_t<A> *>(left.data()), left.stride(),
+                              static_cast<const std::remove_const_t<B> *>(right.data()), right.stride(),
+                              result.data(), result.columns());
+        return result;
+    }
+
+    template <typename A, typename B>
+    Matrix<std::remove_const_t<A>> operator*(const MatrixView<A> &left, const MatrixView<B> &right)
+    {
+        return Multiply(left, right);
+    }
+
+    template <typename A, typename T>
+    Matrix<T> operator*(const MatrixView<A> &left, const Matrix<T> &right)
+    {
+        return Multiply(left, right.view());
+    }
+
+    template <typename T, typename B>
+    Matrix<T> operator*(const Matrix<T> &left, const MatrixView<B> &right)
+    {
+        return Multiply(left.view(), right);
+    }
+
+    template <typename T>
+    void swap(Matrix<T> &matrix1, Matrix<T> &matrix2)
+    {
+        matrix1.swap(matrix2);
+    }
 }
 
+#include "lu.h"
+#include "fixed_matrix.h"
+
 #endif
 
 // MATHEMANIA_MATRIX_H_
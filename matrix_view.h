@@ -0,0 +1,181 @@
+#ifndef MATHEMANIA_MATRIX_VIEW_H_
+#define MATHEMANIA_MATRIX_VIEW_H_
+
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+
+#include "expression.h"
+
+namespace linal
+{
+    // Non-owning, strided window over row-major storage that belongs to a Matrix
+    // (or any other buffer). Element (row, column) lives at data[row * stride + column].
+    // Creating a view or a view of a view copies nothing and allocates nothing;
+    // the view must not outlive the storage it borrows.
+    //
+    // MatrixView<const T> is read-only. Assigning an expression to a MatrixView<T>
+    // writes through to the borrowed storage, so a view behaves like a reference:
+    // copy assignment copies elements, it does not rebind the view.
+    template <typename T>
+    class MatrixView : public Expression<MatrixView<T>>
+    {
+        template <typename Y>
+        friend class MatrixView;
+
+    private:
+        T *data_;
+        size_t rows_, columns_, stride_;
+
+    public:
+        using value_type = std::remove_const_t<T>;
+        static constexpr bool contiguous = false;
+
+        MatrixView(T *data, const size_t &rows, const size_t &columns, const size_t &stride)
+        {
+            data_ = data;
+            rows_ = rows;
+            columns_ = columns;
+            stride_ = stride;
+        }
+
+        MatrixView(const MatrixView &other) = default;
+
+        // A mutable view converts to a read-only one
+        template <typename Y, typename = std::enable_if_t<std::is_convertible_v<Y *, T *>>>
+        MatrixView(const MatrixView<Y> &other)
+        {
+            data_ = other.data_;
+            rows_ = other.rows_;
+            columns_ = other.columns_;
+            stride_ = other.stride_;
+        }
+
+        ~MatrixView() = default;
+
+        size_t rows() const noexcept
+        {
+            return rows_;
+        }
+
+        size_t columns() const noexcept
+        {
+            return columns_;
+        }
+
+        // Distance between the starts of two consecutive rows
+        size_t stride() const noexcept
+        {
+            return stride_;
+        }
+
+        size_t size() const noexcept
+        {
+            return rows_ * columns_;
+        }
+
+        bool square() const noexcept
+        {
+            return rows_ == columns_;
+        }
+
+        T *data() const noexcept
+        {
+            return data_;
+        }
+
+        // Element access without bounds checking
+        T &operator()(const size_t &row, const size_t &column) const
+        {
+            return data_[row * stride_ + column];
+        }
+
+        // Element at a row-major linear index of the view, unchecked
+        value_type coefficient(const size_t &index) const
+        {
+            return data_[index / columns_ * stride_ + index % columns_];
+        }
+
+        // View of the rows x columns block whose top-left corner is (row, column)
+        MatrixView Submatrix(const size_t &row, const size_t &column, const size_t &rows, const size_t &columns) const
+        {
+            if (rows_ < row + rows || columns_ < column + columns)
+            {
+                throw std::out_of_range("Submatrix out of range.");
+            }
+
+            return MatrixView(data_ + row * stride_ + column, rows, columns, stride_);
+        }
+
+        // Writes an element-wise expression of the same shape into the viewed block.
+        // Operands must not overlap the block at different positions.
+        template <typename E>
+        MatrixView &operator=(const Expression<E> &expression)
+        {
+            static_assert(!std::is_const_v<T>, "Can not assign through a read-only view.");
+
+            const E &source = expression.derived();
+            if (rows_ != source.rows() || columns_ != source.columns())
+            {
+                throw std::invalid_argument("Operands have different shapes.");
+            }
+
+            for (size_t row = 0; row < rows_; row++)
+            {
+                T *destination = data_ + row * stride_;
+                for (size_t column = 0; column < columns_; column++)
+                {
+                    destination[column] = static_cast<value_type>(source.coefficient(row * columns_ + column));
+                }
+            }
+
+            return *this;
+        }
+
+        MatrixView &operator=(const MatrixView &other)
+        {
+            return *this = static_cast<const Expression<MatrixView> &>(other);
+        }
+
+        // Prints the contents of the view to console
+        friend std::ostream &operator<<(std::ostream &os, const MatrixView &view)
+        {
+            for (size_t row = 0; row < view.rows_; row++)
+            {
+                if (row == 0)
+                {
+                    os << "{{ ";
+                }
+                else
+                {
+                    os << " { ";
+                }
+
+                for (size_t column = 0; column < view.columns_; column++)
+                {
+                    os << view(row, column);
+
+                    if (column < view.columns_ - 1)
+                    {
+                        os << ", ";
+                    }
+                }
+
+                if (row < view.rows_ - 1)
+                {
+                    os << " } \n";
+                }
+                else
+                {
+                    os << " }}";
+                }
+            }
+
+            return os;
+        }
+    };
+}
+
+#endif
+
+// MATHEMANIA_MATRIX_VIEW_H_
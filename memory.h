@@ -0,0 +1,99 @@
+#ifndef MATHEMANIA_MEMORY_H_
+#define MATHEMANIA_MEMORY_H_
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace linal
+{
+    namespace detail
+    {
+        inline std::pmr::memory_resource *&CurrentResourceSlot() noexcept
+        {
+            thread_local std::pmr::memory_resource *resource = nullptr;
+            return resource;
+        }
+    }
+
+    // Memory resource that new Matrix<T> and Vector storage is taken from on the
+    // calling thread. Defaults to std::pmr::get_default_resource().
+    inline std::pmr::memory_resource *CurrentMemoryResource() noexcept
+    {
+        std::pmr::memory_resource *resource = detail::CurrentResourceSlot();
+        return resource != nullptr ? resource : std::pmr::get_default_resource();
+    }
+
+    // Installs a memory resource on the calling thread for the lifetime of the object.
+    // Any std::pmr::memory_resource works, e.g. a pool or a custom allocator adapter.
+    // Scopes nest; the previous resource is restored on destruction.
+    class ScopedMemoryResource
+    {
+    private:
+        std::pmr::memory_resource *previous_;
+
+    public:
+        explicit ScopedMemoryResource(std::pmr::memory_resource *resource) noexcept
+        {
+            previous_ = detail::CurrentResourceSlot();
+            detail::CurrentResourceSlot() = resource;
+        }
+
+        ScopedMemoryResource(const ScopedMemoryResource &) = delete;
+        ScopedMemoryResource &operator=(const ScopedMemoryResource &) = delete;
+
+        ~ScopedMemoryResource()
+        {
+            detail::CurrentResourceSlot() = previous_;
+        }
+    };
+
+    // Bump arena for the temporaries of one computation, e.g. one request.
+    // Every Matrix<T> and Vector constructed on this thread while the arena is alive
+    // is carved out of a few large blocks; deallocation is a no-op and everything is
+    // released at once when the arena is destroyed.
+    //
+    // Objects allocated in the arena must not outlive it. Copy results that have to
+    // survive into storage created outside the scope (assigning to an existing
+    // object keeps that object's memory resource).
+    class ScopedArena
+    {
+    private:
+        std::pmr::monotonic_buffer_resource arena_;
+        ScopedMemoryResource scope_;
+
+    public:
+        // Blocks start at initialSize bytes and grow geometrically, taken from the
+        // resource that was current before the arena
+        explicit ScopedArena(const size_t &initialSize = 1 << 16)
+            : arena_(initialSize, CurrentMemoryResource()), scope_(&arena_)
+        {
+        }
+
+        // Serves allocations from a caller-provided buffer (e.g. on the stack) first
+        ScopedArena(void *buffer, const size_t &size)
+            : arena_(buffer, size, CurrentMemoryResource()), scope_(&arena_)
+        {
+        }
+
+        ScopedArena(const ScopedArena &) = delete;
+        ScopedArena &operator=(const ScopedArena &) = delete;
+
+        ~ScopedArena() = default;
+
+        std::pmr::memory_resource *resource() noexcept
+        {
+            return &arena_;
+        }
+
+        // Returns every block to the upstream resource; all objects allocated in the
+        // arena must already be destroyed
+        void release()
+        {
+            arena_.release();
+        }
+    };
+}
+
+#endif
+
+// MATHEMANIA_MEMORY_H_
@@ -0,0 +1,54 @@
+#include <iostream>
+#include <utility>
+#include <vector>
+#include "benchmark.h"
+#include "graph.h"
+
+int main()
+{
+    const size_t sizes[] = {256, 1024, 4096, 8192};
+
+    std::cout << "Matrix<float>, time per operation in us\n";
+    for (const size_t &n : sizes)
+    {
+        linal::Matrix<float> a(n, n, 1.0f), b(n, n, 2.0f);
+
+        const double copy = Time(3, [&]()
+                                 { linal::Matrix<float> c(a); }) * 1e3;
+        // Moves back and forth, so every move has a full matrix to take over
+        const double move = Time(1000, [&]()
+                                 {
+                                     linal::Matrix<float> c(std::move(a));
+                                     a = std::move(c); }) * 1e3;
+        const double swap = Time(1000, [&]()
+                                 { a.swap(b); }) * 1e3;
+
+        std::cout << "  " << n << "x" << n << " (" << n * n * sizeof(float) / (1 << 20) << " MB) : copy " << copy
+                  << ", move construct + move assign " << move << ", swap " << swap << "\n";
+    }
+
+    std::cout << "Graph<int, float>, time per operation in us\n";
+    for (const size_t &n : sizes)
+    {
+        std::vector<Node<int>> nodes;
+        for (size_t index = 0; index < n; index++)
+        {
+            nodes.push_back(Node<int>(static_cast<int>(index)));
+        }
+        Graph<int, float> a(nodes, linal::Matrix<float>(n, n, 1.0f)), b;
+
+        const double copy = Time(3, [&]()
+                                 { Graph<int, float> c(a); }) * 1e3;
+        const double move = Time(1000, [&]()
+                                 {
+                                     Graph<int, float> c(std::move(a));
+                                     a = std::move(c); }) * 1e3;
+        const double swap = Time(1000, [&]()
+                                 { a.swap(b); }) * 1e3;
+
+        std::cout << "  " << n << " nodes : copy " << copy << ", move construct + move assign " << move
+                  << ", swap " << swap << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+template <typename TNode>
+class Node;
+
+// Dense handle of a node: its position in the graph's edge storage, in [0, size()).
+// Ids are stable while nodes are only inserted; erasing a node moves every later
+// node down by one.
+class NodeId
+{
+private:
+    size_t index_;
+
+public:
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+    constexpr NodeId() noexcept : index_(npos)
+    {
+    }
+
+    constexpr explicit NodeId(const size_t &index) noexcept : index_(index)
+    {
+    }
+
+    constexpr size_t index() const noexcept
+    {
+        return index_;
+    }
+
+    constexpr bool valid() const noexcept
+    {
+        return index_ != npos;
+    }
+
+    constexpr explicit operator bool() const noexcept
+    {
+        return valid();
+    }
+
+    friend constexpr bool operator==(const NodeId &lhs, const NodeId &rhs) noexcept
+    {
+        return lhs.index_ == rhs.index_;
+    }
+
+    friend constexpr bool operator!=(const NodeId &lhs, const NodeId &rhs) noexcept
+    {
+        return lhs.index_ != rhs.index_;
+    }
+
+    friend constexpr bool operator<(const NodeId &lhs, const NodeId &rhs) noexcept
+    {
+        return lhs.index_ < rhs.index_;
+    }
+};
+
+// Maps node values to dense NodeIds with a flat open-addressing hash table
+// (linear probing, power-of-two capacity, load factor at most 1/2). Nodes are
+// stored contiguously in id order, so id -> node is a plain array access.
+//
+// A slot holds the id and a fragment of the hash, so most probes of a miss are
+// resolved without touching the node array. TNode needs std::hash and ==.
+template <typename TNode, typename Hash = std::hash<TNode>>
+class NodeIndex
+{
+private:
+    static constexpr std::uint32_t EMPTY = std::numeric_limits<std::uint32_t>::max();
+
+    struct Slot
+    {
+        std::uint32_t tag;
+        std::uint32_t id;
+    };
+
+    std::vector<Node<TNode>> nodes_;
+    std::vector<Slot> slots_;
+    Hash hash_;
+
+    // Spreads the bits of the user hash, std::hash of integers is the identity
+    static std::uint64_t Mix(std::uint64_t hash) noexcept
+    {
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    size_t mask() const noexcept
+    {
+        return slots_.size() - 1;
+    }
+
+    // Slot holding the node, or the empty slot where it would be inserted
+    size_t Probe(const TNode &data, const std::uint64_t &hash) const
+    {
+        const std::uint32_t tag = static_cast<std::uint32_t>(hash >> 32);
+        size_t slot = static_cast<size_t>(hash) & mask();
+        while (slots_[slot].id != EMPTY)
+        {
+            if (slots_[slot].tag == tag && nodes_[slots_[slot].id].GetData() == data)
+            {
+                return slot;
+            }
+            slot = (slot + 1) & mask();
+        }
+        return slot;
+    }
+
+    void Rehash(const size_t &capacity)
+    {
+        slots_.assign(capacity, Slot{0, EMPTY});
+        for (size_t id = 0; id < nodes_.size(); ++id)
+        {
+            const std::uint64_t hash = Mix(hash_(nodes_[id].GetData()));
+            size_t slot = static_cast<size_t>(hash) & mask();
+            while (slots_[slot].id != EMPTY)
+            {
+                slot = (slot + 1) & mask();
+            }
+            slots_[slot] = Slot{static_cast<std::uint32_t>(hash >> 32), static_cast<std::uint32_t>(id)};
+        }
+    }
+
+public:
+    NodeIndex() = default;
+
+    size_t size() const noexcept
+    {
+        return nodes_.size();
+    }
+
+    bool empty() const noexcept
+    {
+        return nodes_.empty();
+    }
+
+    void clear()
+    {
+        nodes_.clear();
+        slots_.clear();
+    }
+
+    // Makes room for n nodes without rehashing
+    void reserve(const size_t &n)
+    {
+        nodes_.reserve(n);
+        size_t capacity = 16;
+        while (capacity < 2 * n)
+        {
+            capacity *= 2;
+        }
+        if (capacity > slots_.size())
+        {
+            Rehash(capacity);
+        }
+    }
+
+    NodeId find(const Node<TNode> &node) const
+    {
+        if (slots_.empty())
+        {
+            return NodeId();
+        }
+        const std::uint32_t id = slots_[Probe(node.GetData(), Mix(hash_(node.GetData())))].id;
+        return id == EMPTY ? NodeId() : NodeId(id);
+    }
+
+    bool contains(const Node<TNode> &node) const
+    {
+        return find(node).valid();
+    }
+
+    // Appends the node with the next id unless it is present. Returns its id and
+    // whether it was inserted.
+    std::pair<NodeId, bool> insert(const Node<TNode> &node)
+    {
+        if (nodes_.size() >= static_cast<size_t>(EMPTY))
+        {
+            throw std::length_error("Too many nodes in the index.");
+        }
+        if (2 * (nodes_.size() + 1) > slots_.size())
+        {
+            Rehash(slots_.empty() ? 16 : 2 * slots_.size());
+        }
+
+        const std::uint64_t hash = Mix(hash_(node.GetData()));
+        const size_t slot = Probe(node.GetData(), hash);
+        if (slots_[slot].id != EMPTY)
+        {
+            return std::make_pair(NodeId(slots_[slot].id), false);
+        }
+
+        slots_[slot] = Slot{static_cast<std::uint32_t>(hash >> 32), static_cast<std::uint32_t>(nodes_.size())};
+        nodes_.push_back(node);
+        return std::make_pair(NodeId(nodes_.size() - 1), true);
+    }
+
+    // Removes the node; every later id moves down by one. One sequential pass over the table.
+    void erase(const NodeId &id)
+    {
+        const size_t erased = id.index();
+        size_t slot = Probe(nodes_[erased].GetData(), Mix(hash_(nodes_[erased].GetData())));
+
+        // Backward-shift deletion keeps every probe sequence unbroken without tombstones
+        size_t next = (slot + 1) & mask();
+        while (slots_[next].id != EMPTY)
+        {
+            const size_t home = static_cast<size_t>(Mix(hash_(nodes_[slots_[next].id].GetData()))) & mask();
+            if (((next - home) & mask()) >= ((next - slot) & mask()))
+            {
+                slots_[slot] = slots_[next];
+                slot = next;
+            }
+            next = (next + 1) & mask();
+        }
+        slots_[slot] = Slot{0, EMPTY};
+
+        for (Slot &entry : slots_)
+        {
+            if (entry.id != EMPTY && entry.id > erased)
+            {
+                entry.id--;
+            }
+        }
+        nodes_.erase(nodes_.begin() + erased);
+    }
+
+    const Node<TNode> &node(const NodeId &id) const
+    {
+        return nodes_[id.index()];
+    }
+
+    // Nodes in id order
+    auto begin() const noexcept
+    {
+        return nodes_.cbegin();
+    }
+
+    auto end() const noexcept
+    {
+        return nodes_.cend();
+    }
+
+    void swap(NodeIndex &other)
+    {
+        nodes_.swap(other.nodes_);
+        slots_.swap(other.slots_);
+        std::swap(hash_, other.hash_);
+    }
+};
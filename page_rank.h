@@ -0,0 +1,292 @@
+#pragma once
+
+#include "graph.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Sparse matrix-vector products and PageRank over the edge storage of a Graph
+// (see graph_storage.h). Like the traversals, everything works on node indices
+// and accepts either a Graph or its storage().
+//
+// All kernels pull along in-edges: the value of a node is the sum over the edges
+// entering it, so every output element is written by exactly one thread and no
+// atomics are needed. Nodes are split into ranges with about the same number of
+// in-edges each, so a few hubs do not leave the other threads idle.
+
+struct PageRankOptions
+{
+    // Probability of following an edge rather than teleporting
+    double damping = 0.85;
+    // Stops once the L1 distance between two iterations drops below this
+    double tolerance = 1e-6;
+    size_t maxIterations = 100;
+    // Follow edges in proportion to their weights instead of uniformly
+    bool weighted = false;
+};
+
+struct PageRankResult
+{
+    // Scores summing to one, indexed by node
+    std::vector<double> rank;
+    size_t iterations = 0;
+    // L1 distance between the last two iterations
+    double residual = 0;
+};
+
+namespace detail
+{
+    template <typename Storage, typename = void>
+    struct HasInOffsets : std::false_type
+    {
+    };
+
+    template <typename Storage>
+    struct HasInOffsets<Storage, std::void_t<decltype(std::declval<const Storage &>().in_offsets())>> : std::true_type
+    {
+    };
+
+    // Boundaries of node ranges with about the same number of in-edges plus nodes
+    // each. Dense rows all cost the same, so there the ranges are uniform.
+    template <typename Storage>
+    std::vector<size_t> BalancedRanges(const Storage &storage)
+    {
+        const size_t n = storage.size();
+        const size_t parts = linal::ThreadCount() == 1 ? 1 : std::max<size_t>(1, std::min(n / 64, 8 * linal::ThreadCount()));
+        std::vector<size_t> bounds(parts + 1, n);
+        bounds[0] = 0;
+        if constexpr (HasInOffsets<Storage>::value)
+        {
+            const size_t *offsets = storage.in_offsets();
+            const size_t total = offsets[n] + n;
+            size_t first = 0;
+            for (size_t part = 1; part < parts; ++part)
+            {
+                const size_t target = total * part / parts;
+                size_t low = first, high = n;
+                while (low < high)
+                {
+                    const size_t middle = low + (high - low) / 2;
+                    if (offsets[middle] + middle < target)
+                    {
+                        low = middle + 1;
+                    }
+                    else
+                    {
+                        high = middle;
+                    }
+                }
+                bounds[part] = first = low;
+            }
+        }
+        else
+        {
+            for (size_t part = 1; part < parts; ++part)
+            {
+                bounds[part] = n * part / parts;
+            }
+        }
+        return bounds;
+    }
+
+    // Calls body(first, last, part) for every balanced range in parallel
+    template <typename F>
+    void ForEachRange(const std::vector<size_t> &bounds, F &&body)
+    {
+        linal::ThreadPool::Instance().ParallelFor(bounds.size() - 1, [&](size_t part)
+                                                  { body(bounds[part], bounds[part + 1], part); });
+    }
+}
+
+// y = A x for the adjacency matrix A indexed (to, from): y[to] is the sum of
+// weight * x[from] over the edges entering `to`. x and y hold size() elements
+// and must not overlap.
+template <typename Storage, typename T>
+void SpMV(const Storage &storage, const T *x, T *y)
+{
+    using EdgeWeight = typename Storage::weight_type;
+    detail::ForEachRange(detail::BalancedRanges(storage), [&](size_t first, size_t last, size_t)
+                         {
+                             for (size_t to = first; to < last; ++to)
+                             {
+                                 T sum = T();
+                                 storage.for_each_in(to, [&](const size_t &from, const EdgeWeight &weight)
+                                                     { sum += static_cast<T>(weight) * x[from]; });
+                                 y[to] = sum;
+                             } });
+}
+
+template <typename Storage, typename T>
+std::vector<T> SpMV(const Storage &storage, const std::vector<T> &x)
+{
+    if (x.size() != storage.size())
+    {
+        throw std::invalid_argument("Vector size has to match the number of nodes.");
+    }
+    std::vector<T> y(x.size());
+    SpMV(storage, x.data(), y.data());
+    return y;
+}
+
+template <typename TNode, typename EdgeWeight, typename Storage, typename T>
+std::vector<T> SpMV(const Graph<TNode, EdgeWeight, Storage> &graph, const std::vector<T> &x)
+{
+    return SpMV(graph.storage(), x);
+}
+
+namespace detail
+{
+    // Power iteration for PageRank with the teleport distribution `teleport`.
+    // Rank held by nodes without out-edges is redistributed like a teleport.
+    template <typename Storage>
+    PageRankResult PageRank(const Storage &storage, const std::vector<double> &teleport, const PageRankOptions &options)
+    {
+        using EdgeWeight = typename Storage::weight_type;
+
+        if (!(options.damping >= 0 && options.damping < 1))
+        {
+            throw std::invalid_argument("Damping has to be in [0, 1).");
+        }
+
+        const size_t n = storage.size();
+        PageRankResult result;
+        if (n == 0)
+        {
+            return result;
+        }
+
+        const std::vector<size_t> bounds = BalancedRanges(storage);
+        const size_t parts = bounds.size() - 1;
+
+        // Total weight leaving every node, the out-degree when unweighted
+        std::vector<double> outWeight(n);
+        ForEachRange(bounds, [&](size_t first, size_t last, size_t)
+                     {
+                         for (size_t u = first; u < last; ++u)
+                         {
+                             double sum = 0;
+                             storage.for_each_out(u, [&](const size_t &, const EdgeWeight &weight)
+                                                  { sum += options.weighted ? static_cast<double>(weight) : 1.0; });
+                             outWeight[u] = sum;
+                         } });
+
+        std::vector<double> rank(teleport), next(n), contribution(n);
+        std::vector<double> partial(parts);
+        for (result.iterations = 0; result.iterations < options.maxIterations;)
+        {
+            // Share of every node per unit of outgoing weight, and the dangling rank
+            ForEachRange(bounds, [&](size_t first, size_t last, size_t part)
+                         {
+                             double dangling = 0;
+                             for (size_t u = first; u < last; ++u)
+                             {
+                                 if (outWeight[u] > 0)
+                                 {
+                                     contribution[u] = rank[u] / outWeight[u];
+                                 }
+                                 else
+                                 {
+                                     contribution[u] = 0;
+                                     dangling += rank[u];
+                                 }
+                             }
+                             partial[part] = dangling; });
+            double dangling = 0;
+            for (const double &value : partial)
+            {
+                dangling += value;
+            }
+
+            const double jump = 1 - options.damping + options.damping * dangling;
+            ForEachRange(bounds, [&](size_t first, size_t last, size_t part)
+                         {
+                             double residual = 0;
+                             for (size_t v = first; v < last; ++v)
+                             {
+                                 double sum = 0;
+                                 if (options.weighted)
+                                 {
+                                     storage.for_each_in(v, [&](const size_t &u, const EdgeWeight &weight)
+                                                         { sum += static_cast<double>(weight) * contribution[u]; });
+                                 }
+                                 else
+                                 {
+                                     storage.for_each_in(v, [&](const size_t &u, const EdgeWeight &)
+                                                         { sum += contribution[u]; });
+                                 }
+                                 next[v] = options.damping * sum + jump * teleport[v];
+                                 residual += std::abs(next[v] - rank[v]);
+                             }
+                             partial[part] = residual; });
+
+            rank.swap(next);
+            result.iterations++;
+            result.residual = 0;
+            for (const double &value : partial)
+            {
+                result.residual += value;
+            }
+            if (result.residual < options.tolerance)
+            {
+                break;
+            }
+        }
+
+        result.rank = std::move(rank);
+        return result;
+    }
+}
+
+// PageRank by pull-based power iteration: a random surfer follows an out-edge
+// with probability damping and jumps to a uniformly random node otherwise.
+template <typename Storage>
+PageRankResult PageRank(const Storage &storage, const PageRankOptions &options = PageRankOptions())
+{
+    const size_t n = storage.size();
+    return detail::PageRank(storage, std::vector<double>(n, n > 0 ? 1.0 / n : 0.0), options);
+}
+
+template <typename TNode, typename EdgeWeight, typename Storage>
+PageRankResult PageRank(const Graph<TNode, EdgeWeight, Storage> &graph, const PageRankOptions &options = PageRankOptions())
+{
+    return PageRank(graph.storage(), options);
+}
+
+// Personalized PageRank: the surfer jumps back to one of the seed nodes, chosen
+// uniformly, instead of to any node
+template <typename Storage>
+PageRankResult PersonalizedPageRank(const Storage &storage, const std::vector<size_t> &seeds,
+                                    const PageRankOptions &options = PageRankOptions())
+{
+    if (seeds.empty())
+    {
+        throw std::invalid_argument("Personalized PageRank needs at least one seed.");
+    }
+    std::vector<double> teleport(storage.size(), 0.0);
+    for (const size_t &seed : seeds)
+    {
+        if (seed >= storage.size())
+        {
+            throw std::out_of_range("Seed node out of range.");
+        }
+        teleport[seed] += 1.0 / seeds.size();
+    }
+    return detail::PageRank(storage, teleport, options);
+}
+
+template <typename TNode, typename EdgeWeight, typename Storage>
+PageRankResult PersonalizedPageRank(const Graph<TNode, EdgeWeight, Storage> &graph, const std::vector<NodeId> &seeds,
+                                    const PageRankOptions &options = PageRankOptions())
+{
+    std::vector<size_t> indices;
+    indices.reserve(seeds.size());
+    for (const NodeId &seed : seeds)
+    {
+        indices.push_back(seed.index());
+    }
+    return PersonalizedPageRank(graph.storage(), indices, options);
+}
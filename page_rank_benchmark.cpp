@@ -0,0 +1,47 @@
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "benchmark.h"
+#include "graph_generators.h"
+#include "page_rank.h"
+
+// Usage: page_rank_benchmark [smallest scale] [largest scale]
+// R-MAT graphs with edge factor 16; scales 13 to 23 span 10^5 to 10^8 edges.
+int main(int argc, char **argv)
+{
+    const size_t smallest = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 13;
+    const size_t largest = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20;
+
+    const size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> threadCounts;
+    for (size_t threads = 1; threads < hardware; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(hardware);
+
+    for (size_t scale = smallest; scale <= largest; scale++)
+    {
+        CsrStorage<float> storage;
+        storage.add_nodes(size_t(1) << scale);
+        storage.insert_edges(RMatEdges<float>(scale, 16));
+        std::cout << "R-MAT scale " << scale << ": " << storage.size() << " nodes, " << storage.edges() << " edges\n";
+
+        std::vector<double> x(storage.size(), 1.0), y(storage.size());
+        for (const size_t &threads : threadCounts)
+        {
+            linal::SetThreadCount(threads);
+            const double spmv = Time(10, [&]
+                                     { SpMV(storage, x.data(), y.data()); });
+            PageRankResult result;
+            const double pageRank = Time(1, [&]
+                                         { result = PageRank(storage); });
+            std::cout << "  threads = " << threads << " : SpMV " << spmv << " ms (" << 2 * storage.edges() / spmv / 1e6
+                      << " GFLOP/s), PageRank " << pageRank << " ms for " << result.iterations << " iterations ("
+                      << pageRank / result.iterations << " ms each)\n";
+        }
+    }
+
+    return 0;
+}
@@ -1,42 +1,374 @@
 #pragma once
 
+#include "fft.h"
+#include "simd.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
-#include <vector>
-#include <list>
-#include <set>
+#include <limits>
 #include <map>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+#include <vector>
 
 typedef float Real;
 
-// class RandomVariable {
-//     Real cumulative_distribution_function(Real);
-
-//     RandomVariable(Real CDF(Real)) {
-//         cumulative_distribution_function = CDF;
-//     }
-// }
+// Discrete random variable with finitely many values. The continuous ones are
+// RandomVariable and its subclasses further down.
+//
+// The distribution is kept as two parallel arrays, the support in increasing order
+// without duplicates and the probability of every value. Operations between two
+// variables first write every combination into one batch, then sort it once and
+// merge equal values, instead of inserting into a tree node by node.
+//
+// Sums of variables whose supports lie on a common lattice origin + k * step are
+// convolutions of the probability sequences and go through an FFT when that is
+// cheaper than all |X| * |Y| pairs; Sum(X, n) raises the transform to the n-th
+// power. Lattice results drop probabilities below LATTICE_CUTOFF, which are FFT
+// round-off rather than mass.
+//
+// With CompactionOptions set, every operation result is compacted to at most
+// budget values, so a chain of operations runs in constant memory and linear time.
+// The merge follows a t-digest scale: values are binned in order with bins that
+// hold the least probability in the tails, and every bin becomes one value at its
+// mean, so the expected value is kept exactly and quantiles move by at most the
+// probability of one bin.
+struct CompactionOptions
+{
+    // Most values kept after an operation, 0 for no limit
+    size_t budget = 0;
+    // Neighboring values closer than this relative distance are always merged
+    Real tolerance = 0;
+};
 
-// class DiscreteRandomVariable : public RandomVariable
 class DiscreteRandomVariable
 {
+public:
+    static constexpr double LATTICE_CUTOFF = 1e-12;
+    // Longest transform tried before falling back to pairwise sums
+    static constexpr size_t MAX_FFT_LENGTH = size_t(1) << 24;
+
 private:
-    std::map<Real, Real> probability_distribution;
+    std::vector<Real> values;
+    std::vector<Real> probabilities;
+    CompactionOptions compaction;
+
+    static double Gcd(double a, double b, const double &tolerance)
+    {
+        while (b > tolerance)
+        {
+            double remainder = std::fmod(a, b);
+            if (b - remainder <= tolerance)
+            {
+                remainder = 0;
+            }
+            a = b;
+            b = remainder;
+        }
+        return a;
+    }
+
+    // Largest step that all differences between the values are multiples of,
+    // 0 for a single value
+    static double LatticeStep(const std::vector<Real> &values)
+    {
+        double smallest = 0;
+        for (size_t i = 1; i < values.size(); ++i)
+        {
+            const double difference = double(values[i]) - double(values[i - 1]);
+            smallest = smallest == 0 ? difference : std::min(smallest, difference);
+        }
+        double step = 0;
+        for (size_t i = 1; i < values.size(); ++i)
+        {
+            const double difference = double(values[i]) - double(values[i - 1]);
+            step = step == 0 ? difference : Gcd(std::max(step, difference), std::min(step, difference), 1e-4 * smallest);
+        }
+        return step;
+    }
+
+    // Lattice index of every value relative to the smallest one, empty if some
+    // value is off the lattice
+    std::vector<size_t> LatticeIndices(const double &step) const
+    {
+        std::vector<size_t> indices(values.size());
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            const double offset = (double(values[i]) - double(values.front())) / step;
+            const double index = std::round(offset);
+            if (std::abs(offset - index) > 1e-4 + 1e-6 * std::abs(values[i]) / step)
+            {
+                return std::vector<size_t>();
+            }
+            indices[i] = static_cast<size_t>(index);
+        }
+        return indices;
+    }
+
+    // Probabilities of origin + k * step for every k
+    std::vector<double> LatticeProbabilities(const std::vector<size_t> &indices) const
+    {
+        std::vector<double> lattice(indices.back() + 1);
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+            lattice[indices[i]] += probabilities[i];
+        }
+        return lattice;
+    }
+
+    static DiscreteRandomVariable FromLattice(const double &origin, const double &step, const std::vector<double> &lattice)
+    {
+        std::vector<std::pair<Real, Real>> batch;
+        for (size_t k = 0; k < lattice.size(); ++k)
+        {
+            if (lattice[k] > LATTICE_CUTOFF)
+            {
+                batch.emplace_back(Real(origin + double(k) * step), Real(lattice[k]));
+            }
+        }
+        DiscreteRandomVariable result = Merge(batch);
+        result.NormalizeProbabilities();
+        return result;
+    }
+
+    // Whether a transform of the given length beats sorting that many pairs
+    static bool PreferFFT(const size_t &pairs, const size_t &length)
+    {
+        return length <= MAX_FFT_LENGTH && double(pairs) > 4.0 * double(length) * std::log2(double(length));
+    }
+
+    // X + Y as an FFT convolution, false if the supports share no lattice or the
+    // pairwise sum is cheaper
+    bool ConvolveOnLattice(const DiscreteRandomVariable &other, DiscreteRandomVariable &result) const
+    {
+        if (values.size() < 2 || other.values.size() < 2)
+        {
+            return false;
+        }
+        const double first = LatticeStep(values), second = LatticeStep(other.values);
+        const double step = Gcd(std::max(first, second), std::min(first, second), 1e-4 * std::min(first, second));
+        const std::vector<size_t> x = LatticeIndices(step), y = other.LatticeIndices(step);
+        if (x.empty() || y.empty() || !PreferFFT(values.size() * other.values.size(), FFTLength(x.back() + y.back() + 1)))
+        {
+            return false;
+        }
+        result = FromLattice(double(values.front()) + double(other.values.front()), step,
+                             Convolve(LatticeProbabilities(x), other.LatticeProbabilities(y)))
+                     .Bounded(Joined(other));
+        return true;
+    }
+
+    // Sorts the (value, probability) pairs and sums the probabilities of equal values
+    static DiscreteRandomVariable Merge(std::vector<std::pair<Real, Real>> &batch)
+    {
+        const auto byValue = [](const std::pair<Real, Real> &a, const std::pair<Real, Real> &b)
+        { return a.first < b.first; };
+        if (!std::is_sorted(batch.begin(), batch.end(), byValue))
+        {
+            std::sort(batch.begin(), batch.end(), byValue);
+        }
+
+        DiscreteRandomVariable result;
+        result.values.reserve(batch.size());
+        result.probabilities.reserve(batch.size());
+        for (const auto &[value, probability] : batch)
+        {
+            if (!result.values.empty() && result.values.back() == value)
+            {
+                result.probabilities.back() += probability;
+            }
+            else
+            {
+                result.values.push_back(value);
+                result.probabilities.push_back(probability);
+            }
+        }
+        return result;
+    }
+
+    // Distribution of op(X) for a function of one value
+    template <typename Operation>
+    DiscreteRandomVariable Apply(const Operation &op) const
+    {
+        std::vector<std::pair<Real, Real>> batch(values.size());
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            batch[i] = {op(values[i]), probabilities[i]};
+        }
+        return Merge(batch).Bounded(compaction);
+    }
+
+    // Distribution of op(X, Y) for independent X and Y
+    template <typename Operation>
+    DiscreteRandomVariable Combine(const DiscreteRandomVariable &other, const Operation &op) const
+    {
+        std::vector<std::pair<Real, Real>> batch(values.size() * other.values.size());
+        auto target = batch.begin();
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            for (size_t j = 0; j < other.values.size(); ++j)
+            {
+                *target++ = {op(values[i], other.values[j]), probabilities[i] * other.probabilities[j]};
+            }
+        }
+        return Merge(batch).Bounded(Joined(other));
+    }
+
+    // Compaction of a result of both variables: the tighter budget, the looser tolerance
+    CompactionOptions Joined(const DiscreteRandomVariable &other) const
+    {
+        CompactionOptions joined;
+        joined.budget = compaction.budget == 0 || other.compaction.budget == 0
+                            ? std::max(compaction.budget, other.compaction.budget)
+                            : std::min(compaction.budget, other.compaction.budget);
+        joined.tolerance = std::max(compaction.tolerance, other.compaction.tolerance);
+        return joined;
+    }
+
+    // Replaces the values [first, last) by one value at their mean
+    void MergeRun(const size_t &first, const size_t &last, size_t &kept)
+    {
+        double mass = 0, moment = 0;
+        for (size_t i = first; i < last; ++i)
+        {
+            mass += probabilities[i];
+            moment += double(values[i]) * probabilities[i];
+        }
+        values[kept] = mass > 0 ? Real(moment / mass) : values[first];
+        probabilities[kept] = Real(mass);
+        kept++;
+    }
+
+    // Result with the given compaction, compacted in place
+    DiscreteRandomVariable Bounded(const CompactionOptions &options) &&
+    {
+        compaction = options;
+        if (compaction.tolerance > 0 && values.size() > 1)
+        {
+            size_t kept = 0, first = 0;
+            for (size_t i = 1; i <= values.size(); ++i)
+            {
+                if (i == values.size() ||
+                    values[i] - values[first] > compaction.tolerance * std::max(std::abs(values[i]), std::abs(values[first])))
+                {
+                    MergeRun(first, i, kept);
+                    first = i;
+                }
+            }
+            values.resize(kept);
+            probabilities.resize(kept);
+        }
+
+        if (compaction.budget > 0 && values.size() > compaction.budget)
+        {
+            // k(q) rises fastest near q = 0 and q = 1 and runs from 0 to budget. Every
+            // value goes to the unit interval of k around the middle of its probability,
+            // which leaves at most budget bins, and close to budget once bins hold
+            // several values each.
+            const size_t budget = compaction.budget;
+            const double pi = std::acos(-1.0);
+            const auto bin = [&](const double &q)
+            {
+                const double k = double(budget) * (std::asin(std::clamp(2 * q - 1, -1.0, 1.0)) / pi + 0.5);
+                return std::min(static_cast<size_t>(k), budget - 1);
+            };
+
+            const double total = std::accumulate(probabilities.begin(), probabilities.end(), 0.0);
+            size_t kept = 0, first = 0, current = 0;
+            double below = 0;
+            for (size_t i = 0; i < values.size(); ++i)
+            {
+                const size_t index = bin((below + probabilities[i] / 2) / total);
+                if (i > first && index != current)
+                {
+                    MergeRun(first, i, kept);
+                    first = i;
+                }
+                current = index;
+                below += probabilities[i];
+            }
+            MergeRun(first, values.size(), kept);
+            values.resize(kept);
+            probabilities.resize(kept);
+        }
+        return std::move(*this);
+    }
+
+    void NormalizeProbabilities()
+    {
+        const Real total_probability = std::accumulate(probabilities.begin(), probabilities.end(), Real(0));
+        for (Real &probability : probabilities)
+        {
+            probability /= total_probability;
+        }
+    }
 
 public:
+    // Copy of the distribution as a map; Values() and Probabilities() avoid it
     std::map<Real, Real> Distribution() const
     {
-        return probability_distribution;
+        std::map<Real, Real> distribution;
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            distribution.emplace_hint(distribution.end(), values[i], probabilities[i]);
+        }
+        return distribution;
+    }
+
+    // Support in increasing order
+    const std::vector<Real> &Values() const noexcept
+    {
+        return values;
+    }
+
+    // Probability of every value of Values()
+    const std::vector<Real> &Probabilities() const noexcept
+    {
+        return probabilities;
+    }
+
+    size_t Size() const noexcept
+    {
+        return values.size();
+    }
+
+    const CompactionOptions &Compaction() const noexcept
+    {
+        return compaction;
+    }
+
+    // Bounded-size mode: this variable and every result computed from it are
+    // compacted with options, see CompactionOptions
+    void SetCompaction(const CompactionOptions &options)
+    {
+        *this = DiscreteRandomVariable(*this).Bounded(options);
+    }
+
+    // Copy compacted once with options, leaving this unchanged
+    DiscreteRandomVariable Compact(const CompactionOptions &options) const
+    {
+        DiscreteRandomVariable compacted = DiscreteRandomVariable(*this).Bounded(options);
+        compacted.compaction = compaction;
+        return compacted;
     }
 
     DiscreteRandomVariable() = default;
 
     DiscreteRandomVariable(const std::initializer_list<Real> &values)
     {
-        unsigned int size = values.size();
+        std::vector<std::pair<Real, Real>> batch;
+        batch.reserve(values.size());
         for (const Real &value : values)
         {
-            probability_distribution[value] = 1.0 / size;
+            batch.emplace_back(value, Real(1));
         }
+        // Every distinct value is equally likely
+        *this = Merge(batch);
+        std::fill(probabilities.begin(), probabilities.end(), Real(1));
+        NormalizeProbabilities();
     }
 
     std::map<Real, Real> Normalize(const std::map<Real, Real> &distribution)
@@ -58,15 +390,35 @@ public:
 
     DiscreteRandomVariable(const std::map<Real, Real> &distribution)
     {
-        probability_distribution = Normalize(distribution);
+        values.reserve(distribution.size());
+        probabilities.reserve(distribution.size());
+        for (const auto &[value, probability] : distribution)
+        {
+            values.push_back(value);
+            probabilities.push_back(probability);
+        }
+        NormalizeProbabilities();
+    }
+
+    // Values with their weights in any order; equal values are merged and the
+    // weights normalized
+    DiscreteRandomVariable(const std::vector<Real> &values, const std::vector<Real> &weights)
+    {
+        std::vector<std::pair<Real, Real>> batch(std::min(values.size(), weights.size()));
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            batch[i] = {values[i], weights[i]};
+        }
+        *this = Merge(batch);
+        NormalizeProbabilities();
     }
 
     Real ExpectedValue() const
     {
         Real expected_value = 0;
-        for (const auto &[value, probability] : probability_distribution)
+        for (size_t i = 0; i < values.size(); ++i)
         {
-            expected_value += value * probability;
+            expected_value += values[i] * probabilities[i];
         }
         return expected_value;
     }
@@ -75,9 +427,9 @@ public:
     {
         Real expetedValue = ExpectedValue();
         Real variance = 0;
-        for (const auto &[value, probability] : probability_distribution)
+        for (size_t i = 0; i < values.size(); ++i)
         {
-            variance += (value * value) * probability;
+            variance += (values[i] * values[i]) * probabilities[i];
         }
         return variance - expetedValue * expetedValue;
     }
@@ -85,121 +437,1124 @@ public:
     DiscreteRandomVariable operator+(const DiscreteRandomVariable &other) const
     {
         DiscreteRandomVariable result;
-        for (const auto &[x_value, x_probability] : probability_distribution)
+        if (ConvolveOnLattice(other, result))
         {
-            for (const auto &[y_value, y_probability] : other.probability_distribution)
-            {
-                result.probability_distribution[x_value + y_value] += x_probability * y_probability;
-            }
+            return result;
         }
-        return result;
+        return Combine(other, [](const Real &x, const Real &y)
+                       { return x + y; });
     }
 
     DiscreteRandomVariable operator+(const Real &other) const
+    {
+        return Apply([&](const Real &x)
+                     { return x + other; });
+    }
+
+    DiscreteRandomVariable operator*(const DiscreteRandomVariable &other) const
+    {
+        return Combine(other, [](const Real &x, const Real &y)
+                       { return x * y; });
+    }
+
+    DiscreteRandomVariable operator*(const Real &other) const
+    {
+        return Apply([&](const Real &x)
+                     { return x * other; });
+    }
+
+    DiscreteRandomVariable operator-(const Real &other) const
+    {
+        return Apply([&](const Real &x)
+                     { return x - other; });
+    }
+
+    DiscreteRandomVariable operator-(const DiscreteRandomVariable &other) const
     {
         DiscreteRandomVariable result;
-        for (const auto &[value, probability] : probability_distribution)
+        if (ConvolveOnLattice(other * Real(-1), result))
         {
-            result.probability_distribution[value + other] += probability;
+            return result;
         }
-        return result;
+        return Combine(other, [](const Real &x, const Real &y)
+                       { return x - y; });
     }
 
-    DiscreteRandomVariable operator*(const DiscreteRandomVariable &other) const
+    DiscreteRandomVariable operator/(const Real &other) const
     {
-        DiscreteRandomVariable result;
-        for (const auto &[x_value, x_probability] : probability_distribution)
+        return Apply([&](const Real &x)
+                     { return x / other; });
+    }
+
+    DiscreteRandomVariable operator/(const DiscreteRandomVariable &other) const
+    {
+        return Combine(other, [](const Real &x, const Real &y)
+                       { return x / y; });
+    }
+
+    friend std::ostream &operator<<(std::ostream &os, const DiscreteRandomVariable &X)
+    {
+        for (size_t i = 0; i < X.values.size(); ++i)
+        {
+            os << "P(X = " << X.values[i] << ") = " << X.probabilities[i] << "\n";
+        }
+        return os;
+    }
+
+    friend DiscreteRandomVariable Sum(const DiscreteRandomVariable &X, const size_t &n);
+};
+
+// Distribution of X_1 + ... + X_n for n independent copies of X. On a lattice the
+// transform of X is raised to the n-th power by repeated squaring of every
+// frequency, one forward and one inverse FFT in total; otherwise the sum is built
+// by doubling, O(log n) additions.
+inline DiscreteRandomVariable Sum(const DiscreteRandomVariable &X, const size_t &n)
+{
+    if (n == 0 || X.Size() == 0)
+    {
+        return DiscreteRandomVariable{0};
+    }
+    if (X.Size() == 1)
+    {
+        return DiscreteRandomVariable{Real(double(X.values.front()) * double(n))};
+    }
+
+    const double step = DiscreteRandomVariable::LatticeStep(X.values);
+    const std::vector<size_t> indices = X.LatticeIndices(step);
+    const size_t length = FFTLength(n * (indices.empty() ? 0 : indices.back()) + 1);
+    if (!indices.empty() && length <= DiscreteRandomVariable::MAX_FFT_LENGTH)
+    {
+        const std::vector<double> lattice = X.LatticeProbabilities(indices);
+        std::vector<Complex<double>> spectrum(length);
+        for (size_t k = 0; k < lattice.size(); ++k)
+        {
+            spectrum[k] = Complex<double>(lattice[k]);
+        }
+        FFT(spectrum);
+        for (Complex<double> &frequency : spectrum)
         {
-            for (const auto &[y_value, y_probability] : other.probability_distribution)
+            Complex<double> power(1.0), base = frequency;
+            for (size_t exponent = n; exponent > 0; exponent >>= 1)
             {
-                result.probability_distribution[x_value * y_value] += x_probability * y_probability;
+                if (exponent & 1)
+                {
+                    power *= base;
+                }
+                base *= base;
             }
+            frequency = power;
         }
-        return result;
+        FFT(spectrum, true);
+
+        std::vector<double> sum(n * indices.back() + 1);
+        for (size_t k = 0; k < sum.size(); ++k)
+        {
+            sum[k] = spectrum[k].Real();
+        }
+        return DiscreteRandomVariable::FromLattice(double(X.values.front()) * double(n), step, sum).Bounded(X.compaction);
     }
 
-    DiscreteRandomVariable operator*(const Real &other) const
+    DiscreteRandomVariable result{0}, power = X;
+    for (size_t exponent = n; exponent > 0; exponent >>= 1)
     {
-        DiscreteRandomVariable result;
-        for (const auto &[value, probability] : probability_distribution)
+        if (exponent & 1)
         {
-            result.probability_distribution[value * other] += probability;
+            result = result + power;
+        }
+        if (exponent > 1)
+        {
+            power = power + power;
         }
-        return result;
     }
+    return result;
+}
 
-    DiscreteRandomVariable operator-(const Real &other) const
+inline Real E(const DiscreteRandomVariable &X)
+{
+    return X.ExpectedValue();
+}
+
+inline Real D(const DiscreteRandomVariable &X)
+{
+    return X.Variance();
+}
+
+namespace detail
+{
+    // Branch-free float approximations: range reduction with integer bit operations,
+    // a short polynomial, and selects instead of branches for the special cases. The
+    // polynomials are the single precision ones of Cephes, relative error about 1e-7.
+    // Arrays go through the AVX2 and AVX-512 versions further down.
+
+    inline float Exp(const float input)
     {
-        DiscreteRandomVariable result;
-        for (const auto &[value, probability] : probability_distribution)
+        // NaN goes through the polynomial as 0 and is put back at the end, its
+        // conversion to int would be undefined
+        const float x = input != input ? 0.0f : std::min(std::max(input, -200.0f), 200.0f);
+        // Rounded to the nearest integer with int conversions; std::floor does not vectorize
+        const float rounded = x * 1.44269504f + 0.5f;
+        std::int32_t k = static_cast<std::int32_t>(rounded);
+        k -= static_cast<float>(k) > rounded ? 1 : 0;
+        // Exponents out of range turn 2^k into zero or infinity below; y can be
+        // negative that far out, so zero is selected, not multiplied, to keep it +0
+        k = std::min(std::max(k, -127), 128);
+        const float n = static_cast<float>(k);
+        const float r = x - n * 0.693359375f + n * 2.12194440e-4f;
+        float p = 1.9875691500e-4f;
+        p = p * r + 1.3981999507e-3f;
+        p = p * r + 8.3334519073e-3f;
+        p = p * r + 4.1665795894e-2f;
+        p = p * r + 1.6666665459e-1f;
+        p = p * r + 5.0000001201e-1f;
+        const float y = p * r * r + r + 1.0f;
+        const std::int32_t bits = (k + 127) << 23;
+        float scale;
+        std::memcpy(&scale, &bits, sizeof(scale));
+        const float result = k > -127 ? y * scale : 0.0f;
+        return input != input ? input : result;
+    }
+
+    inline float Log(float x)
+    {
+        const float input = x;
+        x = std::max(x, std::numeric_limits<float>::min());
+        std::int32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        float e = static_cast<float>((bits >> 23) - 126);
+        bits = (bits & 0x807FFFFF) | 0x3F000000;
+        float m;
+        std::memcpy(&m, &bits, sizeof(m));
+        // Mantissa in [sqrt(1/2), sqrt(2)) around 1
+        const bool low = m < 0.707106781f;
+        e = low ? e - 1.0f : e;
+        m = low ? m + m - 1.0f : m - 1.0f;
+
+        const float z = m * m;
+        float y = 7.0376836292e-2f;
+        y = y * m - 1.1514610310e-1f;
+        y = y * m + 1.1676998740e-1f;
+        y = y * m - 1.2420140846e-1f;
+        y = y * m + 1.4249322787e-1f;
+        y = y * m - 1.6668057665e-1f;
+        y = y * m + 2.0000714765e-1f;
+        y = y * m - 2.4999993993e-1f;
+        y = y * m + 3.3333331174e-1f;
+        y = y * m * z;
+        y += e * -2.12194440e-4f;
+        y += -0.5f * z;
+        const float result = m + y + e * 0.693359375f;
+        return input > 0 ? (input == std::numeric_limits<float>::infinity() ? input : result)
+                         : (input == 0 ? -std::numeric_limits<float>::infinity() : std::numeric_limits<float>::quiet_NaN());
+    }
+
+    // log(1 + x) for small x too: 1 + x drops most digits of a small x, and scaling
+    // log(1 + x) by x / ((1 + x) - 1) cancels exactly that rounding (Goldberg)
+    inline float Log1p(const float x)
+    {
+        const float u = 1.0f + x;
+        const float result = Log(u) * x / (u - 1.0f);
+        return u == 1.0f ? x : (u == std::numeric_limits<float>::infinity() ? u : result);
+    }
+
+    // P(Z <= z) for a standard normal Z, from erfc of Numerical Recipes (relative
+    // error below 1.2e-7 everywhere, also deep in the tails)
+    inline float NormalCdf(float z)
+    {
+        const float a = std::abs(z) * 0.707106781f;
+        const float t = 1.0f / (1.0f + 0.5f * a);
+        float p = 0.17087277f;
+        p = p * t - 0.82215223f;
+        p = p * t + 1.48851587f;
+        p = p * t - 1.13520398f;
+        p = p * t + 0.27886807f;
+        p = p * t - 0.18628806f;
+        p = p * t + 0.09678418f;
+        p = p * t + 0.37409196f;
+        p = p * t + 1.00002368f;
+        const float erfc = t * Exp(-a * a - 1.26551223f + t * p);
+        return z < 0 ? 0.5f * erfc : 1.0f - 0.5f * erfc;
+    }
+
+    // z with P(Z <= z) = p, from Acklam's rational approximations for the lower
+    // half t = min(p, 1 - p): one for the center and one in sqrt(-2 log t) for the
+    // tail, both evaluated and one selected. In float the central one loses about
+    // 1e-4 to cancellation, so it gets one Halley step on NormalCdf; in the tail
+    // exp(z^2 / 2) would amplify the rounding of the CDF instead.
+    inline float NormalQuantile(float p)
+    {
+        const float t = std::min(p, 1.0f - p);
+        const float q = t - 0.5f, r = q * q;
+        float central = (((((-3.969683028665376e+01f * r + 2.209460984245205e+02f) * r - 2.759285104469687e+02f) * r +
+                           1.383577518672690e+02f) * r - 3.066479806614716e+01f) * r + 2.506628277459239e+00f) * q /
+                        (((((-5.447609879822406e+01f * r + 1.615858368580409e+02f) * r - 1.556989798598866e+02f) * r +
+                           6.680131188771972e+01f) * r - 1.328068155288572e+01f) * r + 1.0f);
+        const float u = (NormalCdf(central) - t) * 2.50662827f * Exp(0.5f * central * central);
+        central -= u / (1.0f + 0.5f * central * u);
+
+        const float s = std::sqrt(-2.0f * Log(std::max(t, std::numeric_limits<float>::min())));
+        const float lower = (((((-7.784894002430293e-03f * s - 3.223964580411365e-01f) * s - 2.400758277161838e+00f) * s -
+                               2.549732539343734e+00f) * s + 4.374664141464968e+00f) * s + 2.938163982698783e+00f) /
+                            ((((7.784695709041462e-03f * s + 3.224671290700398e-01f) * s + 2.445134137142996e+00f) * s +
+                              3.754408661907416e+00f) * s + 1.0f);
+
+        const float infinity = std::numeric_limits<float>::infinity();
+        const float half = t < 0.02425f ? lower : central;
+        // 0 - half, not -half, so that the median comes out +0 as in the vector versions
+        const float value = p < 0.5f ? half : 0.0f - half;
+        return p > 0 && p < 1 ? value
+                              : (p == 0 ? -infinity : (p == 1 ? infinity : std::numeric_limits<float>::quiet_NaN()));
+    }
+
+    // Regularized lower incomplete gamma function P(a, x): the series below a + 1,
+    // the continued fraction (modified Lentz) above
+    inline double RegularizedGammaP(const double &a, const double &x, const double &logGammaA)
+    {
+        if (x <= 0)
         {
-            result.probability_distribution[value - other] += probability;
+            return 0;
         }
-        return result;
+        const double prefix = std::exp(a * std::log(x) - x - logGammaA);
+        if (x < a + 1)
+        {
+            double term = 1 / a, sum = term;
+            for (int n = 1; n < 500 && std::abs(term) > std::abs(sum) * 1e-12; ++n)
+            {
+                term *= x / (a + n);
+                sum += term;
+            }
+            return std::min(1.0, sum * prefix);
+        }
+        const double tiny = 1e-300;
+        double b = x + 1 - a, c = 1 / tiny, d = 1 / b, h = d;
+        for (int n = 1; n < 500; ++n)
+        {
+            const double an = -n * (n - a);
+            b += 2;
+            d = an * d + b;
+            d = std::abs(d) < tiny ? tiny : d;
+            c = b + an / c;
+            c = std::abs(c) < tiny ? tiny : c;
+            d = 1 / d;
+            const double delta = d * c;
+            h *= delta;
+            if (std::abs(delta - 1) < 1e-12)
+            {
+                break;
+            }
+        }
+        return std::max(0.0, 1 - prefix * h);
     }
 
-    DiscreteRandomVariable operator-(const DiscreteRandomVariable &other) const
+#ifdef MATHEMANIA_X86_DISPATCH
+    // The approximations above, 8 lanes at a time. Operation by operation the same
+    // as the scalar versions, with fused multiply-adds.
+    namespace avx2
     {
-        DiscreteRandomVariable result;
-        for (const auto &[x_value, x_probability] : probability_distribution)
+        __attribute__((target("avx2,fma"))) inline __m256 Polynomial(const __m256 &x, const __m256 &value,
+                                                                      const float &coefficient)
+        {
+            return _mm256_fmadd_ps(value, x, _mm256_set1_ps(coefficient));
+        }
+
+        __attribute__((target("avx2,fma"))) inline __m256 Exp(const __m256 &input)
+        {
+            const __m256 x = _mm256_min_ps(_mm256_set1_ps(200.0f), _mm256_max_ps(_mm256_set1_ps(-200.0f), input));
+            __m256 n = _mm256_floor_ps(_mm256_fmadd_ps(x, _mm256_set1_ps(1.44269504f), _mm256_set1_ps(0.5f)));
+            n = _mm256_min_ps(_mm256_max_ps(n, _mm256_set1_ps(-127.0f)), _mm256_set1_ps(128.0f));
+            const __m256 r = _mm256_fmadd_ps(n, _mm256_set1_ps(2.12194440e-4f),
+                                             _mm256_fnmadd_ps(n, _mm256_set1_ps(0.693359375f), x));
+            __m256 p = _mm256_set1_ps(1.9875691500e-4f);
+            p = Polynomial(r, p, 1.3981999507e-3f);
+            p = Polynomial(r, p, 8.3334519073e-3f);
+            p = Polynomial(r, p, 4.1665795894e-2f);
+            p = Polynomial(r, p, 1.6666665459e-1f);
+            p = Polynomial(r, p, 5.0000001201e-1f);
+            const __m256 y = _mm256_add_ps(_mm256_fmadd_ps(_mm256_mul_ps(p, r), r, r), _mm256_set1_ps(1.0f));
+            const __m256i bits = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+            // Exactly as the scalar version: +0 below the range, NaN put back
+            const __m256 inRange = _mm256_cmp_ps(n, _mm256_set1_ps(-127.0f), _CMP_GT_OQ);
+            const __m256 result = _mm256_and_ps(inRange, _mm256_mul_ps(y, _mm256_castsi256_ps(bits)));
+            return _mm256_blendv_ps(result, input, _mm256_cmp_ps(input, input, _CMP_UNORD_Q));
+        }
+
+        __attribute__((target("avx2,fma"))) inline __m256 Log(const __m256 &input)
+        {
+            const __m256 one = _mm256_set1_ps(1.0f);
+            const __m256i bits = _mm256_castps_si256(_mm256_max_ps(input, _mm256_set1_ps(std::numeric_limits<float>::min())));
+            __m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126)));
+            __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x807FFFFF)),
+                                                           _mm256_set1_epi32(0x3F000000)));
+            const __m256 low = _mm256_cmp_ps(m, _mm256_set1_ps(0.707106781f), _CMP_LT_OQ);
+            e = _mm256_sub_ps(e, _mm256_and_ps(low, one));
+            m = _mm256_sub_ps(_mm256_add_ps(m, _mm256_and_ps(low, m)), one);
+
+            const __m256 z = _mm256_mul_ps(m, m);
+            __m256 y = _mm256_set1_ps(7.0376836292e-2f);
+            y = Polynomial(m, y, -1.1514610310e-1f);
+            y = Polynomial(m, y, 1.1676998740e-1f);
+            y = Polynomial(m, y, -1.2420140846e-1f);
+            y = Polynomial(m, y, 1.4249322787e-1f);
+            y = Polynomial(m, y, -1.6668057665e-1f);
+            y = Polynomial(m, y, 2.0000714765e-1f);
+            y = Polynomial(m, y, -2.4999993993e-1f);
+            y = Polynomial(m, y, 3.3333331174e-1f);
+            y = _mm256_mul_ps(_mm256_mul_ps(y, m), z);
+            y = _mm256_fmadd_ps(e, _mm256_set1_ps(-2.12194440e-4f), y);
+            y = _mm256_fmadd_ps(z, _mm256_set1_ps(-0.5f), y);
+            __m256 result = _mm256_fmadd_ps(e, _mm256_set1_ps(0.693359375f), _mm256_add_ps(m, y));
+
+            const __m256 zero = _mm256_setzero_ps(), infinity = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+            result = _mm256_blendv_ps(result, _mm256_set1_ps(std::numeric_limits<float>::quiet_NaN()),
+                                      _mm256_cmp_ps(input, zero, _CMP_NGE_UQ));
+            result = _mm256_blendv_ps(result, _mm256_sub_ps(zero, infinity), _mm256_cmp_ps(input, zero, _CMP_EQ_OQ));
+            return _mm256_blendv_ps(result, infinity, _mm256_cmp_ps(input, infinity, _CMP_EQ_OQ));
+        }
+
+        __attribute__((target("avx2,fma"))) inline __m256 Log1p(const __m256 &x)
+        {
+            const __m256 one = _mm256_set1_ps(1.0f);
+            const __m256 u = _mm256_add_ps(one, x);
+            __m256 result = _mm256_div_ps(_mm256_mul_ps(Log(u), x), _mm256_sub_ps(u, one));
+            result = _mm256_blendv_ps(result, x, _mm256_cmp_ps(u, one, _CMP_EQ_OQ));
+            const __m256 infinity = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+            return _mm256_blendv_ps(result, u, _mm256_cmp_ps(u, infinity, _CMP_EQ_OQ));
+        }
+
+        __attribute__((target("avx2,fma"))) inline __m256 NormalCdf(const __m256 &z)
         {
-            for (const auto &[y_value, y_probability] : other.probability_distribution)
+            const __m256 one = _mm256_set1_ps(1.0f);
+            const __m256 a = _mm256_mul_ps(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), z), _mm256_set1_ps(0.707106781f));
+            const __m256 t = _mm256_div_ps(one, _mm256_fmadd_ps(_mm256_set1_ps(0.5f), a, one));
+            __m256 p = _mm256_set1_ps(0.17087277f);
+            p = Polynomial(t, p, -0.82215223f);
+            p = Polynomial(t, p, 1.48851587f);
+            p = Polynomial(t, p, -1.13520398f);
+            p = Polynomial(t, p, 0.27886807f);
+            p = Polynomial(t, p, -0.18628806f);
+            p = Polynomial(t, p, 0.09678418f);
+            p = Polynomial(t, p, 0.37409196f);
+            p = Polynomial(t, p, 1.00002368f);
+            const __m256 exponent = _mm256_fmadd_ps(t, p, _mm256_fnmadd_ps(a, a, _mm256_set1_ps(-1.26551223f)));
+            const __m256 half = _mm256_mul_ps(_mm256_set1_ps(0.5f), _mm256_mul_ps(t, Exp(exponent)));
+            return _mm256_blendv_ps(_mm256_sub_ps(one, half), half, _mm256_cmp_ps(z, _mm256_setzero_ps(), _CMP_LT_OQ));
+        }
+
+        __attribute__((target("avx2,fma"))) inline __m256 NormalQuantile(const __m256 &p)
+        {
+            const __m256 one = _mm256_set1_ps(1.0f), half = _mm256_set1_ps(0.5f);
+            const __m256 t = _mm256_min_ps(p, _mm256_sub_ps(one, p));
+            const __m256 q = _mm256_sub_ps(t, half), r = _mm256_mul_ps(q, q);
+            __m256 numerator = _mm256_set1_ps(-3.969683028665376e+01f);
+            numerator = Polynomial(r, numerator, 2.209460984245205e+02f);
+            numerator = Polynomial(r, numerator, -2.759285104469687e+02f);
+            numerator = Polynomial(r, numerator, 1.383577518672690e+02f);
+            numerator = Polynomial(r, numerator, -3.066479806614716e+01f);
+            numerator = Polynomial(r, numerator, 2.506628277459239e+00f);
+            __m256 denominator = _mm256_set1_ps(-5.447609879822406e+01f);
+            denominator = Polynomial(r, denominator, 1.615858368580409e+02f);
+            denominator = Polynomial(r, denominator, -1.556989798598866e+02f);
+            denominator = Polynomial(r, denominator, 6.680131188771972e+01f);
+            denominator = Polynomial(r, denominator, -1.328068155288572e+01f);
+            denominator = Polynomial(r, denominator, 1.0f);
+            __m256 central = _mm256_div_ps(_mm256_mul_ps(numerator, q), denominator);
+            const __m256 u = _mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(NormalCdf(central), t), _mm256_set1_ps(2.50662827f)),
+                                           Exp(_mm256_mul_ps(_mm256_mul_ps(half, central), central)));
+            central = _mm256_sub_ps(central, _mm256_div_ps(u, _mm256_fmadd_ps(_mm256_mul_ps(half, central), u, one)));
+
+            const __m256 logarithm = Log(_mm256_max_ps(t, _mm256_set1_ps(std::numeric_limits<float>::min())));
+            const __m256 s = _mm256_sqrt_ps(_mm256_mul_ps(_mm256_set1_ps(-2.0f), logarithm));
+            numerator = _mm256_set1_ps(-7.784894002430293e-03f);
+            numerator = Polynomial(s, numerator, -3.223964580411365e-01f);
+            numerator = Polynomial(s, numerator, -2.400758277161838e+00f);
+            numerator = Polynomial(s, numerator, -2.549732539343734e+00f);
+            numerator = Polynomial(s, numerator, 4.374664141464968e+00f);
+            numerator = Polynomial(s, numerator, 2.938163982698783e+00f);
+            denominator = _mm256_set1_ps(7.784695709041462e-03f);
+            denominator = Polynomial(s, denominator, 3.224671290700398e-01f);
+            denominator = Polynomial(s, denominator, 2.445134137142996e+00f);
+            denominator = Polynomial(s, denominator, 3.754408661907416e+00f);
+            denominator = Polynomial(s, denominator, 1.0f);
+            const __m256 lower = _mm256_div_ps(numerator, denominator);
+
+            const __m256 zero = _mm256_setzero_ps(), infinity = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+            __m256 value = _mm256_blendv_ps(central, lower, _mm256_cmp_ps(t, _mm256_set1_ps(0.02425f), _CMP_LT_OQ));
+            value = _mm256_blendv_ps(_mm256_sub_ps(zero, value), value, _mm256_cmp_ps(p, half, _CMP_LT_OQ));
+            const __m256 inside = _mm256_and_ps(_mm256_cmp_ps(p, zero, _CMP_GT_OQ), _mm256_cmp_ps(p, one, _CMP_LT_OQ));
+            __m256 result = _mm256_blendv_ps(_mm256_set1_ps(std::numeric_limits<float>::quiet_NaN()), value, inside);
+            result = _mm256_blendv_ps(result, _mm256_sub_ps(zero, infinity), _mm256_cmp_ps(p, zero, _CMP_EQ_OQ));
+            return _mm256_blendv_ps(result, infinity, _mm256_cmp_ps(p, one, _CMP_EQ_OQ));
+        }
+
+        // out[i] = F(x[i]); the tail goes through a padded vector, so that every
+        // element gets the same result wherever it sits in the array
+        template <__m256 (*F)(const __m256 &)>
+        __attribute__((target("avx2,fma"))) void Map(size_t n, const float *x, float *out)
+        {
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
             {
-                result.probability_distribution[x_value - y_value] += x_probability * y_probability;
+                _mm256_storeu_ps(out + i, F(_mm256_loadu_ps(x + i)));
+            }
+            if (i < n)
+            {
+                alignas(32) float lanes[8] = {};
+                std::copy(x + i, x + n, lanes);
+                _mm256_store_ps(lanes, F(_mm256_load_ps(lanes)));
+                std::copy(lanes, lanes + (n - i), out + i);
             }
         }
-        return result;
     }
 
-    DiscreteRandomVariable operator/(const Real &other) const
+    // The same, 16 lanes at a time with masks for selects and the tail. Operations
+    // that GCC builds on an undefined register, and warns about, use the zero-masked
+    // forms with every lane set, as in simd.h.
+    namespace avx512
     {
-        DiscreteRandomVariable result;
-        for (const auto &[value, probability] : probability_distribution)
+        __attribute__((target("avx512f"))) inline __m512 Polynomial(const __m512 &x, const __m512 &value,
+                                                                    const float &coefficient)
         {
-            result.probability_distribution[value / other] += probability;
+            return _mm512_fmadd_ps(value, x, _mm512_set1_ps(coefficient));
+        }
+
+        __attribute__((target("avx512f"))) inline __m512 Exp(const __m512 &input)
+        {
+            const __m512 low = _mm512_maskz_max_ps(0xFFFF, _mm512_set1_ps(-200.0f), input);
+            const __m512 x = _mm512_maskz_min_ps(0xFFFF, _mm512_set1_ps(200.0f), low);
+            __m512 n = _mm512_fmadd_ps(x, _mm512_set1_ps(1.44269504f), _mm512_set1_ps(0.5f));
+            n = _mm512_maskz_roundscale_ps(0xFFFF, n, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+            n = _mm512_maskz_min_ps(0xFFFF, _mm512_maskz_max_ps(0xFFFF, n, _mm512_set1_ps(-127.0f)), _mm512_set1_ps(128.0f));
+            const __m512 r = _mm512_fmadd_ps(n, _mm512_set1_ps(2.12194440e-4f),
+                                             _mm512_fnmadd_ps(n, _mm512_set1_ps(0.693359375f), x));
+            __m512 p = _mm512_set1_ps(1.9875691500e-4f);
+            p = Polynomial(r, p, 1.3981999507e-3f);
+            p = Polynomial(r, p, 8.3334519073e-3f);
+            p = Polynomial(r, p, 4.1665795894e-2f);
+            p = Polynomial(r, p, 1.6666665459e-1f);
+            p = Polynomial(r, p, 5.0000001201e-1f);
+            const __m512 y = _mm512_add_ps(_mm512_fmadd_ps(_mm512_mul_ps(p, r), r, r), _mm512_set1_ps(1.0f));
+            const __m512i k = _mm512_maskz_cvtps_epi32(0xFFFF, n);
+            const __m512i bits = _mm512_maskz_slli_epi32(0xFFFF, _mm512_add_epi32(k, _mm512_set1_epi32(127)), 23);
+            const __mmask16 inRange = _mm512_cmp_ps_mask(n, _mm512_set1_ps(-127.0f), _CMP_GT_OQ);
+            const __m512 result = _mm512_maskz_mov_ps(inRange, _mm512_mul_ps(y, _mm512_castsi512_ps(bits)));
+            return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(input, input, _CMP_UNORD_Q), result, input);
+        }
+
+        __attribute__((target("avx512f"))) inline __m512 Log(const __m512 &input)
+        {
+            const __m512 one = _mm512_set1_ps(1.0f);
+            const __m512 smallest = _mm512_set1_ps(std::numeric_limits<float>::min());
+            const __m512i bits = _mm512_castps_si512(_mm512_maskz_max_ps(0xFFFF, input, smallest));
+            const __m512i exponent = _mm512_sub_epi32(_mm512_maskz_srli_epi32(0xFFFF, bits, 23), _mm512_set1_epi32(126));
+            __m512 e = _mm512_maskz_cvtepi32_ps(0xFFFF, exponent);
+            __m512 m = _mm512_castsi512_ps(_mm512_or_si512(_mm512_and_si512(bits, _mm512_set1_epi32(0x807FFFFF)),
+                                                           _mm512_set1_epi32(0x3F000000)));
+            const __mmask16 low = _mm512_cmp_ps_mask(m, _mm512_set1_ps(0.707106781f), _CMP_LT_OQ);
+            e = _mm512_mask_sub_ps(e, low, e, one);
+            m = _mm512_sub_ps(_mm512_mask_add_ps(m, low, m, m), one);
+
+            const __m512 z = _mm512_mul_ps(m, m);
+            __m512 y = _mm512_set1_ps(7.0376836292e-2f);
+            y = Polynomial(m, y, -1.1514610310e-1f);
+            y = Polynomial(m, y, 1.1676998740e-1f);
+            y = Polynomial(m, y, -1.2420140846e-1f);
+            y = Polynomial(m, y, 1.4249322787e-1f);
+            y = Polynomial(m, y, -1.6668057665e-1f);
+            y = Polynomial(m, y, 2.0000714765e-1f);
+            y = Polynomial(m, y, -2.4999993993e-1f);
+            y = Polynomial(m, y, 3.3333331174e-1f);
+            y = _mm512_mul_ps(_mm512_mul_ps(y, m), z);
+            y = _mm512_fmadd_ps(e, _mm512_set1_ps(-2.12194440e-4f), y);
+            y = _mm512_fmadd_ps(z, _mm512_set1_ps(-0.5f), y);
+            __m512 result = _mm512_fmadd_ps(e, _mm512_set1_ps(0.693359375f), _mm512_add_ps(m, y));
+
+            const __m512 zero = _mm512_setzero_ps(), infinity = _mm512_set1_ps(std::numeric_limits<float>::infinity());
+            result = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(input, zero, _CMP_NGE_UQ), result,
+                                          _mm512_set1_ps(std::numeric_limits<float>::quiet_NaN()));
+            result = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(input, zero, _CMP_EQ_OQ), result, _mm512_sub_ps(zero, infinity));
+            return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(input, infinity, _CMP_EQ_OQ), result, infinity);
+        }
+
+        __attribute__((target("avx512f"))) inline __m512 Log1p(const __m512 &x)
+        {
+            const __m512 one = _mm512_set1_ps(1.0f);
+            const __m512 u = _mm512_add_ps(one, x);
+            __m512 result = _mm512_div_ps(_mm512_mul_ps(Log(u), x), _mm512_sub_ps(u, one));
+            result = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(u, one, _CMP_EQ_OQ), result, x);
+            const __m512 infinity = _mm512_set1_ps(std::numeric_limits<float>::infinity());
+            return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(u, infinity, _CMP_EQ_OQ), result, u);
+        }
+
+        __attribute__((target("avx512f"))) inline __m512 NormalCdf(const __m512 &z)
+        {
+            const __m512 one = _mm512_set1_ps(1.0f);
+            const __m512 a = _mm512_mul_ps(_mm512_abs_ps(z), _mm512_set1_ps(0.707106781f));
+            const __m512 t = _mm512_div_ps(one, _mm512_fmadd_ps(_mm512_set1_ps(0.5f), a, one));
+            __m512 p = _mm512_set1_ps(0.17087277f);
+            p = Polynomial(t, p, -0.82215223f);
+            p = Polynomial(t, p, 1.48851587f);
+            p = Polynomial(t, p, -1.13520398f);
+            p = Polynomial(t, p, 0.27886807f);
+            p = Polynomial(t, p, -0.18628806f);
+            p = Polynomial(t, p, 0.09678418f);
+            p = Polynomial(t, p, 0.37409196f);
+            p = Polynomial(t, p, 1.00002368f);
+            const __m512 exponent = _mm512_fmadd_ps(t, p, _mm512_fnmadd_ps(a, a, _mm512_set1_ps(-1.26551223f)));
+            const __m512 half = _mm512_mul_ps(_mm512_set1_ps(0.5f), _mm512_mul_ps(t, Exp(exponent)));
+            const __mmask16 negative = _mm512_cmp_ps_mask(z, _mm512_setzero_ps(), _CMP_LT_OQ);
+            return _mm512_mask_blend_ps(negative, _mm512_sub_ps(one, half), half);
+        }
+
+        __attribute__((target("avx512f"))) inline __m512 NormalQuantile(const __m512 &p)
+        {
+            const __m512 one = _mm512_set1_ps(1.0f), half = _mm512_set1_ps(0.5f);
+            const __m512 t = _mm512_maskz_min_ps(0xFFFF, p, _mm512_sub_ps(one, p));
+            const __m512 q = _mm512_sub_ps(t, half), r = _mm512_mul_ps(q, q);
+            __m512 numerator = _mm512_set1_ps(-3.969683028665376e+01f);
+            numerator = Polynomial(r, numerator, 2.209460984245205e+02f);
+            numerator = Polynomial(r, numerator, -2.759285104469687e+02f);
+            numerator = Polynomial(r, numerator, 1.383577518672690e+02f);
+            numerator = Polynomial(r, numerator, -3.066479806614716e+01f);
+            numerator = Polynomial(r, numerator, 2.506628277459239e+00f);
+            __m512 denominator = _mm512_set1_ps(-5.447609879822406e+01f);
+            denominator = Polynomial(r, denominator, 1.615858368580409e+02f);
+            denominator = Polynomial(r, denominator, -1.556989798598866e+02f);
+            denominator = Polynomial(r, denominator, 6.680131188771972e+01f);
+            denominator = Polynomial(r, denominator, -1.328068155288572e+01f);
+            denominator = Polynomial(r, denominator, 1.0f);
+            __m512 central = _mm512_div_ps(_mm512_mul_ps(numerator, q), denominator);
+            const __m512 u = _mm512_mul_ps(_mm512_mul_ps(_mm512_sub_ps(NormalCdf(central), t), _mm512_set1_ps(2.50662827f)),
+                                           Exp(_mm512_mul_ps(_mm512_mul_ps(half, central), central)));
+            central = _mm512_sub_ps(central, _mm512_div_ps(u, _mm512_fmadd_ps(_mm512_mul_ps(half, central), u, one)));
+
+            const __m512 logarithm = Log(_mm512_maskz_max_ps(0xFFFF, t, _mm512_set1_ps(std::numeric_limits<float>::min())));
+            const __m512 s = _mm512_maskz_sqrt_ps(0xFFFF, _mm512_mul_ps(_mm512_set1_ps(-2.0f), logarithm));
+            numerator = _mm512_set1_ps(-7.784894002430293e-03f);
+            numerator = Polynomial(s, numerator, -3.223964580411365e-01f);
+            numerator = Polynomial(s, numerator, -2.400758277161838e+00f);
+            numerator = Polynomial(s, numerator, -2.549732539343734e+00f);
+            numerator = Polynomial(s, numerator, 4.374664141464968e+00f);
+            numerator = Polynomial(s, numerator, 2.938163982698783e+00f);
+            denominator = _mm512_set1_ps(7.784695709041462e-03f);
+            denominator = Polynomial(s, denominator, 3.224671290700398e-01f);
+            denominator = Polynomial(s, denominator, 2.445134137142996e+00f);
+            denominator = Polynomial(s, denominator, 3.754408661907416e+00f);
+            denominator = Polynomial(s, denominator, 1.0f);
+            const __m512 lower = _mm512_div_ps(numerator, denominator);
+
+            const __m512 zero = _mm512_setzero_ps(), infinity = _mm512_set1_ps(std::numeric_limits<float>::infinity());
+            __m512 value = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(t, _mm512_set1_ps(0.02425f), _CMP_LT_OQ), central, lower);
+            value = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(p, half, _CMP_LT_OQ), _mm512_sub_ps(zero, value), value);
+            const __mmask16 inside = _mm512_cmp_ps_mask(p, zero, _CMP_GT_OQ) & _mm512_cmp_ps_mask(p, one, _CMP_LT_OQ);
+            __m512 result = _mm512_mask_blend_ps(inside, _mm512_set1_ps(std::numeric_limits<float>::quiet_NaN()), value);
+            result = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(p, zero, _CMP_EQ_OQ), result, _mm512_sub_ps(zero, infinity));
+            return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(p, one, _CMP_EQ_OQ), result, infinity);
+        }
+
+        template <__m512 (*F)(const __m512 &)>
+        __attribute__((target("avx512f"))) void Map(size_t n, const float *x, float *out)
+        {
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                _mm512_storeu_ps(out + i, F(_mm512_loadu_ps(x + i)));
+            }
+            const __mmask16 mask = (__mmask16)((1u << (n - i)) - 1);
+            _mm512_mask_storeu_ps(out + i, mask, F(_mm512_maskz_loadu_ps(mask, x + i)));
         }
-        return result;
     }
+#endif
 
-    DiscreteRandomVariable operator/(const DiscreteRandomVariable &other) const
+    template <float (*F)(float)>
+    void Map(size_t n, const float *x, float *out)
     {
-        DiscreteRandomVariable result;
-        for (const auto &[x_value, x_probability] : probability_distribution)
+        for (size_t i = 0; i < n; ++i)
+        {
+            out[i] = F(x[i]);
+        }
+    }
+
+    // Array versions of the approximations, out may be x. Picked once, on first use,
+    // for the running CPU, like the kernel tables of simd.h.
+    struct DistributionKernels
+    {
+        void (*exp)(size_t, const float *, float *);
+        void (*log)(size_t, const float *, float *);
+        void (*log1p)(size_t, const float *, float *);
+        void (*normalCdf)(size_t, const float *, float *);
+        void (*normalQuantile)(size_t, const float *, float *);
+
+        static const DistributionKernels &Get()
         {
-            for (const auto &[y_value, y_probability] : other.probability_distribution)
+            static const DistributionKernels table = []
             {
-                result.probability_distribution[x_value / y_value] += x_probability * y_probability;
+                DistributionKernels result = {Map<Exp>, Map<Log>, Map<Log1p>, Map<NormalCdf>, Map<NormalQuantile>};
+#ifdef MATHEMANIA_X86_DISPATCH
+                const linal::kernels::CpuFeatures &features = linal::kernels::CpuFeatures::Detect();
+                if (features.avx512)
+                {
+                    result = {avx512::Map<avx512::Exp>, avx512::Map<avx512::Log>, avx512::Map<avx512::Log1p>,
+                              avx512::Map<avx512::NormalCdf>, avx512::Map<avx512::NormalQuantile>};
+                }
+                else if (features.avx2)
+                {
+                    result = {avx2::Map<avx2::Exp>, avx2::Map<avx2::Log>, avx2::Map<avx2::Log1p>,
+                              avx2::Map<avx2::NormalCdf>, avx2::Map<avx2::NormalQuantile>};
+                }
+#endif
+                return result;
+            }();
+            return table;
+        }
+    };
+
+    // Elements handled per pass of the batch evaluations, small enough that the
+    // intermediate buffers stay in L1
+    constexpr size_t DISTRIBUTION_BLOCK = 512;
+}
+
+// Continuous random variable. Every function is evaluated over whole arrays, so
+// that one virtual call covers millions of points and the work inside runs through
+// the vector kernels of detail::DistributionKernels; the scalar and vector
+// overloads are shortcuts to the same code.
+class RandomVariable
+{
+protected:
+    virtual void EvaluatePDF(const Real *x, Real *out, const size_t &count) const = 0;
+    virtual void EvaluateCDF(const Real *x, Real *out, const size_t &count) const = 0;
+    virtual void EvaluateQuantile(const Real *p, Real *out, const size_t &count) const = 0;
+
+public:
+    virtual ~RandomVariable() = default;
+
+    virtual Real ExpectedValue() const = 0;
+    virtual Real Variance() const = 0;
+
+    // Density at every x; out may be x itself
+    void PDF(const Real *x, Real *out, const size_t &count) const
+    {
+        EvaluatePDF(x, out, count);
+    }
+
+    // P(X <= x) for every x
+    void CDF(const Real *x, Real *out, const size_t &count) const
+    {
+        EvaluateCDF(x, out, count);
+    }
+
+    // Inverse CDF: the x with P(X <= x) = p for every p in [0, 1], NaN outside
+    void Quantile(const Real *p, Real *out, const size_t &count) const
+    {
+        EvaluateQuantile(p, out, count);
+    }
+
+    std::vector<Real> PDF(const std::vector<Real> &x) const
+    {
+        std::vector<Real> out(x.size());
+        EvaluatePDF(x.data(), out.data(), x.size());
+        return out;
+    }
+
+    std::vector<Real> CDF(const std::vector<Real> &x) const
+    {
+        std::vector<Real> out(x.size());
+        EvaluateCDF(x.data(), out.data(), x.size());
+        return out;
+    }
+
+    std::vector<Real> Quantile(const std::vector<Real> &p) const
+    {
+        std::vector<Real> out(p.size());
+        EvaluateQuantile(p.data(), out.data(), p.size());
+        return out;
+    }
+
+    Real PDF(const Real &x) const
+    {
+        Real out;
+        EvaluatePDF(&x, &out, 1);
+        return out;
+    }
+
+    Real CDF(const Real &x) const
+    {
+        Real out;
+        EvaluateCDF(&x, &out, 1);
+        return out;
+    }
+
+    Real Quantile(const Real &p) const
+    {
+        Real out;
+        EvaluateQuantile(&p, &out, 1);
+        return out;
+    }
+
+    // Discrete variable on origin + k * step for k < count. Every point takes the
+    // probability of the cell of width step around it, the two end points also
+    // the tails beyond, so that nothing is lost; one batch CDF call in total.
+    DiscreteRandomVariable Discretize(const Real &origin, const Real &step, const size_t &count) const
+    {
+        if (count == 0 || !(step > 0))
+        {
+            throw std::invalid_argument("Discretization needs a positive step and at least one point.");
+        }
+        std::vector<Real> edges(count + 1);
+        for (size_t k = 0; k <= count; ++k)
+        {
+            edges[k] = origin + (Real(k) - Real(0.5)) * step;
+        }
+        const std::vector<Real> cdf = CDF(edges);
+
+        std::vector<Real> values, weights;
+        values.reserve(count);
+        weights.reserve(count);
+        for (size_t k = 0; k < count; ++k)
+        {
+            const Real below = k == 0 ? Real(0) : cdf[k];
+            const Real above = k + 1 == count ? Real(1) : cdf[k + 1];
+            if (above > below)
+            {
+                values.push_back(origin + Real(k) * step);
+                weights.push_back(above - below);
             }
         }
-        return result;
+        return DiscreteRandomVariable(values, weights);
     }
 
-    friend std::ostream &operator<<(std::ostream &os, const DiscreteRandomVariable &X)
+    // count points spread evenly between the tail and 1 - tail quantiles
+    DiscreteRandomVariable Discretize(const size_t &count, const Real &tail = Real(1e-6)) const
+    {
+        const Real low = Quantile(tail), high = Quantile(1 - tail);
+        const Real step = count > 1 ? (high - low) / Real(count - 1) : Real(1);
+        return Discretize(low, step > 0 ? step : Real(1), count);
+    }
+};
+
+class NormalRandomVariable : public RandomVariable
+{
+private:
+    Real mean_, deviation_;
+
+protected:
+    void EvaluatePDF(const Real *x, Real *out, const size_t &count) const override
     {
-        for (const auto &[value, probability] : X.Distribution())
+        // Parameters in locals, out could alias the members as far as the compiler knows
+        const Real mean = mean_, scale = Real(0.398942280) / deviation_, inverse = 1 / deviation_;
+        const detail::DistributionKernels &kernels = detail::DistributionKernels::Get();
+        Real buffer[detail::DISTRIBUTION_BLOCK];
+        for (size_t start = 0; start < count; start += detail::DISTRIBUTION_BLOCK)
         {
-            os << "P(X = " << value << ") = " << probability << "\n";
+            const size_t n = std::min(count - start, detail::DISTRIBUTION_BLOCK);
+            for (size_t i = 0; i < n; ++i)
+            {
+                const Real z = (x[start + i] - mean) * inverse;
+                buffer[i] = Real(-0.5) * z * z;
+            }
+            kernels.exp(n, buffer, buffer);
+            for (size_t i = 0; i < n; ++i)
+            {
+                out[start + i] = scale * buffer[i];
+            }
+        }
+    }
+
+    void EvaluateCDF(const Real *x, Real *out, const size_t &count) const override
+    {
+        const Real mean = mean_, inverse = 1 / deviation_;
+        const detail::DistributionKernels &kernels = detail::DistributionKernels::Get();
+        Real buffer[detail::DISTRIBUTION_BLOCK];
+        for (size_t start = 0; start < count; start += detail::DISTRIBUTION_BLOCK)
+        {
+            const size_t n = std::min(count - start, detail::DISTRIBUTION_BLOCK);
+            for (size_t i = 0; i < n; ++i)
+            {
+                buffer[i] = (x[start + i] - mean) * inverse;
+            }
+            kernels.normalCdf(n, buffer, out + start);
         }
-        return os;
+    }
+
+    void EvaluateQuantile(const Real *p, Real *out, const size_t &count) const override
+    {
+        const Real mean = mean_, deviation = deviation_;
+        const detail::DistributionKernels &kernels = detail::DistributionKernels::Get();
+        Real buffer[detail::DISTRIBUTION_BLOCK];
+        for (size_t start = 0; start < count; start += detail::DISTRIBUTION_BLOCK)
+        {
+            const size_t n = std::min(count - start, detail::DISTRIBUTION_BLOCK);
+            kernels.normalQuantile(n, p + start, buffer);
+            for (size_t i = 0; i < n; ++i)
+            {
+                out[start + i] = mean + deviation * buffer[i];
+            }
+        }
+    }
+
+public:
+    NormalRandomVariable(const Real &mean = 0, const Real &deviation = 1) : mean_(mean), deviation_(deviation)
+    {
+        if (!(deviation > 0))
+        {
+            throw std::invalid_argument("Standard deviation has to be positive.");
+        }
+    }
+
+    Real ExpectedValue() const override
+    {
+        return mean_;
+    }
+
+    Real Variance() const override
+    {
+        return deviation_ * deviation_;
     }
 };
 
-Real E(const DiscreteRandomVariable &X)
+class ExponentialRandomVariable : public RandomVariable
 {
-    Real expected_value = 0;
-    for (const auto &[value, probability] : X.Distribution())
+private:
+    Real rate_;
+
+protected:
+    void EvaluatePDF(const Real *x, Real *out, const size_t &count) const override
+    {
+        const Real rate = rate_;
+        const detail::DistributionKernels &kernels = detail::DistributionKernels::Get();
+        Real buffer[detail::DISTRIBUTION_BLOCK];
+        for (size_t start = 0; start < count; start += detail::DISTRIBUTION_BLOCK)
+        {
+            const size_t n = std::min(count - start, detail::DISTRIBUTION_BLOCK);
+            for (size_t i = 0; i < n; ++i)
+            {
+                buffer[i] = -rate * x[start + i];
+            }
+            kernels.exp(n, buffer, buffer);
+            for (size_t i = 0; i < n; ++i)
+            {
+                out[start + i] = x[start + i] < 0 ? Real(0) : rate * buffer[i];
+            }
+        }
+    }
+
+    void EvaluateCDF(const Real *x, Real *out, const size_t &count) const override
     {
-        expected_value += value * probability;
+        const Real rate = rate_;
+        const detail::DistributionKernels &kernels = detail::DistributionKernels::Get();
+        Real buffer[detail::DISTRIBUTION_BLOCK];
+        for (size_t start = 0; start < count; start += detail::DISTRIBUTION_BLOCK)
+        {
+            const size_t n = std::min(count - start, detail::DISTRIBUTION_BLOCK);
+            for (size_t i = 0; i < n; ++i)
+            {
+                buffer[i] = -rate * x[start + i];
+            }
+            kernels.exp(n, buffer, buffer);
+            for (size_t i = 0; i < n; ++i)
+            {
+                out[start + i] = x[start + i] < 0 ? Real(0) : 1 - buffer[i];
+            }
+        }
     }
-    return expected_value;
-}
 
-Real D(const DiscreteRandomVariable &X)
+    void EvaluateQuantile(const Real *p, Real *out, const size_t &count) const override
+    {
+        const Real inverse = 1 / rate_;
+        const detail::DistributionKernels &kernels = detail::DistributionKernels::Get();
+        Real buffer[detail::DISTRIBUTION_BLOCK];
+        for (size_t start = 0; start < count; start += detail::DISTRIBUTION_BLOCK)
+        {
+            const size_t n = std::min(count - start, detail::DISTRIBUTION_BLOCK);
+            for (size_t i = 0; i < n; ++i)
+            {
+                buffer[i] = -p[start + i];
+            }
+            // log(1 - p) as log1p(-p), 1 - p in float would lose small p
+            kernels.log1p(n, buffer, buffer);
+            for (size_t i = 0; i < n; ++i)
+            {
+                out[start + i] = p[start + i] >= 0 ? -buffer[i] * inverse : std::numeric_limits<Real>::quiet_NaN();
+            }
+        }
+    }
+
+public:
+    explicit ExponentialRandomVariable(const Real &rate = 1) : rate_(rate)
+    {
+        if (!(rate > 0))
+        {
+            throw std::invalid_argument("Rate has to be positive.");
+        }
+    }
+
+    Real ExpectedValue() const override
+    {
+        return 1 / rate_;
+    }
+
+    Real Variance() const override
+    {
+        return 1 / (rate_ * rate_);
+    }
+};
+
+class UniformRandomVariable : public RandomVariable
+{
+private:
+    Real low_, high_;
+
+protected:
+    void EvaluatePDF(const Real *x, Real *out, const size_t &count) const override
+    {
+        const Real low = low_, high = high_, density = 1 / (high_ - low_);
+        for (size_t i = 0; i < count; ++i)
+        {
+            out[i] = x[i] >= low && x[i] <= high ? density : Real(0);
+        }
+    }
+
+    void EvaluateCDF(const Real *x, Real *out, const size_t &count) const override
+    {
+        const Real low = low_, inverse = 1 / (high_ - low_);
+        for (size_t i = 0; i < count; ++i)
+        {
+            out[i] = std::min(std::max((x[i] - low) * inverse, Real(0)), Real(1));
+        }
+    }
+
+    void EvaluateQuantile(const Real *p, Real *out, const size_t &count) const override
+    {
+        const Real low = low_, width = high_ - low_;
+        for (size_t i = 0; i < count; ++i)
+        {
+            out[i] = p[i] >= 0 && p[i] <= 1 ? low + p[i] * width : std::numeric_limits<Real>::quiet_NaN();
+        }
+    }
+
+public:
+    UniformRandomVariable(const Real &low = 0, const Real &high = 1) : low_(low), high_(high)
+    {
+        if (!(low < high))
+        {
+            throw std::invalid_argument("Uniform bounds have to satisfy low < high.");
+        }
+    }
+
+    Real ExpectedValue() const override
+    {
+        return (low_ + high_) / 2;
+    }
+
+    Real Variance() const override
+    {
+        return (high_ - low_) * (high_ - low_) / 12;
+    }
+};
+
+// Gamma distribution with shape k and scale theta. The density runs through the
+// vector kernels like the others; the CDF needs the incomplete gamma function, a series or continued
+// fraction that converges in a data-dependent number of steps, and the quantile
+// refines a Wilson-Hilferty guess by Newton steps on it.
+class GammaRandomVariable : public RandomVariable
 {
-    Real expected_value = 0;
-    for (const auto &[value, probability] : X.Distribution())
+private:
+    Real shape_, scale_;
+    // log(Gamma(k) theta^k)
+    double logNormalizer_;
+
+protected:
+    void EvaluatePDF(const Real *x, Real *out, const size_t &count) const override
+    {
+        const Real power = shape_ - 1, inverse = 1 / scale_, offset = Real(logNormalizer_);
+        const detail::DistributionKernels &kernels = detail::DistributionKernels::Get();
+        Real buffer[detail::DISTRIBUTION_BLOCK];
+        for (size_t start = 0; start < count; start += detail::DISTRIBUTION_BLOCK)
+        {
+            const size_t n = std::min(count - start, detail::DISTRIBUTION_BLOCK);
+            kernels.log(n, x + start, buffer);
+            for (size_t i = 0; i < n; ++i)
+            {
+                const Real logPower = power == 0 ? Real(0) : power * buffer[i];
+                buffer[i] = logPower - x[start + i] * inverse - offset;
+            }
+            kernels.exp(n, buffer, buffer);
+            for (size_t i = 0; i < n; ++i)
+            {
+                out[start + i] = x[start + i] < 0 ? Real(0) : buffer[i];
+            }
+        }
+    }
+
+    void EvaluateCDF(const Real *x, Real *out, const size_t &count) const override
+    {
+        const double logGamma = std::lgamma(double(shape_));
+        for (size_t i = 0; i < count; ++i)
+        {
+            out[i] = Real(detail::RegularizedGammaP(shape_, double(x[i]) / scale_, logGamma));
+        }
+    }
+
+    void EvaluateQuantile(const Real *p, Real *out, const size_t &count) const override
+    {
+        const double k = shape_, logGamma = std::lgamma(k);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const double target = p[i];
+            if (!(target >= 0 && target <= 1))
+            {
+                out[i] = std::numeric_limits<Real>::quiet_NaN();
+                continue;
+            }
+            if (target == 0 || target == 1)
+            {
+                out[i] = target == 0 ? Real(0) : std::numeric_limits<Real>::infinity();
+                continue;
+            }
+
+            const double z = detail::NormalQuantile(Real(target)), c = 1 / (9 * k);
+            double y = k * std::pow(std::max(1 - c + z * std::sqrt(c), 0.0), 3);
+            if (y <= 0)
+            {
+                // Small quantiles: P(k, y) ~ y^k / Gamma(k + 1)
+                y = std::exp((std::log(target) + std::lgamma(k + 1)) / k);
+            }
+            for (int step = 0; step < 50; ++step)
+            {
+                const double error = detail::RegularizedGammaP(k, y, logGamma) - target;
+                const double density = std::exp((k - 1) * std::log(y) - y - logGamma);
+                if (!(density > 0))
+                {
+                    break;
+                }
+                // Newton step, kept inside (0, inf) by halving towards zero
+                const double next = y - error / density;
+                const double previous = y;
+                y = next > 0 ? next : y / 2;
+                if (std::abs(y - previous) <= 1e-10 * y)
+                {
+                    break;
+                }
+            }
+            out[i] = Real(y * scale_);
+        }
+    }
+
+public:
+    GammaRandomVariable(const Real &shape = 1, const Real &scale = 1)
+        : shape_(shape), scale_(scale), logNormalizer_(std::lgamma(double(shape)) + double(shape) * std::log(double(scale)))
     {
-        expected_value += value * probability;
+        if (!(shape > 0) || !(scale > 0))
+        {
+            throw std::invalid_argument("Gamma shape and scale have to be positive.");
+        }
     }
-    return expected_value;
-}
\ No newline at end of file
+
+    Real ExpectedValue() const override
+    {
+        return shape_ * scale_;
+    }
+
+    Real Variance() const override
+    {
+        return shape_ * scale_ * scale_;
+    }
+};
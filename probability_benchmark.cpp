@@ -0,0 +1,87 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "benchmark.h"
+#include "probability.h"
+
+// Usage: probability_benchmark [support size] [terms] [points]
+// Sums of independent variables: pairwise, on the lattice and compacted, then batch
+// CDF and quantile evaluations of continuous variables.
+int main(int argc, char **argv)
+{
+    const size_t support = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000;
+    const size_t terms = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100;
+    const size_t points = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1 << 22;
+
+    std::vector<Real> values(support), irregular(support), weights(support);
+    for (size_t i = 0; i < support; ++i)
+    {
+        values[i] = Real(i);
+        // Shifted by square roots, so that no lattice fits
+        irregular[i] = Real(i + std::sqrt(double(i)));
+        weights[i] = Real(1 + i % 7);
+    }
+    const DiscreteRandomVariable X(values, weights);
+    const DiscreteRandomVariable Y(irregular, weights);
+
+    // Off the lattice with a bounded support
+    DiscreteRandomVariable bounded = Y;
+    CompactionOptions compaction;
+    compaction.budget = 256;
+    bounded.SetCompaction(compaction);
+
+    DiscreteRandomVariable pairwise, chain, sum, boundedChain;
+    const double pairwiseTime = Time(1, [&]
+                                     { pairwise = Y + Y; });
+    const double chainTime = Time(1, [&]
+                                  {
+                                      chain = X;
+                                      for (size_t term = 1; term < terms; ++term)
+                                      {
+                                          chain = chain + X;
+                                      } });
+    const double boundedTime = Time(1, [&]
+                                    {
+                                        boundedChain = bounded;
+                                        for (size_t term = 1; term < terms; ++term)
+                                        {
+                                            boundedChain = boundedChain + bounded;
+                                        } });
+    const double sumTime = Time(1, [&]
+                                { sum = Sum(X, terms); });
+
+    std::cout << "pairwise sum off the lattice: " << pairwise.Size() << " values in " << pairwiseTime << " ms\n";
+    std::cout << "chain of " << terms << " lattice sums: " << chain.Size() << " values, E = " << E(chain) << " in "
+              << chainTime << " ms\n";
+    std::cout << "chain of " << terms << " sums compacted to " << compaction.budget << " values: " << boundedChain.Size()
+              << " values, E = " << E(boundedChain) << " (exact " << terms * E(Y) << ") in " << boundedTime << " ms\n";
+    std::cout << "Sum(X, " << terms << "): " << sum.Size() << " values, E = " << E(sum) << " in " << sumTime << " ms\n";
+
+    // The compacted chain should use the budget without exceeding it, once Y + Y alone would not fit
+    const bool underused = terms > 1 && pairwise.Size() > compaction.budget && 10 * boundedChain.Size() < 9 * compaction.budget;
+    if (boundedChain.Size() > compaction.budget || underused)
+    {
+        std::cerr << "compaction kept " << boundedChain.Size() << " values for a budget of " << compaction.budget << "\n";
+        return 1;
+    }
+
+    std::vector<Real> x(points), p(points), out(points);
+    for (size_t i = 0; i < points; ++i)
+    {
+        x[i] = Real(-6 + 12 * (i + 0.5) / points);
+        p[i] = Real((i + 0.5) / points);
+    }
+    const NormalRandomVariable normal(0, 1);
+    const GammaRandomVariable gamma(2.5, 1);
+    const double normalCdfTime = Time(5, [&]
+                                      { normal.CDF(x.data(), out.data(), points); });
+    const double normalQuantileTime = Time(5, [&]
+                                           { normal.Quantile(p.data(), out.data(), points); });
+    const double gammaCdfTime = Time(5, [&]
+                                     { gamma.CDF(x.data(), out.data(), points); });
+
+    std::cout << "normal CDF of " << points << " points in " << normalCdfTime << " ms\n";
+    std::cout << "normal quantile of " << points << " points in " << normalQuantileTime << " ms\n";
+    std::cout << "gamma CDF of " << points << " points in " << gammaCdfTime << " ms\n";
+}
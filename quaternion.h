@@ -4,10 +4,12 @@
 #include <cmath>
 #include <iostream>
 
-typedef long double Real;
-
 class Quaternion
 {
+public:
+    // Scoped to the class so that quaternion.h can be included next to matrix.h
+    typedef long double Real;
+
 protected:
     Real a_, b_, c_, d_;
 
@@ -20,6 +22,27 @@ public:
         d_ = d;
     }
 
+    // Components of a + bi + cj + dk
+    Real a() const
+    {
+        return a_;
+    }
+
+    Real b() const
+    {
+        return b_;
+    }
+
+    Real c() const
+    {
+        return c_;
+    }
+
+    Real d() const
+    {
+        return d_;
+    }
+
     Quaternion conj() const
     {
         return Quaternion(a_, -b_, -c_, -d_);
@@ -0,0 +1,258 @@
+#pragma once
+
+#include "probability.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3"):
+// a counter-based generator, the n-th output is a pure function of (key, n).
+// Streams therefore need no state beyond a position, any range of a stream can be
+// generated independently, and blocks of counters are processed lane by lane in
+// plain 32-bit arithmetic that the compiler vectorizes.
+struct Philox4x32
+{
+    static constexpr std::uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+    static constexpr std::uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+    static constexpr int ROUNDS = 10;
+
+    // Four words of output for one counter
+    static void Block(const std::uint32_t counter[4], const std::uint32_t key[2], std::uint32_t output[4])
+    {
+        std::uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+        std::uint32_t k0 = key[0], k1 = key[1];
+        for (int round = 0; round < ROUNDS; ++round)
+        {
+            const std::uint64_t p0 = std::uint64_t(M0) * c0, p1 = std::uint64_t(M1) * c2;
+            const std::uint32_t next0 = std::uint32_t(p1 >> 32) ^ c1 ^ k0;
+            const std::uint32_t next2 = std::uint32_t(p0 >> 32) ^ c3 ^ k1;
+            c1 = std::uint32_t(p1);
+            c3 = std::uint32_t(p0);
+            c0 = next0;
+            c2 = next2;
+            k0 += W0;
+            k1 += W1;
+        }
+        output[0] = c0;
+        output[1] = c1;
+        output[2] = c2;
+        output[3] = c3;
+    }
+};
+
+// Draws from a DiscreteRandomVariable in O(1) each with Vose's alias method: the
+// values are spread over equally likely buckets, every bucket keeping its own value
+// with some probability and otherwise yielding one alias. A draw takes one random
+// word to pick the bucket and one to decide between the two.
+//
+// Draw i of stream s under seed k always uses Philox counter (i / 2, s) and key k,
+// so every stream is reproducible on its own, ranges of a stream can be filled in
+// any order or in parallel, and Fill() gives the same numbers for any thread count.
+class DiscreteSampler
+{
+private:
+    std::vector<Real> values_;
+    // Probability of keeping the bucket's own value, scaled to 2^32
+    std::vector<std::uint32_t> threshold_;
+    std::vector<std::uint32_t> alias_;
+    std::uint64_t seed_;
+
+    // Counters handled together, a multiple of the vector width
+    static constexpr size_t LANES = 8;
+
+public:
+    explicit DiscreteSampler(const DiscreteRandomVariable &X, const std::uint64_t &seed = 0) : seed_(seed)
+    {
+        const size_t n = X.Size();
+        if (n == 0)
+        {
+            throw std::invalid_argument("Cannot sample from an empty distribution.");
+        }
+        if (n > std::uint64_t(1) << 32)
+        {
+            throw std::length_error("Too many values to sample from.");
+        }
+        values_ = X.Values();
+        threshold_.assign(n, 0);
+        alias_.resize(n);
+
+        double total = 0;
+        for (const Real &probability : X.Probabilities())
+        {
+            total += probability;
+        }
+        // Probabilities scaled so that a full bucket holds 1
+        std::vector<double> scaled(n);
+        std::vector<std::uint32_t> small, large;
+        for (size_t i = 0; i < n; ++i)
+        {
+            scaled[i] = double(X.Probabilities()[i]) / total * double(n);
+            (scaled[i] < 1 ? small : large).push_back(std::uint32_t(i));
+        }
+        while (!small.empty() && !large.empty())
+        {
+            const std::uint32_t less = small.back(), more = large.back();
+            small.pop_back();
+            threshold_[less] = std::uint32_t(std::min(scaled[less] * 4294967296.0, 4294967295.0));
+            alias_[less] = more;
+            scaled[more] -= 1 - scaled[less];
+            if (scaled[more] < 1)
+            {
+                large.pop_back();
+                small.push_back(more);
+            }
+        }
+        // Left over by rounding, these buckets always keep their own value
+        for (const std::vector<std::uint32_t> *rest : {&small, &large})
+        {
+            for (const std::uint32_t &i : *rest)
+            {
+                threshold_[i] = 0xFFFFFFFF;
+                alias_[i] = i;
+            }
+        }
+    }
+
+    size_t Size() const noexcept
+    {
+        return values_.size();
+    }
+
+    std::uint64_t Seed() const noexcept
+    {
+        return seed_;
+    }
+
+    // Writes draws first, ..., first + count - 1 of the stream to out
+    void Fill(Real *out, const size_t &count, const std::uint64_t &stream = 0, const std::uint64_t &first = 0) const
+    {
+        const std::uint32_t key[2] = {std::uint32_t(seed_), std::uint32_t(seed_ >> 32)};
+        const std::uint64_t n = values_.size();
+        const Real *values = values_.data();
+        const std::uint32_t *threshold = threshold_.data();
+        const std::uint32_t *alias = alias_.data();
+
+        auto draw = [&](const std::uint32_t &bucketWord, const std::uint32_t &coin)
+        {
+            const std::uint32_t bucket = std::uint32_t((std::uint64_t(bucketWord) * n) >> 32);
+            return values[coin < threshold[bucket] ? bucket : alias[bucket]];
+        };
+
+        size_t written = 0;
+        std::uint64_t index = first;
+        // A leading odd draw uses the second half of its block
+        if (index % 2 == 1 && written < count)
+        {
+            const std::uint32_t counter[4] = {std::uint32_t(index / 2), std::uint32_t((index / 2) >> 32),
+                                              std::uint32_t(stream), std::uint32_t(stream >> 32)};
+            std::uint32_t words[4];
+            Philox4x32::Block(counter, key, words);
+            out[written++] = draw(words[2], words[3]);
+            index++;
+        }
+
+        // Whole batches of LANES blocks, lane by lane
+        while (count - written >= 2 * LANES)
+        {
+            const std::uint64_t block = index / 2;
+            std::uint32_t c0[LANES], c1[LANES], c2[LANES], c3[LANES];
+            for (size_t lane = 0; lane < LANES; ++lane)
+            {
+                c0[lane] = std::uint32_t(block + lane);
+                c1[lane] = std::uint32_t((block + lane) >> 32);
+                c2[lane] = std::uint32_t(stream);
+                c3[lane] = std::uint32_t(stream >> 32);
+            }
+            std::uint32_t k0 = key[0], k1 = key[1];
+            for (int round = 0; round < Philox4x32::ROUNDS; ++round)
+            {
+                for (size_t lane = 0; lane < LANES; ++lane)
+                {
+                    const std::uint64_t p0 = std::uint64_t(Philox4x32::M0) * c0[lane];
+                    const std::uint64_t p1 = std::uint64_t(Philox4x32::M1) * c2[lane];
+                    const std::uint32_t next0 = std::uint32_t(p1 >> 32) ^ c1[lane] ^ k0;
+                    const std::uint32_t next2 = std::uint32_t(p0 >> 32) ^ c3[lane] ^ k1;
+                    c1[lane] = std::uint32_t(p1);
+                    c3[lane] = std::uint32_t(p0);
+                    c0[lane] = next0;
+                    c2[lane] = next2;
+                }
+                k0 += Philox4x32::W0;
+                k1 += Philox4x32::W1;
+            }
+            for (size_t lane = 0; lane < LANES; ++lane)
+            {
+                out[written++] = draw(c0[lane], c1[lane]);
+                out[written++] = draw(c2[lane], c3[lane]);
+            }
+            index += 2 * LANES;
+        }
+
+        // Tail, one block at a time
+        while (written < count)
+        {
+            const std::uint32_t counter[4] = {std::uint32_t(index / 2), std::uint32_t((index / 2) >> 32),
+                                              std::uint32_t(stream), std::uint32_t(stream >> 32)};
+            std::uint32_t block[4];
+            Philox4x32::Block(counter, key, block);
+            out[written++] = draw(block[0], block[1]);
+            index++;
+            if (written < count)
+            {
+                out[written++] = draw(block[2], block[3]);
+                index++;
+            }
+        }
+    }
+
+    void Fill(std::vector<Real> &out, const std::uint64_t &stream = 0, const std::uint64_t &first = 0) const
+    {
+        Fill(out.data(), out.size(), stream, first);
+    }
+
+    // Fill() split over the thread pool; the output does not depend on the thread count
+    void ParallelFill(Real *out, const size_t &count, const std::uint64_t &stream = 0, const std::uint64_t &first = 0) const
+    {
+        linal::ParallelForRanges(count, size_t(1) << 14, [&](size_t begin, size_t end)
+                                 { Fill(out + begin, end - begin, stream, first + begin); });
+    }
+
+    // Position in one stream, for drawing it in consecutive batches
+    class Stream
+    {
+    private:
+        const DiscreteSampler *sampler_;
+        std::uint64_t stream_;
+        std::uint64_t position_ = 0;
+
+    public:
+        Stream(const DiscreteSampler &sampler, const std::uint64_t &stream) : sampler_(&sampler), stream_(stream)
+        {
+        }
+
+        // Writes the next count draws to out
+        void Fill(Real *out, const size_t &count)
+        {
+            sampler_->Fill(out, count, stream_, position_);
+            position_ += count;
+        }
+
+        void Fill(std::vector<Real> &out)
+        {
+            Fill(out.data(), out.size());
+        }
+
+        std::uint64_t Position() const noexcept
+        {
+            return position_;
+        }
+    };
+
+    // Stream of its own for every thread or task, e.g. OpenStream(thread index)
+    Stream OpenStream(const std::uint64_t &id) const
+    {
+        return Stream(*this, id);
+    }
+};
@@ -0,0 +1,42 @@
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "benchmark.h"
+#include "sampling.h"
+
+// Usage: sampling_benchmark [support size] [draws]
+// Alias-method draws from a skewed distribution, on one thread and on the pool.
+int main(int argc, char **argv)
+{
+    const size_t support = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000;
+    const size_t draws = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : size_t(1) << 26;
+
+    std::vector<Real> values(support), weights(support);
+    for (size_t i = 0; i < support; ++i)
+    {
+        values[i] = Real(i);
+        weights[i] = Real(1) / Real(i + 1);
+    }
+    const DiscreteRandomVariable X(values, weights);
+
+    DiscreteSampler sampler(X, 2024);
+    const double buildTime = Time(5, [&]
+                                  { sampler = DiscreteSampler(X, 2024); });
+
+    std::vector<Real> out(draws);
+    const double serialTime = Time(3, [&]
+                                   { sampler.Fill(out); });
+    double mean = 0;
+    for (const Real &value : out)
+    {
+        mean += value;
+    }
+    const double parallelTime = Time(3, [&]
+                                     { sampler.ParallelFill(out.data(), out.size()); });
+
+    std::cout << "alias table for " << support << " values built in " << buildTime << " ms\n";
+    std::cout << draws << " draws, mean " << mean / draws << " (exact " << E(X) << ")\n";
+    std::cout << "  serial:   " << serialTime << " ms, " << draws / serialTime / 1e3 << " M draws/s\n";
+    std::cout << "  " << linal::ThreadCount() << " threads: " << parallelTime << " ms, " << draws / parallelTime / 1e3
+              << " M draws/s\n";
+}
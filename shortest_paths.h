@@ -0,0 +1,535 @@
+#pragma once
+
+#include "graph_traversal.h"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+// Shortest paths over the edge weights of a Graph (see graph_storage.h). Like the
+// traversals, every algorithm works on node indices and accepts either a Graph or
+// its storage(). Distances are sums of edge weights in the EdgeWeight type, so
+// weights must not be negative and integral sums must not overflow.
+
+// Distance of nodes that cannot be reached
+template <typename EdgeWeight>
+constexpr EdgeWeight Unreachable() noexcept
+{
+    if constexpr (std::numeric_limits<EdgeWeight>::has_infinity)
+    {
+        return std::numeric_limits<EdgeWeight>::infinity();
+    }
+    else
+    {
+        return std::numeric_limits<EdgeWeight>::max();
+    }
+}
+
+template <typename EdgeWeight>
+struct ShortestPathTree
+{
+    // Length of a shortest path from the source, Unreachable() if there is none
+    std::vector<EdgeWeight> distance;
+    // Predecessor on such a path, the source is its own parent, UNREACHED if unreached
+    std::vector<size_t> parent;
+};
+
+namespace detail
+{
+    template <typename EdgeWeight>
+    void RequireNonNegative(const EdgeWeight &weight)
+    {
+        if (weight < EdgeWeight())
+        {
+            throw std::domain_error("Shortest paths need non-negative edge weights.");
+        }
+    }
+
+    // Indexed min-heap with arity D over node indices keyed by distance. Wide nodes
+    // keep the tree shallow and the children of a node on one or two cache lines;
+    // decrease-key keeps at most one entry per node.
+    template <typename EdgeWeight, size_t D = 4>
+    class DaryHeap
+    {
+    private:
+        static constexpr size_t ABSENT = std::numeric_limits<size_t>::max();
+
+        struct Entry
+        {
+            EdgeWeight key;
+            size_t node;
+        };
+
+        std::vector<Entry> entries_;
+        // Position of every node in entries_, ABSENT when not queued
+        std::vector<size_t> position_;
+
+        void place(const size_t &index, const Entry &entry)
+        {
+            entries_[index] = entry;
+            position_[entry.node] = index;
+        }
+
+        void up(size_t index)
+        {
+            const Entry entry = entries_[index];
+            while (index > 0)
+            {
+                const size_t parent = (index - 1) / D;
+                if (!(entry.key < entries_[parent].key))
+                {
+                    break;
+                }
+                place(index, entries_[parent]);
+                index = parent;
+            }
+            place(index, entry);
+        }
+
+        void down(size_t index)
+        {
+            const Entry entry = entries_[index];
+            while (true)
+            {
+                const size_t first = D * index + 1;
+                if (first >= entries_.size())
+                {
+                    break;
+                }
+                const size_t last = std::min(first + D, entries_.size());
+                size_t best = first;
+                for (size_t child = first + 1; child < last; ++child)
+                {
+                    if (entries_[child].key < entries_[best].key)
+                    {
+                        best = child;
+                    }
+                }
+                if (!(entries_[best].key < entry.key))
+                {
+                    break;
+                }
+                place(index, entries_[best]);
+                index = best;
+            }
+            place(index, entry);
+        }
+
+    public:
+        explicit DaryHeap(const size_t &nodes) : position_(nodes, ABSENT)
+        {
+        }
+
+        bool empty() const noexcept
+        {
+            return entries_.empty();
+        }
+
+        // Queues the node or lowers its key
+        void push_or_decrease(const size_t &node, const EdgeWeight &key)
+        {
+            if (position_[node] == ABSENT)
+            {
+                entries_.push_back(Entry{key, node});
+                up(entries_.size() - 1);
+            }
+            else
+            {
+                entries_[position_[node]].key = key;
+                up(position_[node]);
+            }
+        }
+
+        size_t pop()
+        {
+            const size_t node = entries_.front().node;
+            position_[node] = ABSENT;
+            const Entry last = entries_.back();
+            entries_.pop_back();
+            if (!entries_.empty())
+            {
+                place(0, last);
+                down(0);
+            }
+            return node;
+        }
+    };
+
+    // Lowers slot to value unless it already holds something smaller
+    template <typename EdgeWeight>
+    bool AtomicMin(std::atomic<EdgeWeight> &slot, const EdgeWeight &value)
+    {
+        EdgeWeight current = slot.load(std::memory_order_relaxed);
+        while (value < current)
+        {
+            if (slot.compare_exchange_weak(current, value, std::memory_order_relaxed))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Parents from final distances. An in-neighbor whose distance plus the edge weight
+    // gives the node's distance lies on a shortest path; taking only strictly closer
+    // ones keeps the parents a tree. Nodes left over, whose predecessors rounded to
+    // the same distance, are attached in BFS order from the nodes already in the tree.
+    template <typename Storage, typename EdgeWeight>
+    std::vector<size_t> ShortestPathParents(const Storage &storage, const std::vector<EdgeWeight> &distance,
+                                            const size_t &source)
+    {
+        std::vector<size_t> parent(distance.size(), UNREACHED);
+        std::atomic<bool> pending(false);
+        linal::ParallelForRanges(distance.size(), 256, [&](size_t first, size_t last)
+                                 {
+                                     for (size_t v = first; v < last; ++v)
+                                     {
+                                         if (v == source || distance[v] == Unreachable<EdgeWeight>())
+                                         {
+                                             continue;
+                                         }
+                                         storage.for_each_in(v, [&](const size_t &u, const EdgeWeight &weight)
+                                                             {
+                                                                 if (distance[u] < distance[v] && distance[u] + weight == distance[v])
+                                                                 {
+                                                                     parent[v] = u;
+                                                                     return false;
+                                                                 }
+                                                                 return true; });
+                                         if (parent[v] == UNREACHED)
+                                         {
+                                             pending.store(true, std::memory_order_relaxed);
+                                         }
+                                     } });
+        parent[source] = source;
+
+        if (pending.load())
+        {
+            std::vector<size_t> queue;
+            for (size_t v = 0; v < parent.size(); ++v)
+            {
+                if (parent[v] != UNREACHED)
+                {
+                    queue.push_back(v);
+                }
+            }
+            for (size_t head = 0; head < queue.size(); ++head)
+            {
+                const size_t u = queue[head];
+                storage.for_each_out(u, [&](const size_t &v, const EdgeWeight &weight)
+                                     {
+                                         if (parent[v] == UNREACHED && distance[u] + weight == distance[v])
+                                         {
+                                             parent[v] = u;
+                                             queue.push_back(v);
+                                         } });
+            }
+        }
+        return parent;
+    }
+}
+
+// Serial Dijkstra with a 4-ary heap. O((V + E) log V).
+template <typename Storage>
+auto Dijkstra(const Storage &storage, const size_t &source)
+{
+    using EdgeWeight = typename Storage::weight_type;
+
+    const size_t n = storage.size();
+    if (source >= n)
+    {
+        throw std::out_of_range("Source node out of range.");
+    }
+
+    ShortestPathTree<EdgeWeight> tree;
+    tree.distance.assign(n, Unreachable<EdgeWeight>());
+    tree.parent.assign(n, UNREACHED);
+    tree.distance[source] = EdgeWeight();
+    tree.parent[source] = source;
+
+    std::vector<bool> settled(n, false);
+    detail::DaryHeap<EdgeWeight> heap(n);
+    heap.push_or_decrease(source, EdgeWeight());
+    while (!heap.empty())
+    {
+        const size_t u = heap.pop();
+        settled[u] = true;
+        storage.for_each_out(u, [&](const size_t &v, const EdgeWeight &weight)
+                             {
+                                 detail::RequireNonNegative(weight);
+                                 const EdgeWeight candidate = tree.distance[u] + weight;
+                                 if (!settled[v] && candidate < tree.distance[v])
+                                 {
+                                     tree.distance[v] = candidate;
+                                     tree.parent[v] = u;
+                                     heap.push_or_decrease(v, candidate);
+                                 } });
+    }
+    return tree;
+}
+
+template <typename TNode, typename EdgeWeight, typename Storage>
+ShortestPathTree<EdgeWeight> Dijkstra(const Graph<TNode, EdgeWeight, Storage> &graph, const NodeId &source)
+{
+    return Dijkstra(graph.storage(), source.index());
+}
+
+// Parallel delta-stepping. Bucket b holds the nodes with tentative distance in
+// [b * delta, (b + 1) * delta); the lowest non-empty bucket is relaxed in parallel,
+// re-filling itself until it settles, then the next one follows. The frontier is
+// split into a fixed set of tasks and each task files the nodes it improves into
+// its own buckets, so bucket insertion needs no synchronization; only the distance
+// updates are atomic. delta = 0 picks the mean edge weight.
+//
+// Small delta approaches Dijkstra (little parallelism, little wasted work), large
+// delta approaches Bellman-Ford.
+template <typename Storage>
+auto DeltaStepping(const Storage &storage, const size_t &source,
+                   typename Storage::weight_type delta = typename Storage::weight_type())
+{
+    using EdgeWeight = typename Storage::weight_type;
+
+    const size_t n = storage.size();
+    if (source >= n)
+    {
+        throw std::out_of_range("Source node out of range.");
+    }
+
+    if (!(delta > EdgeWeight()))
+    {
+        double total = 0;
+        size_t count = 0;
+        for (size_t u = 0; u < n; ++u)
+        {
+            storage.for_each_out(u, [&](const size_t &, const EdgeWeight &weight)
+                                 {
+                                     total += static_cast<double>(weight);
+                                     count++; });
+        }
+        delta = static_cast<EdgeWeight>(count > 0 ? total / count : 1);
+        if (!(delta > EdgeWeight()))
+        {
+            delta = std::is_integral_v<EdgeWeight> ? EdgeWeight(1) : std::numeric_limits<EdgeWeight>::min();
+        }
+    }
+
+    std::unique_ptr<std::atomic<EdgeWeight>[]> distance(new std::atomic<EdgeWeight>[n]);
+    linal::ParallelForRanges(n, 1 << 14, [&](size_t first, size_t last)
+                             {
+                                 for (size_t v = first; v < last; ++v)
+                                 {
+                                     distance[v].store(Unreachable<EdgeWeight>(), std::memory_order_relaxed);
+                                 } });
+    distance[source].store(EdgeWeight(), std::memory_order_relaxed);
+
+    auto bucketOf = [&](const EdgeWeight &value)
+    {
+        return static_cast<size_t>(value / delta);
+    };
+
+    const size_t tasks = 4 * linal::ThreadCount();
+    std::vector<std::vector<std::vector<size_t>>> buckets(tasks);
+    std::atomic<bool> negative(false);
+
+    std::vector<size_t> frontier{source};
+    size_t current = 0;
+    while (true)
+    {
+        const EdgeWeight lower = static_cast<EdgeWeight>(current) * delta;
+        linal::ThreadPool::Instance().ParallelFor(tasks, [&](size_t task)
+                                                  {
+                                                      std::vector<std::vector<size_t>> &local = buckets[task];
+                                                      const size_t first = frontier.size() * task / tasks;
+                                                      const size_t last = frontier.size() * (task + 1) / tasks;
+                                                      for (size_t i = first; i < last; ++i)
+                                                      {
+                                                          const size_t u = frontier[i];
+                                                          const EdgeWeight base = distance[u].load(std::memory_order_relaxed);
+                                                          // Settled in an earlier bucket, a stale entry
+                                                          if (base < lower)
+                                                          {
+                                                              continue;
+                                                          }
+                                                          storage.for_each_out(u, [&](const size_t &v, const EdgeWeight &weight)
+                                                                               {
+                                                                                   if (weight < EdgeWeight())
+                                                                                   {
+                                                                                       negative.store(true, std::memory_order_relaxed);
+                                                                                       return;
+                                                                                   }
+                                                                                   const EdgeWeight candidate = base + weight;
+                                                                                   if (detail::AtomicMin(distance[v], candidate))
+                                                                                   {
+                                                                                       const size_t bucket = std::max(current, bucketOf(candidate));
+                                                                                       if (bucket >= local.size())
+                                                                                       {
+                                                                                           local.resize(bucket + 1);
+                                                                                       }
+                                                                                       local[bucket].push_back(v);
+                                                                                   } });
+                                                      } });
+        if (negative.load())
+        {
+            throw std::domain_error("Shortest paths need non-negative edge weights.");
+        }
+
+        // Lowest non-empty bucket across all tasks, the current one first
+        size_t next = std::numeric_limits<size_t>::max();
+        for (const auto &local : buckets)
+        {
+            for (size_t bucket = current; bucket < std::min(next, local.size()); ++bucket)
+            {
+                if (!local[bucket].empty())
+                {
+                    next = bucket;
+                    break;
+                }
+            }
+        }
+        if (next == std::numeric_limits<size_t>::max())
+        {
+            break;
+        }
+
+        frontier.clear();
+        for (auto &local : buckets)
+        {
+            if (next < local.size())
+            {
+                frontier.insert(frontier.end(), local[next].begin(), local[next].end());
+                local[next].clear();
+            }
+        }
+        current = next;
+    }
+
+    ShortestPathTree<EdgeWeight> tree;
+    tree.distance.resize(n);
+    linal::ParallelForRanges(n, 1 << 14, [&](size_t first, size_t last)
+                             {
+                                 for (size_t v = first; v < last; ++v)
+                                 {
+                                     tree.distance[v] = distance[v].load(std::memory_order_relaxed);
+                                 } });
+    tree.parent = detail::ShortestPathParents(storage, tree.distance, source);
+    return tree;
+}
+
+template <typename TNode, typename EdgeWeight, typename Storage>
+ShortestPathTree<EdgeWeight> DeltaStepping(const Graph<TNode, EdgeWeight, Storage> &graph, const NodeId &source,
+                                           const EdgeWeight &delta = EdgeWeight())
+{
+    return DeltaStepping(graph.storage(), source.index(), delta);
+}
+
+// Single-source shortest paths: Dijkstra when running serially or on small graphs,
+// where the bucket rounds do not pay off, delta-stepping otherwise
+template <typename Storage>
+auto ShortestPaths(const Storage &storage, const size_t &source)
+{
+    if (linal::ThreadCount() == 1 || storage.size() < (1 << 14))
+    {
+        return Dijkstra(storage, source);
+    }
+    return DeltaStepping(storage, source);
+}
+
+template <typename TNode, typename EdgeWeight, typename Storage>
+ShortestPathTree<EdgeWeight> ShortestPaths(const Graph<TNode, EdgeWeight, Storage> &graph, const NodeId &source)
+{
+    return ShortestPaths(graph.storage(), source.index());
+}
+
+// All-pairs shortest path lengths by blocked Floyd-Warshall over the dense
+// adjacency matrix, O(V^3) time and O(V^2) memory, for small graphs. Like the
+// adjacency matrix the result is indexed (to, from); unreachable pairs hold
+// Unreachable().
+//
+// The matrix is processed in B x B tiles. For every diagonal tile k the tile
+// itself is closed first, then the tiles in its row and column, then all other
+// tiles in parallel; each step only reads tiles already final for round k, and
+// the working set of a tile update stays in cache.
+template <typename Storage>
+auto FloydWarshall(const Storage &storage)
+{
+    using EdgeWeight = typename Storage::weight_type;
+    constexpr size_t B = 64;
+
+    const size_t n = storage.size();
+    const EdgeWeight infinity = Unreachable<EdgeWeight>();
+    linal::Matrix<EdgeWeight> distance(n, n, infinity);
+    EdgeWeight *d = distance.data();
+    for (size_t from = 0; from < n; ++from)
+    {
+        storage.for_each_out(from, [&](const size_t &to, const EdgeWeight &weight)
+                             {
+                                 detail::RequireNonNegative(weight);
+                                 d[to * n + from] = weight; });
+        d[from * n + from] = EdgeWeight();
+    }
+
+    // Relaxes tile (I, J) through the intermediate nodes of tile K
+    auto relax = [&](const size_t &I, const size_t &J, const size_t &K)
+    {
+        const size_t iEnd = std::min(I + B, n), jEnd = std::min(J + B, n), kEnd = std::min(K + B, n);
+        for (size_t k = K; k < kEnd; ++k)
+        {
+            const EdgeWeight *rowK = d + k * n;
+            for (size_t i = I; i < iEnd; ++i)
+            {
+                const EdgeWeight ik = d[i * n + k];
+                if (ik == infinity)
+                {
+                    continue;
+                }
+                EdgeWeight *rowI = d + i * n;
+                for (size_t j = J; j < jEnd; ++j)
+                {
+                    if (rowK[j] != infinity)
+                    {
+                        rowI[j] = std::min(rowI[j], ik + rowK[j]);
+                    }
+                }
+            }
+        }
+    };
+
+    const size_t tiles = (n + B - 1) / B;
+    for (size_t k = 0; k < tiles; ++k)
+    {
+        const size_t K = k * B;
+        relax(K, K, K);
+
+        linal::ThreadPool::Instance().ParallelFor(2 * tiles, [&](size_t task)
+                                                  {
+                                                      const size_t t = task % tiles;
+                                                      if (t == k)
+                                                      {
+                                                          return;
+                                                      }
+                                                      if (task < tiles)
+                                                      {
+                                                          relax(K, t * B, K);
+                                                      }
+                                                      else
+                                                      {
+                                                          relax(t * B, K, K);
+                                                      } });
+
+        linal::ThreadPool::Instance().ParallelFor(tiles * tiles, [&](size_t task)
+                                                  {
+                                                      const size_t i = task / tiles, j = task % tiles;
+                                                      if (i != k && j != k)
+                                                      {
+                                                          relax(i * B, j * B, K);
+                                                      } });
+    }
+    return distance;
+}
+
+template <typename TNode, typename EdgeWeight, typename Storage>
+linal::Matrix<EdgeWeight> FloydWarshall(const Graph<TNode, EdgeWeight, Storage> &graph)
+{
+    return FloydWarshall(graph.storage());
+}
@@ -0,0 +1,514 @@
+#ifndef MATHEMANIA_SIMD_H_
+#define MATHEMANIA_SIMD_H_
+
+#include <cstddef>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MATHEMANIA_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace linal
+{
+    namespace kernels
+    {
+        // Instruction sets usable on the running CPU
+        struct CpuFeatures
+        {
+            bool avx2 = false;
+            bool avx512 = false;
+
+            static const CpuFeatures &Detect()
+            {
+                static const CpuFeatures features = []
+                {
+                    CpuFeatures result;
+#ifdef MATHEMANIA_X86_DISPATCH
+                    __builtin_cpu_init();
+                    result.avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+                    result.avx512 = __builtin_cpu_supports("avx512f");
+#endif
+                    return result;
+                }();
+                return features;
+            }
+        };
+
+        // Element-wise and reduction kernels over contiguous arrays, one table per
+        // element type. The table is picked once, on first use, from CPUID.
+        template <typename T>
+        struct VectorKernels
+        {
+            void (*add)(size_t, const T *, const T *, T *);
+            void (*scale)(size_t, const T *, T, T *);
+            void (*divide)(size_t, const T *, T, T *);
+            T (*dot)(size_t, const T *, const T *);
+            // x.y, x.x and y.y in a single pass
+            void (*gram)(size_t, const T *, const T *, T *);
+        };
+
+        namespace scalar
+        {
+            template <typename T>
+            void Add(size_t n, const T *x, const T *y, T *out)
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    out[i] = x[i] + y[i];
+                }
+            }
+
+            template <typename T>
+            void Scale(size_t n, const T *x, T scalar, T *out)
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    out[i] = x[i] * scalar;
+                }
+            }
+
+            template <typename T>
+            void Divide(size_t n, const T *x, T scalar, T *out)
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    out[i] = x[i] / scalar;
+                }
+            }
+
+            // Four independent accumulators hide the latency of the additions
+            template <typename T>
+            T Dot(size_t n, const T *x, const T *y)
+            {
+                T sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+                size_t i = 0;
+                for (; i + 4 <= n; i += 4)
+                {
+                    sum0 += x[i] * y[i];
+                    sum1 += x[i + 1] * y[i + 1];
+                    sum2 += x[i + 2] * y[i + 2];
+                    sum3 += x[i + 3] * y[i + 3];
+                }
+                for (; i < n; i++)
+                {
+                    sum0 += x[i] * y[i];
+                }
+                return (sum0 + sum1) + (sum2 + sum3);
+            }
+
+            template <typename T>
+            void Gram(size_t n, const T *x, const T *y, T *out)
+            {
+                T xy = 0, xx = 0, yy = 0;
+                for (size_t i = 0; i < n; i++)
+                {
+                    xy += x[i] * y[i];
+                    xx += x[i] * x[i];
+                    yy += y[i] * y[i];
+                }
+                out[0] = xy;
+                out[1] = xx;
+                out[2] = yy;
+            }
+        }
+
+#ifdef MATHEMANIA_X86_DISPATCH
+        namespace avx2
+        {
+            __attribute__((target("avx2,fma"))) inline float HorizontalSum(__m256 v)
+            {
+                __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+                sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+                sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+                return _mm_cvtss_f32(sum);
+            }
+
+            __attribute__((target("avx2,fma"))) inline double HorizontalSum(__m256d v)
+            {
+                __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+                sum = _mm_add_sd(sum, _mm_unpackhi_pd(sum, sum));
+                return _mm_cvtsd_f64(sum);
+            }
+
+            __attribute__((target("avx2,fma"))) inline void Add(size_t n, const float *x, const float *y, float *out)
+            {
+                size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                {
+                    _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+                }
+                scalar::Add(n - i, x + i, y + i, out + i);
+            }
+
+            __attribute__((target("avx2,fma"))) inline void Add(size_t n, const double *x, const double *y, double *out)
+            {
+                size_t i = 0;
+                for (; i + 4 <= n; i += 4)
+                {
+                    _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+                }
+                scalar::Add(n - i, x + i, y + i, out + i);
+            }
+
+            __attribute__((target("avx2,fma"))) inline void Scale(size_t n, const float *x, float scalar, float *out)
+            {
+                const __m256 factor = _mm256_set1_ps(scalar);
+                size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                {
+                    _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(x + i), factor));
+                }
+                scalar::Scale(n - i, x + i, scalar, out + i);
+            }
+
+            __attribute__((target("avx2,fma"))) inline void Scale(size_t n, const double *x, double scalar, double *out)
+            {
+                const __m256d factor = _mm256_set1_pd(scalar);
+                size_t i = 0;
+                for (; i + 4 <= n; i += 4)
+                {
+                    _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(x + i), factor));
+                }
+                scalar::Scale(n - i, x + i, scalar, out + i);
+            }
+
+            __attribute__((target("avx2,fma"))) inline void Divide(size_t n, const float *x, float scalar, float *out)
+            {
+                const __m256 divisor = _mm256_set1_ps(scalar);
+                size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                {
+                    _mm256_storeu_ps(out + i, _mm256_div_ps(_mm256_loadu_ps(x + i), divisor));
+                }
+                scalar::Divide(n - i, x + i, scalar, out + i);
+            }
+
+            __attribute__((target("avx2,fma"))) inline void Divide(size_t n, const double *x, double scalar, double *out)
+            {
+                const __m256d divisor = _mm256_set1_pd(scalar);
+                size_t i = 0;
+                for (; i + 4 <= n; i += 4)
+                {
+                    _mm256_storeu_pd(out + i, _mm256_div_pd(_mm256_loadu_pd(x + i), divisor));
+                }
+                scalar::Divide(n - i, x + i, scalar, out + i);
+            }
+
+            // Four 8-wide accumulators: 32 products in flight per iteration
+            __attribute__((target("avx2,fma"))) inline float Dot(size_t n, const float *x, const float *y)
+            {
+                __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+                __m256 sum2 = _mm256_setzero_ps(), sum3 = _mm256_setzero_ps();
+                size_t i = 0;
+                for (; i + 32 <= n; i += 32)
+                {
+                    sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), sum0);
+                    sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(y + i + 8), sum1);
+                    sum2 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 16), _mm256_loadu_ps(y + i + 16), sum2);
+                    sum3 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 24), _mm256_loadu_ps(y + i + 24), sum3);
+                }
+                for (; i + 8 <= n; i += 8)
+                {
+                    sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), sum0);
+                }
+                const __m256 sum = _mm256_add_ps(_mm256_add_ps(sum0, sum1), _mm256_add_ps(sum2, sum3));
+                return HorizontalSum(sum) + scalar::Dot(n - i, x + i, y + i);
+            }
+
+            __attribute__((target("avx2,fma"))) inline double Dot(size_t n, const double *x, const double *y)
+            {
+                __m256d sum0 = _mm256_setzero_pd(), sum1 = _mm256_setzero_pd();
+                __m256d sum2 = _mm256_setzero_pd(), sum3 = _mm256_setzero_pd();
+                size_t i = 0;
+                for (; i + 16 <= n; i += 16)
+                {
+                    sum0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), sum0);
+                    sum1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4), sum1);
+                    sum2 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 8), _mm256_loadu_pd(y + i + 8), sum2);
+                    sum3 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 12), _mm256_loadu_pd(y + i + 12), sum3);
+                }
+                for (; i + 4 <= n; i += 4)
+                {
+                    sum0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), sum0);
+                }
+                const __m256d sum = _mm256_add_pd(_mm256_add_pd(sum0, sum1), _mm256_add_pd(sum2, sum3));
+                return HorizontalSum(sum) + scalar::Dot(n - i, x + i, y + i);
+            }
+
+            __attribute__((target("avx2,fma"))) inline void Gram(size_t n, const float *x, const float *y, float *out)
+            {
+                __m256 xy = _mm256_setzero_ps(), xx = _mm256_setzero_ps(), yy = _mm256_setzero_ps();
+                size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                {
+                    const __m256 u = _mm256_loadu_ps(x + i);
+                    const __m256 v = _mm256_loadu_ps(y + i);
+                    xy = _mm256_fmadd_ps(u, v, xy);
+                    xx = _mm256_fmadd_ps(u, u, xx);
+                    yy = _mm256_fmadd_ps(v, v, yy);
+                }
+                scalar::Gram(n - i, x + i, y + i, out);
+                out[0] += HorizontalSum(xy);
+                out[1] += HorizontalSum(xx);
+                out[2] += HorizontalSum(yy);
+            }
+
+            __attribute__((target("avx2,fma"))) inline void Gram(size_t n, const double *x, const double *y, double *out)
+            {
+                __m256d xy = _mm256_setzero_pd(), xx = _mm256_setzero_pd(), yy = _mm256_setzero_pd();
+                size_t i = 0;
+                for (; i + 4 <= n; i += 4)
+                {
+                    const __m256d u = _mm256_loadu_pd(x + i);
+                    const __m256d v = _mm256_loadu_pd(y + i);
+                    xy = _mm256_fmadd_pd(u, v, xy);
+                    xx = _mm256_fmadd_pd(u, u, xx);
+                    yy = _mm256_fmadd_pd(v, v, yy);
+                }
+                scalar::Gram(n - i, x + i, y + i, out);
+                out[0] += HorizontalSum(xy);
+                out[1] += HorizontalSum(xx);
+                out[2] += HorizontalSum(yy);
+            }
+        }
+
+        namespace avx512
+        {
+            // Halves added down to one AVX register. The zero-masked extracts stand in
+            // for _mm512_reduce_add_* and the casts, which GCC 12 builds on an undefined
+            // register that -Wuninitialized flags.
+            __attribute__((target("avx512f"))) inline float HorizontalSum(__m512 v)
+            {
+                const __m512d bits = _mm512_castps_pd(v);
+                const __m256 low = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xF, bits, 0));
+                const __m256 high = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xF, bits, 1));
+                return avx2::HorizontalSum(_mm256_add_ps(low, high));
+            }
+
+            __attribute__((target("avx512f"))) inline double HorizontalSum(__m512d v)
+            {
+                const __m256d low = _mm512_maskz_extractf64x4_pd(0xF, v, 0);
+                const __m256d high = _mm512_maskz_extractf64x4_pd(0xF, v, 1);
+                return avx2::HorizontalSum(_mm256_add_pd(low, high));
+            }
+
+            __attribute__((target("avx512f"))) inline void Add(size_t n, const float *x, const float *y, float *out)
+            {
+                size_t i = 0;
+                for (; i + 16 <= n; i += 16)
+                {
+                    _mm512_storeu_ps(out + i, _mm512_add_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+                }
+                const __mmask16 mask = (__mmask16)((1u << (n - i)) - 1);
+                _mm512_mask_storeu_ps(out + i, mask, _mm512_add_ps(_mm512_maskz_loadu_ps(mask, x + i),
+                                                                   _mm512_maskz_loadu_ps(mask, y + i)));
+            }
+
+            __attribute__((target("avx512f"))) inline void Add(size_t n, const double *x, const double *y, double *out)
+            {
+                size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                {
+                    _mm512_storeu_pd(out + i, _mm512_add_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+                }
+                const __mmask8 mask = (__mmask8)((1u << (n - i)) - 1);
+                _mm512_mask_storeu_pd(out + i, mask, _mm512_add_pd(_mm512_maskz_loadu_pd(mask, x + i),
+                                                                   _mm512_maskz_loadu_pd(mask, y + i)));
+            }
+
+            __attribute__((target("avx512f"))) inline void Scale(size_t n, const float *x, float scalar, float *out)
+            {
+                const __m512 factor = _mm512_set1_ps(scalar);
+                size_t i = 0;
+                for (; i + 16 <= n; i += 16)
+                {
+                    _mm512_storeu_ps(out + i, _mm512_mul_ps(_mm512_loadu_ps(x + i), factor));
+                }
+                const __mmask16 mask = (__mmask16)((1u << (n - i)) - 1);
+                _mm512_mask_storeu_ps(out + i, mask, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, x + i), factor));
+            }
+
+            __attribute__((target("avx512f"))) inline void Scale(size_t n, const double *x, double scalar, double *out)
+            {
+                const __m512d factor = _mm512_set1_pd(scalar);
+                size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                {
+                    _mm512_storeu_pd(out + i, _mm512_mul_pd(_mm512_loadu_pd(x + i), factor));
+                }
+                const __mmask8 mask = (__mmask8)((1u << (n - i)) - 1);
+                _mm512_mask_storeu_pd(out + i, mask, _mm512_mul_pd(_mm512_maskz_loadu_pd(mask, x + i), factor));
+            }
+
+            __attribute__((target("avx512f"))) inline void Divide(size_t n, const float *x, float scalar, float *out)
+            {
+                const __m512 divisor = _mm512_set1_ps(scalar);
+                size_t i = 0;
+                for (; i + 16 <= n; i += 16)
+                {
+                    _mm512_storeu_ps(out + i, _mm512_div_ps(_mm512_loadu_ps(x + i), divisor));
+                }
+                scalar::Divide(n - i, x + i, scalar, out + i);
+            }
+
+            __attribute__((target("avx512f"))) inline void Divide(size_t n, const double *x, double scalar, double *out)
+            {
+                const __m512d divisor = _mm512_set1_pd(scalar);
+                size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                {
+                    _mm512_storeu_pd(out + i, _mm512_div_pd(_mm512_loadu_pd(x + i), divisor));
+                }
+                scalar::Divide(n - i, x + i, scalar, out + i);
+            }
+
+            // Four 16-wide accumulators: 64 products in flight per iteration
+            __attribute__((target("avx512f"))) inline float Dot(size_t n, const float *x, const float *y)
+            {
+                __m512 sum0 = _mm512_setzero_ps(), sum1 = _mm512_setzero_ps();
+                __m512 sum2 = _mm512_setzero_ps(), sum3 = _mm512_setzero_ps();
+                size_t i = 0;
+                for (; i + 64 <= n; i += 64)
+                {
+                    sum0 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), sum0);
+                    sum1 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 16), _mm512_loadu_ps(y + i + 16), sum1);
+                    sum2 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 32), _mm512_loadu_ps(y + i + 32), sum2);
+                    sum3 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 48), _mm512_loadu_ps(y + i + 48), sum3);
+                }
+                for (; i + 16 <= n; i += 16)
+                {
+                    sum0 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), sum0);
+                }
+                const __mmask16 mask = (__mmask16)((1u << (n - i)) - 1);
+                sum1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, x + i), _mm512_maskz_loadu_ps(mask, y + i), sum1);
+                return HorizontalSum(_mm512_add_ps(_mm512_add_ps(sum0, sum1), _mm512_add_ps(sum2, sum3)));
+            }
+
+            __attribute__((target("avx512f"))) inline double Dot(size_t n, const double *x, const double *y)
+            {
+                __m512d sum0 = _mm512_setzero_pd(), sum1 = _mm512_setzero_pd();
+                __m512d sum2 = _mm512_setzero_pd(), sum3 = _mm512_setzero_pd();
+                size_t i = 0;
+                for (; i + 32 <= n; i += 32)
+                {
+                    sum0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), sum0);
+                    sum1 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8), sum1);
+                    sum2 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 16), _mm512_loadu_pd(y + i + 16), sum2);
+                    sum3 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 24), _mm512_loadu_pd(y + i + 24), sum3);
+                }
+                for (; i + 8 <= n; i += 8)
+                {
+                    sum0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), sum0);
+                }
+                const __mmask8 mask = (__mmask8)((1u << (n - i)) - 1);
+                sum1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, x + i), _mm512_maskz_loadu_pd(mask, y + i), sum1);
+                return HorizontalSum(_mm512_add_pd(_mm512_add_pd(sum0, sum1), _mm512_add_pd(sum2, sum3)));
+            }
+
+            __attribute__((target("avx512f"))) inline void Gram(size_t n, const float *x, const float *y, float *out)
+            {
+                __m512 xy = _mm512_setzero_ps(), xx = _mm512_setzero_ps(), yy = _mm512_setzero_ps();
+                size_t i = 0;
+                for (; i < n; i += 16)
+                {
+                    const __mmask16 mask = n - i >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << (n - i)) - 1);
+                    const __m512 u = _mm512_maskz_loadu_ps(mask, x + i);
+                    const __m512 v = _mm512_maskz_loadu_ps(mask, y + i);
+                    xy = _mm512_fmadd_ps(u, v, xy);
+                    xx = _mm512_fmadd_ps(u, u, xx);
+                    yy = _mm512_fmadd_ps(v, v, yy);
+                }
+                out[0] = HorizontalSum(xy);
+                out[1] = HorizontalSum(xx);
+                out[2] = HorizontalSum(yy);
+            }
+
+            __attribute__((target("avx512f"))) inline void Gram(size_t n, const double *x, const double *y, double *out)
+            {
+                __m512d xy = _mm512_setzero_pd(), xx = _mm512_setzero_pd(), yy = _mm512_setzero_pd();
+                size_t i = 0;
+                for (; i < n; i += 8)
+                {
+                    const __mmask8 mask = n - i >= 8 ? (__mmask8)0xFF : (__mmask8)((1u << (n - i)) - 1);
+                    const __m512d u = _mm512_maskz_loadu_pd(mask, x + i);
+                    const __m512d v = _mm512_maskz_loadu_pd(mask, y + i);
+                    xy = _mm512_fmadd_pd(u, v, xy);
+                    xx = _mm512_fmadd_pd(u, u, xx);
+                    yy = _mm512_fmadd_pd(v, v, yy);
+                }
+                out[0] = HorizontalSum(xy);
+                out[1] = HorizontalSum(xx);
+                out[2] = HorizontalSum(yy);
+            }
+        }
+#endif
+
+        template <typename T>
+        const VectorKernels<T> &Kernels()
+        {
+            static const VectorKernels<T> table = []
+            {
+                VectorKernels<T> result = {scalar::Add<T>, scalar::Scale<T>, scalar::Divide<T>,
+                                           scalar::Dot<T>, scalar::Gram<T>};
+#ifdef MATHEMANIA_X86_DISPATCH
+                if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>)
+                {
+                    const CpuFeatures &features = CpuFeatures::Detect();
+                    if (features.avx512)
+                    {
+                        result = {avx512::Add, avx512::Scale, avx512::Divide, avx512::Dot, avx512::Gram};
+                    }
+                    else if (features.avx2)
+                    {
+                        result = {avx2::Add, avx2::Scale, avx2::Divide, avx2::Dot, avx2::Gram};
+                    }
+                }
+#endif
+                return result;
+            }();
+            return table;
+        }
+
+        template <typename T>
+        constexpr bool IsVectorizable = std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+        // out = x + y
+        template <typename T>
+        void Add(const size_t &n, const T *x, const T *y, T *out)
+        {
+            Kernels<T>().add(n, x, y, out);
+        }
+
+        // out = x * scalar
+        template <typename T>
+        void Scale(const size_t &n, const T *x, const T &scalar, T *out)
+        {
+            Kernels<T>().scale(n, x, scalar, out);
+        }
+
+        // out = x / scalar
+        template <typename T>
+        void Divide(const size_t &n, const T *x, const T &scalar, T *out)
+        {
+            Kernels<T>().divide(n, x, scalar, out);
+        }
+
+        template <typename T>
+        T Dot(const size_t &n, const T *x, const T *y)
+        {
+            return Kernels<T>().dot(n, x, y);
+        }
+
+        // Writes x.y, x.x and y.y to out[0..2]
+        template <typename T>
+        void Gram(const size_t &n, const T *x, const T *y, T *out)
+        {
+            Kernels<T>().gram(n, x, y, out);
+        }
+    }
+}
+
+#endif
+
+// MATHEMANIA_SIMD_H_
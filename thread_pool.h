@@ -0,0 +1,300 @@
+#ifndef MATHEMANIA_THREAD_POOL_H_
+#define MATHEMANIA_THREAD_POOL_H_
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace linal
+{
+    // Persistent pool of worker threads that executes indexed tasks.
+    // Every participant owns a deque: it pops its own tasks from the back
+    // and, once it runs dry, steals from the front of the other deques,
+    // so uneven task costs do not leave threads idle.
+    class ThreadPool
+    {
+    private:
+        struct TaskDeque
+        {
+            std::mutex mutex;
+            std::deque<size_t> tasks;
+        };
+
+        std::vector<std::thread> workers_;
+        std::vector<std::unique_ptr<TaskDeque>> deques_;
+
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable done_;
+        size_t generation_ = 0;
+        size_t running_ = 0;
+        bool stop_ = false;
+
+        // Serializes concurrent ParallelFor calls from different threads
+        std::mutex job_mutex_;
+        const std::function<void(size_t)> *body_ = nullptr;
+        std::exception_ptr error_;
+
+        static bool &InsideWorker()
+        {
+            thread_local bool inside = false;
+            return inside;
+        }
+
+        bool Pop(const size_t &self, size_t &task)
+        {
+            TaskDeque &own = *deques_[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (own.tasks.empty())
+            {
+                return false;
+            }
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+
+        bool Steal(const size_t &self, size_t &task)
+        {
+            for (size_t offset = 1; offset < deques_.size(); offset++)
+            {
+                TaskDeque &victim = *deques_[(self + offset) % deques_.size()];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (!victim.tasks.empty())
+                {
+                    task = victim.tasks.front();
+                    victim.tasks.pop_front();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Runs tasks until every deque is empty. No task spawns new ones,
+        // so an unsuccessful steal sweep means the job is drained.
+        void Work(const size_t &self)
+        {
+            size_t task;
+            while (Pop(self, task) || Steal(self, task))
+            {
+                try
+                {
+                    (*body_)(task);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (!error_)
+                    {
+                        error_ = std::current_exception();
+                    }
+                }
+            }
+        }
+
+        // seen is the generation at start-up, so a new worker waits for the next job
+        void WorkerLoop(const size_t self, size_t seen)
+        {
+            InsideWorker() = true;
+            while (true)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    wake_.wait(lock, [&]
+                               { return stop_ || generation_ != seen; });
+                    if (stop_)
+                    {
+                        return;
+                    }
+                    seen = generation_;
+                }
+
+                Work(self);
+
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (--running_ == 0)
+                {
+                    done_.notify_one();
+                }
+            }
+        }
+
+        void Start(const size_t &threads)
+        {
+            stop_ = false;
+            deques_.clear();
+            for (size_t index = 0; index < threads; index++)
+            {
+                deques_.push_back(std::make_unique<TaskDeque>());
+            }
+            size_t generation;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                generation = generation_;
+            }
+            // The calling thread is participant 0
+            for (size_t index = 1; index < threads; index++)
+            {
+                workers_.emplace_back(&ThreadPool::WorkerLoop, this, index, generation);
+            }
+        }
+
+        void Stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            wake_.notify_all();
+            for (auto &worker : workers_)
+            {
+                worker.join();
+            }
+            workers_.clear();
+        }
+
+    public:
+        explicit ThreadPool(const size_t &threads = std::thread::hardware_concurrency())
+        {
+            Start(std::max<size_t>(1, threads));
+        }
+
+        ~ThreadPool()
+        {
+            Stop();
+        }
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        // Pool shared by the library's parallel kernels
+        static ThreadPool &Instance()
+        {
+            static ThreadPool pool;
+            return pool;
+        }
+
+        // Number of participants, the calling thread included
+        size_t size() const noexcept
+        {
+            return deques_.size();
+        }
+
+        void resize(const size_t &threads)
+        {
+            std::lock_guard<std::mutex> job(job_mutex_);
+            Stop();
+            Start(std::max<size_t>(1, threads));
+        }
+
+        // Calls body(task) for every task in [0, count) and waits for all of them.
+        // Tasks are dealt out in contiguous runs so that neighbouring tasks start on
+        // the same thread; stealing rebalances from there. Called from inside a
+        // task it runs serially instead of deadlocking on the pool.
+        void ParallelFor(const size_t &count, const std::function<void(size_t)> &body)
+        {
+            if (count == 0)
+            {
+                return;
+            }
+
+            if (size() == 1 || count == 1 || InsideWorker())
+            {
+                for (size_t task = 0; task < count; task++)
+                {
+                    body(task);
+                }
+                return;
+            }
+
+            std::lock_guard<std::mutex> job(job_mutex_);
+
+            // Published before any task is visible to a stealing thread
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                body_ = &body;
+                error_ = nullptr;
+            }
+
+            const size_t participants = size();
+            for (size_t index = 0; index < participants; index++)
+            {
+                const size_t first = count * index / participants;
+                const size_t last = count * (index + 1) / participants;
+                std::lock_guard<std::mutex> lock(deques_[index]->mutex);
+                for (size_t task = first; task < last; task++)
+                {
+                    deques_[index]->tasks.push_back(task);
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                running_ = participants - 1;
+                generation_++;
+            }
+            wake_.notify_all();
+
+            InsideWorker() = true;
+            Work(0);
+            InsideWorker() = false;
+
+            std::exception_ptr error;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                done_.wait(lock, [&]
+                           { return running_ == 0; });
+                body_ = nullptr;
+                error = error_;
+            }
+
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+    };
+
+    // Number of threads used by the parallel kernels
+    inline size_t ThreadCount()
+    {
+        return ThreadPool::Instance().size();
+    }
+
+    // Sets the number of threads used by the parallel kernels; 1 makes them serial
+    inline void SetThreadCount(const size_t &threads)
+    {
+        ThreadPool::Instance().resize(threads);
+    }
+
+    // Calls body(first, last) over contiguous ranges covering [0, total), each at least
+    // grain long (but the last), with a few ranges per thread so stealing can balance them
+    template <typename F>
+    void ParallelForRanges(const size_t &total, const size_t &grain, F &&body)
+    {
+        const size_t threads = ThreadCount();
+        if (threads == 1 || total <= grain)
+        {
+            if (total > 0)
+            {
+                body(size_t(0), total);
+            }
+            return;
+        }
+
+        const size_t ranges = std::min((total + grain - 1) / grain, 8 * threads);
+        ThreadPool::Instance().ParallelFor(ranges, [&](size_t range)
+                                           { body(total * range / ranges, total * (range + 1) / ranges); });
+    }
+}
+
+#endif
+
+// MATHEMANIA_THREAD_POOL_H_
@@ -0,0 +1,73 @@
+#ifndef MATHEMANIA_TRANSFORM_H_
+#define MATHEMANIA_TRANSFORM_H_
+
+#include "matrix.h"
+#include "quaternion.h"
+#include "vector3.h"
+
+namespace linal
+{
+    // Linear map applied to a vector
+    inline Vector3D operator*(const Matrix<float, 3, 3> &matrix, const Vector3D &vector)
+    {
+        return Vector3D(matrix(0, 0) * vector.x + matrix(0, 1) * vector.y + matrix(0, 2) * vector.z,
+                        matrix(1, 0) * vector.x + matrix(1, 1) * vector.y + matrix(1, 2) * vector.z,
+                        matrix(2, 0) * vector.x + matrix(2, 1) * vector.y + matrix(2, 2) * vector.z);
+    }
+
+    // Affine map in homogeneous coordinates applied to a point (w = 1)
+    inline Vector3D TransformPoint(const Matrix<float, 4, 4> &matrix, const Vector3D &point)
+    {
+        const float w = matrix(3, 0) * point.x + matrix(3, 1) * point.y + matrix(3, 2) * point.z + matrix(3, 3);
+        return Vector3D((matrix(0, 0) * point.x + matrix(0, 1) * point.y + matrix(0, 2) * point.z + matrix(0, 3)) / w,
+                        (matrix(1, 0) * point.x + matrix(1, 1) * point.y + matrix(1, 2) * point.z + matrix(1, 3)) / w,
+                        (matrix(2, 0) * point.x + matrix(2, 1) * point.y + matrix(2, 2) * point.z + matrix(2, 3)) / w);
+    }
+
+    // Affine map in homogeneous coordinates applied to a direction (w = 0)
+    inline Vector3D TransformDirection(const Matrix<float, 4, 4> &matrix, const Vector3D &direction)
+    {
+        return Vector3D(matrix(0, 0) * direction.x + matrix(0, 1) * direction.y + matrix(0, 2) * direction.z,
+                        matrix(1, 0) * direction.x + matrix(1, 1) * direction.y + matrix(1, 2) * direction.z,
+                        matrix(2, 0) * direction.x + matrix(2, 1) * direction.y + matrix(2, 2) * direction.z);
+    }
+
+    // Translation in homogeneous coordinates
+    inline Matrix<float, 4, 4> TranslationMatrix(const Vector3D &offset)
+    {
+        Matrix<float, 4, 4> result = Matrix<float, 4, 4>::Identity();
+        result(0, 3) = offset.x;
+        result(1, 3) = offset.y;
+        result(2, 3) = offset.z;
+        return result;
+    }
+
+    // Rotation described by a quaternion, which is normalized first
+    template <typename T = float>
+    Matrix<T, 3, 3> RotationMatrix(const Quaternion &quaternion)
+    {
+        const Quaternion::Real norm = quaternion.abs();
+        const T a = static_cast<T>(quaternion.a() / norm);
+        const T b = static_cast<T>(quaternion.b() / norm);
+        const T c = static_cast<T>(quaternion.c() / norm);
+        const T d = static_cast<T>(quaternion.d() / norm);
+
+        return Matrix<T, 3, 3>(1 - 2 * (c * c + d * d), 2 * (b * c - a * d), 2 * (b * d + a * c),
+                               2 * (b * c + a * d), 1 - 2 * (b * b + d * d), 2 * (c * d - a * b),
+                               2 * (b * d - a * c), 2 * (c * d + a * b), 1 - 2 * (b * b + c * c));
+    }
+
+    // Rotation followed by translation in homogeneous coordinates
+    inline Matrix<float, 4, 4> RigidTransform(const Quaternion &rotation, const Vector3D &translation)
+    {
+        const Matrix<float, 3, 3> r = RotationMatrix<float>(rotation);
+        return Matrix<float, 4, 4>(r(0, 0), r(0, 1), r(0, 2), translation.x,
+                                   r(1, 0), r(1, 1), r(1, 2), translation.y,
+                                   r(2, 0), r(2, 1), r(2, 2), translation.z,
+                                   0.0f, 0.0f, 0.0f, 1.0f);
+    }
+}
+
+#endif
+
+// MATHEMANIA_TRANSFORM_H_
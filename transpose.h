@@ -0,0 +1,323 @@
+#ifndef MATHEMANIA_TRANSPOSE_H_
+#define MATHEMANIA_TRANSPOSE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "simd.h"
+
+namespace linal
+{
+    namespace kernels
+    {
+        // Blocks at most this many rows and columns are transposed directly;
+        // larger ones are halved recursively, which keeps every level of the
+        // cache and TLB busy with a working set that fits it.
+        constexpr size_t TRANSPOSE_LEAF = 32;
+
+        // Side of the square tile transposed in registers: one ymm row per tile row.
+        // A leaf block already sits in L1, so an 8x8 double tile in zmm registers
+        // would save shuffles but no memory traffic.
+        template <typename T>
+        constexpr size_t TransposeTile = std::is_same_v<T, float> ? 8 : std::is_same_v<T, double> ? 4 : 1;
+
+        namespace scalar
+        {
+            template <typename T>
+            void TransposeTile(const T *in, const size_t &ldi, T *out, const size_t &ldo)
+            {
+                constexpr size_t TILE = kernels::TransposeTile<T>;
+                for (size_t i = 0; i < TILE; i++)
+                {
+                    for (size_t j = 0; j < TILE; j++)
+                    {
+                        out[j * ldo + i] = in[i * ldi + j];
+                    }
+                }
+            }
+
+            // Exchanges tile a with the transpose of tile b
+            template <typename T>
+            void TransposeSwapTile(T *a, T *b, const size_t &ld)
+            {
+                constexpr size_t TILE = kernels::TransposeTile<T>;
+                for (size_t i = 0; i < TILE; i++)
+                {
+                    for (size_t j = 0; j < TILE; j++)
+                    {
+                        std::swap(a[i * ld + j], b[j * ld + i]);
+                    }
+                }
+            }
+        }
+
+#ifdef MATHEMANIA_X86_DISPATCH
+        namespace avx2
+        {
+            __attribute__((target("avx2"))) inline void Transpose8x8(__m256 *r)
+            {
+                const __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+                const __m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+                const __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+                const __m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+                const __m256 t4 = _mm256_unpacklo_ps(r[4], r[5]);
+                const __m256 t5 = _mm256_unpackhi_ps(r[4], r[5]);
+                const __m256 t6 = _mm256_unpacklo_ps(r[6], r[7]);
+                const __m256 t7 = _mm256_unpackhi_ps(r[6], r[7]);
+
+                const __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+                const __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+                const __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+                const __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+                const __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+                const __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+                const __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+                const __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+                r[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+                r[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+                r[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+                r[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+                r[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+                r[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+                r[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+                r[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+            }
+
+            __attribute__((target("avx2"))) inline void Transpose4x4(__m256d *r)
+            {
+                const __m256d t0 = _mm256_unpacklo_pd(r[0], r[1]);
+                const __m256d t1 = _mm256_unpackhi_pd(r[0], r[1]);
+                const __m256d t2 = _mm256_unpacklo_pd(r[2], r[3]);
+                const __m256d t3 = _mm256_unpackhi_pd(r[2], r[3]);
+
+                r[0] = _mm256_permute2f128_pd(t0, t2, 0x20);
+                r[1] = _mm256_permute2f128_pd(t1, t3, 0x20);
+                r[2] = _mm256_permute2f128_pd(t0, t2, 0x31);
+                r[3] = _mm256_permute2f128_pd(t1, t3, 0x31);
+            }
+
+            __attribute__((target("avx2"))) inline void TransposeTile(const float *in, const size_t &ldi, float *out, const size_t &ldo)
+            {
+                __m256 r[8];
+                for (size_t i = 0; i < 8; i++)
+                {
+                    r[i] = _mm256_loadu_ps(in + i * ldi);
+                }
+                Transpose8x8(r);
+                for (size_t i = 0; i < 8; i++)
+                {
+                    _mm256_storeu_ps(out + i * ldo, r[i]);
+                }
+            }
+
+            __attribute__((target("avx2"))) inline void TransposeTile(const double *in, const size_t &ldi, double *out, const size_t &ldo)
+            {
+                __m256d r[4];
+                for (size_t i = 0; i < 4; i++)
+                {
+                    r[i] = _mm256_loadu_pd(in + i * ldi);
+                }
+                Transpose4x4(r);
+                for (size_t i = 0; i < 4; i++)
+                {
+                    _mm256_storeu_pd(out + i * ldo, r[i]);
+                }
+            }
+
+            __attribute__((target("avx2"))) inline void TransposeSwapTile(float *a, float *b, const size_t &ld)
+            {
+                __m256 ra[8], rb[8];
+                for (size_t i = 0; i < 8; i++)
+                {
+                    ra[i] = _mm256_loadu_ps(a + i * ld);
+                    rb[i] = _mm256_loadu_ps(b + i * ld);
+                }
+                Transpose8x8(ra);
+                Transpose8x8(rb);
+                for (size_t i = 0; i < 8; i++)
+                {
+                    _mm256_storeu_ps(a + i * ld, rb[i]);
+                    _mm256_storeu_ps(b + i * ld, ra[i]);
+                }
+            }
+
+            __attribute__((target("avx2"))) inline void TransposeSwapTile(double *a, double *b, const size_t &ld)
+            {
+                __m256d ra[4], rb[4];
+                for (size_t i = 0; i < 4; i++)
+                {
+                    ra[i] = _mm256_loadu_pd(a + i * ld);
+                    rb[i] = _mm256_loadu_pd(b + i * ld);
+                }
+                Transpose4x4(ra);
+                Transpose4x4(rb);
+                for (size_t i = 0; i < 4; i++)
+                {
+                    _mm256_storeu_pd(a + i * ld, rb[i]);
+                    _mm256_storeu_pd(b + i * ld, ra[i]);
+                }
+            }
+        }
+#endif
+
+        // Transposes a leaf block: whole tiles in registers, ragged edges element by element
+        template <typename T>
+        void TransposeLeaf(const size_t &rows, const size_t &columns,
+                           const T *in, const size_t &ldi, T *out, const size_t &ldo)
+        {
+            constexpr size_t TILE = TransposeTile<T>;
+            const size_t tiledRows = TILE > 1 ? rows / TILE * TILE : 0;
+            const size_t tiledColumns = TILE > 1 ? columns / TILE * TILE : 0;
+
+            if constexpr (TILE > 1)
+            {
+#ifdef MATHEMANIA_X86_DISPATCH
+                const bool avx2 = CpuFeatures::Detect().avx2;
+#endif
+                for (size_t i = 0; i < tiledRows; i += TILE)
+                {
+                    for (size_t j = 0; j < tiledColumns; j += TILE)
+                    {
+#ifdef MATHEMANIA_X86_DISPATCH
+                        if (avx2)
+                        {
+                            avx2::TransposeTile(in + i * ldi + j, ldi, out + j * ldo + i, ldo);
+                            continue;
+                        }
+#endif
+                        scalar::TransposeTile(in + i * ldi + j, ldi, out + j * ldo + i, ldo);
+                    }
+                }
+            }
+
+            for (size_t i = 0; i < rows; i++)
+            {
+                for (size_t j = i < tiledRows ? tiledColumns : 0; j < columns; j++)
+                {
+                    out[j * ldo + i] = in[i * ldi + j];
+                }
+            }
+        }
+
+        // Exchanges the rows x columns block a with the transpose of the columns x rows block b
+        template <typename T>
+        void TransposeSwapLeaf(const size_t &rows, const size_t &columns, T *a, T *b, const size_t &ld)
+        {
+            constexpr size_t TILE = TransposeTile<T>;
+            const size_t tiledRows = TILE > 1 ? rows / TILE * TILE : 0;
+            const size_t tiledColumns = TILE > 1 ? columns / TILE * TILE : 0;
+
+            if constexpr (TILE > 1)
+            {
+#ifdef MATHEMANIA_X86_DISPATCH
+                const bool avx2 = CpuFeatures::Detect().avx2;
+#endif
+                for (size_t i = 0; i < tiledRows; i += TILE)
+                {
+                    for (size_t j = 0; j < tiledColumns; j += TILE)
+                    {
+#ifdef MATHEMANIA_X86_DISPATCH
+                        if (avx2)
+                        {
+                            avx2::TransposeSwapTile(a + i * ld + j, b + j * ld + i, ld);
+                            continue;
+                        }
+#endif
+                        scalar::TransposeSwapTile(a + i * ld + j, b + j * ld + i, ld);
+                    }
+                }
+            }
+
+            for (size_t i = 0; i < rows; i++)
+            {
+                for (size_t j = i < tiledRows ? tiledColumns : 0; j < columns; j++)
+                {
+                    std::swap(a[i * ld + j], b[j * ld + i]);
+                }
+            }
+        }
+
+        // Splits a length in two, keeping the first part a multiple of the register tile
+        template <typename T>
+        size_t TransposeSplit(const size_t &length)
+        {
+            constexpr size_t TILE = TransposeTile<T>;
+            return std::max(TILE, length / 2 / TILE * TILE);
+        }
+
+        // out (columns x rows, leading dimension ldo) = transpose of in (rows x columns, leading dimension ldi)
+        template <typename T>
+        void Transpose(const size_t &rows, const size_t &columns,
+                       const T *in, const size_t &ldi, T *out, const size_t &ldo)
+        {
+            if (rows <= TRANSPOSE_LEAF && columns <= TRANSPOSE_LEAF)
+            {
+                TransposeLeaf(rows, columns, in, ldi, out, ldo);
+            }
+            else if (rows >= columns)
+            {
+                const size_t half = TransposeSplit<T>(rows);
+                Transpose(half, columns, in, ldi, out, ldo);
+                Transpose(rows - half, columns, in + half * ldi, ldi, out + half, ldo);
+            }
+            else
+            {
+                const size_t half = TransposeSplit<T>(columns);
+                Transpose(rows, half, in, ldi, out, ldo);
+                Transpose(rows, columns - half, in + half, ldi, out + half * ldo, ldo);
+            }
+        }
+
+        // Exchanges a (rows x columns) with the transpose of b (columns x rows), both with leading dimension ld
+        template <typename T>
+        void TransposeSwap(const size_t &rows, const size_t &columns, T *a, T *b, const size_t &ld)
+        {
+            if (rows <= TRANSPOSE_LEAF && columns <= TRANSPOSE_LEAF)
+            {
+                TransposeSwapLeaf(rows, columns, a, b, ld);
+            }
+            else if (rows >= columns)
+            {
+                const size_t half = TransposeSplit<T>(rows);
+                TransposeSwap(half, columns, a, b, ld);
+                TransposeSwap(rows - half, columns, a + half * ld, b + half, ld);
+            }
+            else
+            {
+                const size_t half = TransposeSplit<T>(columns);
+                TransposeSwap(rows, half, a, b, ld);
+                TransposeSwap(rows, columns - half, a + half, b + half * ld, ld);
+            }
+        }
+
+        // Transposes the n x n block a in place: the diagonal quadrants recursively,
+        // the off-diagonal quadrants by exchanging them with each other
+        template <typename T>
+        void TransposeInPlace(const size_t &n, T *a, const size_t &ld)
+        {
+            if (n <= TRANSPOSE_LEAF)
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    for (size_t j = i + 1; j < n; j++)
+                    {
+                        std::swap(a[i * ld + j], a[j * ld + i]);
+                    }
+                }
+                return;
+            }
+
+            const size_t half = TransposeSplit<T>(n);
+            TransposeInPlace(half, a, ld);
+            TransposeInPlace(n - half, a + half * ld + half, ld);
+            TransposeSwap(half, n - half, a + half, a + half * ld, ld);
+        }
+    }
+}
+
+#endif
+
+// MATHEMANIA_TRANSPOSE_H_
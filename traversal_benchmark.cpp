@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "benchmark.h"
+#include "graph_generators.h"
+#include "graph_traversal.h"
+#include "shortest_paths.h"
+
+// Usage: traversal_benchmark [scale] [edge factor]
+int main(int argc, char **argv)
+{
+    const size_t scale = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 18;
+    const size_t edgeFactor = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 16;
+
+    CsrStorage<float> storage;
+    const double build = Time(1, [&](int)
+                              {
+                                  storage.add_nodes(size_t(1) << scale);
+                                  storage.insert_edges(RMatEdges<float>(scale, edgeFactor)); });
+    std::cout << "R-MAT scale " << scale << ": " << storage.size() << " nodes, " << storage.edges()
+              << " edges, built in " << build << " ms\n";
+
+    // Sources with outgoing edges, so that every search does real work
+    std::vector<size_t> sources;
+    for (size_t v = 0; sources.size() < 8 && v < storage.size(); v += 997)
+    {
+        if (storage.out_degree(v) > 0)
+        {
+            sources.push_back(v);
+        }
+    }
+    if (sources.empty())
+    {
+        std::cout << "No sampled node has outgoing edges, nothing to search from\n";
+        return 0;
+    }
+    // Shortest paths are slower, they run from the first two sources at most
+    const int pathSources = static_cast<int>(std::min<size_t>(2, sources.size()));
+
+    const size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> threadCounts;
+    for (size_t threads = 1; threads < hardware; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(hardware);
+
+    for (const size_t &threads : threadCounts)
+    {
+        linal::SetThreadCount(threads);
+        const double bfs = Time(static_cast<int>(sources.size()), [&](int index)
+                                { BreadthFirstSearch(storage, sources[index]); });
+        const double cc = Time(3, [&](int)
+                               { ConnectedComponents(storage); });
+        const double scc = Time(1, [&](int)
+                                { StronglyConnectedComponents(storage); });
+        const double dijkstra = Time(pathSources, [&](int index)
+                                     { Dijkstra(storage, sources[index]); });
+        const double delta = Time(pathSources, [&](int index)
+                                  { DeltaStepping(storage, sources[index]); });
+
+        std::cout << "  threads = " << threads << " : BFS " << bfs << " ms (" << storage.edges() / bfs / 1e3
+                  << " MTEPS), CC " << cc << " ms, SCC " << scc << " ms, Dijkstra " << dijkstra
+                  << " ms, delta-stepping " << delta << " ms\n";
+    }
+
+    return 0;
+}
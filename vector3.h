@@ -21,11 +21,6 @@ public:
     Vector3D operator-=(const Vector3D &);
     Vector3D operator/=(const float &);
 
-    Vector3D operator+=(const Vector3D &);
-    Vector3D operator*=(const float &);
-    Vector3D operator-=(const Vector3D &);
-    Vector3D operator/=(const float &);
-
     Vector3D operator-() const;
     Vector3D operator+() const;
 